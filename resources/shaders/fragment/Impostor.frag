@@ -0,0 +1,60 @@
+// Impostor Fragment Shader, lights the baked atlases of ImpostorAtlas like PhongMTL_FOG does the mesh
+#version 400 core
+out vec4 FragColor;
+
+in vec3 fragPos;
+in vec2 texCoord0;
+in vec2 texCoord1;
+in float viewBlend;
+in float fogDistance;
+flat in mat3 instanceRotation;
+flat in float impostorFade; // 0 = mesh only, 1 = impostor only
+
+uniform sampler2D u_impostorDiffuse; // rgb = Kd * texture, a = coverage
+uniform sampler2D u_impostorAmbient; // rgb = Ka * texture
+uniform sampler2D u_impostorNormal;  // model space normal * 0.5 + 0.5
+
+// light parameters
+uniform vec3 u_light_ambient;
+uniform vec3 u_light_position;
+uniform vec3 u_light_diffuse;
+
+// fog parameters
+uniform vec3 u_fogColor;
+uniform float u_fogStart;
+uniform float u_fogEnd;
+
+// Same pattern as PhongMTL_FOG_FADE.frag, the other way round
+float ditherThreshold()
+{
+    const float bayer[16] = float[](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) % 4;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+
+vec4 sampleViews(sampler2D atlas)
+{
+    return mix(texture(atlas, texCoord0), texture(atlas, texCoord1), viewBlend);
+}
+
+void main()
+{
+    if (ditherThreshold() >= impostorFade)
+        discard;
+
+    vec4 diffuseColor = sampleViews(u_impostorDiffuse);
+    if (diffuseColor.a < 0.5)
+        discard;
+
+    // The atlases are cleared to transparent black, filtering at the silhouette mixes that in
+    vec3 albedo = diffuseColor.rgb / diffuseColor.a;
+    vec3 ambientColor = sampleViews(u_impostorAmbient).rgb / diffuseColor.a;
+    vec3 norm = normalize(instanceRotation * (sampleViews(u_impostorNormal).rgb / diffuseColor.a * 2.0 - 1.0));
+
+    vec3 lightDir = normalize(u_light_position - fragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 result = u_light_ambient * ambientColor + u_light_diffuse * diff * albedo;
+
+    float fogFactor = clamp((fogDistance - u_fogStart) / (u_fogEnd - u_fogStart), 0.0, 1.0);
+    FragColor = vec4(mix(result, u_fogColor, fogFactor), 1.0);
+}
@@ -0,0 +1,29 @@
+// Impostor Bake Fragment Shader, unlit material colors and normals for Impostor.frag to light
+#version 400 core
+layout (location = 0) out vec4 outDiffuse; // rgb = Kd * texture, a = coverage
+layout (location = 1) out vec4 outAmbient; // rgb = Ka * texture
+layout (location = 2) out vec4 outNormal;  // model space normal * 0.5 + 0.5
+
+in vec3 normal;
+in vec2 texCoord;
+
+uniform vec3 u_material_ambient;
+uniform vec3 u_material_diffuse;
+
+uniform int u_hasTexture;
+uniform sampler2D u_texture_diffuse;
+
+void main()
+{
+    // Same texture coordinate flip as PhongMTL_FOG_diffTEX.frag
+    vec3 texColor = u_hasTexture != 0 ? texture(u_texture_diffuse, vec2(texCoord.x, 1.0 - texCoord.y)).rgb : vec3(1.0);
+
+    // Faces are drawn from both sides, the back side faces the other way
+    vec3 norm = normalize(normal);
+    if (!gl_FrontFacing)
+        norm = -norm;
+
+    outDiffuse = vec4(u_material_diffuse * texColor, 1.0);
+    outAmbient = vec4(u_material_ambient * texColor, 1.0);
+    outNormal = vec4(norm * 0.5 + 0.5, 1.0);
+}
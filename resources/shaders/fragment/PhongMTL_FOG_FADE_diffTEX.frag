@@ -0,0 +1,74 @@
+// Same as PhongMTL_FOG_diffTEX.frag, dissolved into the impostor over the fade band (Instanced.vert)
+#version 400 core
+out vec4 FragColor;
+
+in vec3 normal;
+in vec3 fragPos;
+in vec2 texCoord;
+in float fogDistance;
+flat in float impostorFade; // 0 = mesh only, 1 = impostor only
+
+uniform vec3 u_camPos;
+
+// Material Uniforms
+uniform vec3 u_material_diffuse;   // Kd (Diffuse Color)
+uniform vec3 u_material_ambient;  // Ka (Ambient Color)
+uniform vec3 u_material_specular;  // Ks (Specular Color)
+uniform float u_material_shininess; // Ns (Specular Exponent/Shininess)
+
+// light parameters
+uniform vec3 u_light_ambient;
+uniform vec3 u_light_position;
+uniform vec3 u_light_diffuse;
+uniform vec3 u_light_specular;
+
+// fog parameters
+uniform vec3 u_fogColor;
+uniform float u_fogStart;
+uniform float u_fogEnd;
+
+uniform sampler2D u_texture_diffuse;
+
+// 4x4 ordered dither threshold in (0, 1). Impostor.frag uses the same pattern the other way
+// round, so in the fade band every pixel is drawn by exactly one of mesh and impostor.
+float ditherThreshold()
+{
+    const float bayer[16] = float[](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) % 4;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+
+void main()
+{
+    if (ditherThreshold() < impostorFade)
+        discard;
+
+    // Flip Y coordinate - Meshy.ai uses top-left origin, OpenGL uses bottom-left
+    vec2 correctedTexCoord = vec2(texCoord.x, 1.0 - texCoord.y);
+    
+    // ambient
+    vec3 ambient = u_light_ambient * u_material_ambient * vec3(texture(u_texture_diffuse, correctedTexCoord)); 
+    
+    // diffuse
+    vec3 norm = normalize(normal);
+    vec3 lightDir = normalize(u_light_position - fragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    // Diffuse Light * Diffuse Factor * Material Diffuse Color (Kd)
+    vec3 diffuse = u_light_diffuse * diff * u_material_diffuse * vec3(texture(u_texture_diffuse, correctedTexCoord));
+    
+    // specular
+    vec3 viewDir = normalize(u_camPos - fragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    // Use Material Shininess (Ns)
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), u_material_shininess);
+    // Specular Light * Specular Factor * Material Specular Color (Ks)
+    vec3 specular = u_light_specular * spec * u_material_specular * vec3(texture(u_texture_diffuse, correctedTexCoord));
+
+    // The final color is the sum of the components
+    vec3 result = ambient + diffuse + specular;
+    FragColor = vec4(result, 1.0);
+    
+    // Apply fog effect
+    float fogFactor = clamp((fogDistance - u_fogStart) / (u_fogEnd - u_fogStart), 0.0, 1.0);
+    FragColor.rgb = mix(FragColor.rgb, u_fogColor, fogFactor);
+}
\ No newline at end of file
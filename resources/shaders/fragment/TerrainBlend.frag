@@ -2,7 +2,6 @@
 #version 400 core
 out vec4 FragColor;
 
-in vec3 normal;  
 in vec3 fragPos;  
 in vec2 texCoord;
 in float height;
@@ -64,8 +63,13 @@ void main()
         terrainColor = mountainColor;
     }
     
+    // Flat shading: face normal from the screen space derivatives of the position.
+    // Terrain always faces up, so flip it if the derivatives gave us the back side.
+    vec3 norm = normalize(cross(dFdx(fragPos), dFdy(fragPos)));
+    if (norm.y < 0.0)
+        norm = -norm;
+
     // Phong lighting for terrain
-    vec3 norm = normalize(normal);
     vec3 lightDir = normalize(u_light_position - fragPos);
     vec3 viewDir = normalize(u_camPos - fragPos);
     
@@ -0,0 +1,89 @@
+// Terrain Fragment Shader for chunks with baked splat weights (TC_SPLAT_MAPS)
+// Same lighting, water and fog as TerrainBlend.frag, but the textures are blended by the chunk's splat layer
+// (ground, grass, mountain, water) instead of being picked by height, and only the ones with weight are sampled.
+// Away from the band edges that is a single ground texture per fragment instead of three.
+#version 400 core
+out vec4 FragColor;
+
+in vec3 fragPos;
+in vec2 texCoord;
+in vec3 splatCoord; // xy = splat texture coordinate, z = layer
+in float fogDistance;
+
+uniform sampler2D u_texture0; // Low terrain (ground)
+uniform sampler2D u_texture1; // Mid terrain (grass)
+uniform sampler2D u_texture2; // High terrain (mountain/rock)
+uniform sampler2D u_texture3; // Water (blue water)
+uniform sampler2D u_texture4; // Water detail (white water)
+uniform sampler2DArray u_splatMaps; // rgba = ground, grass, mountain, water weight
+
+uniform vec3 u_camPos;
+
+// light parameters
+uniform vec3 u_light_ambient;
+uniform vec3 u_light_position;
+uniform vec3 u_light_diffuse;
+uniform vec3 u_light_specular;
+
+// fog parameters
+uniform vec3 u_fogColor;
+uniform float u_fogStart;
+uniform float u_fogEnd;
+
+void main()
+{
+    vec4 weights = texture(u_splatMaps, splatCoord);
+
+    // The samples below are skipped per layer, so their derivatives are taken up front
+    // (implicit ones are undefined in non uniform control flow)
+    vec2 dx = dFdx(texCoord);
+    vec2 dy = dFdy(texCoord);
+
+    // Ground layers, weighted to add up to one (8 bit weights are off by a bit)
+    vec3 ground = weights.rgb / max(weights.r + weights.g + weights.b, 1e-4);
+    vec3 terrainColor = vec3(0.0);
+    if (ground.r > 0.0)
+        terrainColor += ground.r * textureGrad(u_texture0, texCoord, dx, dy).rgb;
+    if (ground.g > 0.0)
+        terrainColor += ground.g * textureGrad(u_texture1, texCoord, dx, dy).rgb;
+    if (ground.b > 0.0)
+        terrainColor += ground.b * textureGrad(u_texture2, texCoord, dx, dy).rgb;
+
+    // Flat shading: face normal from the screen space derivatives of the position.
+    // Terrain always faces up, so flip it if the derivatives gave us the back side.
+    vec3 norm = normalize(cross(dFdx(fragPos), dFdy(fragPos)));
+    if (norm.y < 0.0)
+        norm = -norm;
+
+    // Phong lighting for terrain
+    vec3 lightDir = normalize(u_light_position - fragPos);
+    vec3 viewDir = normalize(u_camPos - fragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, norm);
+
+    vec3 ambient = u_light_ambient * terrainColor;
+    vec3 diffuse = u_light_diffuse * diff * terrainColor;
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 16);
+    vec3 specular = u_light_specular * spec * 0.3; // Reduced specular for terrain
+    vec3 result = ambient + diffuse + specular;
+    float alpha = 1.0;
+
+    // Water overlay with transparency, lit like TerrainBlend.frag lights it
+    if (weights.a > 0.0)
+    {
+        vec3 blueWater = textureGrad(u_texture3, texCoord * 1.5, dx * 1.5, dy * 1.5).rgb;
+        vec3 whiteWater = textureGrad(u_texture4, texCoord * 2.5, dx * 2.5, dy * 2.5).rgb;
+        vec3 waterColor = mix(blueWater, whiteWater, 0.10);
+
+        float waterSpec = pow(max(dot(viewDir, reflectDir), 0.0), 128);
+        vec3 waterResult = u_light_ambient * waterColor * 1.2 + u_light_diffuse * diff * waterColor * 0.7 +
+                           u_light_specular * waterSpec * 1.5;
+
+        result = mix(result, waterResult, weights.a);
+        alpha = mix(1.0, 0.85, weights.a);
+    }
+
+    // Calculate fog factor (same for water and terrain)
+    float fogFactor = clamp((fogDistance - u_fogStart) / (u_fogEnd - u_fogStart), 0.0, 1.0);
+    FragColor = vec4(mix(result, u_fogColor, fogFactor), alpha);
+}
@@ -0,0 +1,52 @@
+// Water Fragment Shader for WaterRenderer
+// The water part of TerrainBlend.frag on its own, the surface is flat so the normal is always up
+#version 400 core
+out vec4 FragColor;
+
+in vec3 fragPos;
+in vec2 texCoord;
+
+uniform sampler2D u_texture3; // Water (blue water)
+uniform sampler2D u_texture4; // Water detail (white water)
+
+uniform vec3 u_camPos;
+
+// light parameters
+uniform vec3 u_light_ambient;
+uniform vec3 u_light_position;
+uniform vec3 u_light_diffuse;
+uniform vec3 u_light_specular;
+
+// fog parameters
+uniform vec3 u_fogColor;
+uniform float u_fogStart;
+uniform float u_fogEnd;
+
+void main()
+{
+    vec3 norm = vec3(0.0, 1.0, 0.0);
+    vec3 lightDir = normalize(u_light_position - fragPos);
+    vec3 viewDir = normalize(u_camPos - fragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float diff = max(dot(norm, lightDir), 0.0);
+
+    // Mix blue and white water (mostly blue, some white for foam/detail)
+    vec4 blueWater = texture(u_texture3, texCoord * 1.5);
+    vec4 whiteWater = texture(u_texture4, texCoord * 2.5);
+    vec4 waterColor = mix(blueWater, whiteWater, 0.10);
+
+    // Water has high specular (reflective surface)
+    float waterSpec = pow(max(dot(viewDir, reflectDir), 0.0), 128);
+    vec3 waterSpecular = u_light_specular * waterSpec * 1.5;
+
+    // Water lighting (slightly enhanced ambient for underwater glow)
+    vec3 waterAmbient = u_light_ambient * vec3(waterColor) * 1.2;
+    vec3 waterDiffuse = u_light_diffuse * diff * vec3(waterColor) * 0.7;
+    vec3 waterResult = waterAmbient + waterDiffuse + waterSpecular;
+
+    // Same fog as the terrain, per fragment since the cells are large
+    float fogFactor = clamp((length(u_camPos - fragPos) - u_fogStart) / (u_fogEnd - u_fogStart), 0.0, 1.0);
+    waterResult = mix(waterResult, u_fogColor, fogFactor);
+
+    FragColor = vec4(waterResult, 0.85);
+}
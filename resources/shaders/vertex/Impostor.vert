@@ -0,0 +1,71 @@
+// Impostor Vertex Shader, one camera facing quad per instance (see ImpostorAtlas)
+// Uses the same per instance transforms as Instanced.vert
+#version 400 core
+layout (location = 0) in vec2 aQuad; // x in [-1, 1] across, y in [0, 1] up
+
+// Instance data (per-tree transform)
+layout (location = 5) in vec4 aInstanceRow0;
+layout (location = 6) in vec4 aInstanceRow1;
+layout (location = 7) in vec4 aInstanceRow2;
+layout (location = 8) in vec4 aInstanceRow3;
+
+out vec3 fragPos;
+out vec2 texCoord0; // atlas tile of the two baked views closest to the view direction
+out vec2 texCoord1;
+out float viewBlend; // 0 = texCoord0, 1 = texCoord1
+out float fogDistance;
+flat out mat3 instanceRotation; // model space normals -> world
+flat out float impostorFade;
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform vec3 u_camPos;
+
+uniform vec3 u_impostorCenter;  // model space, on the ground
+uniform float u_impostorRadius; // model space half width
+uniform vec2 u_impostorHeight;  // model space min/max height
+uniform int u_impostorViews;    // tiles in the atlas
+uniform vec2 u_impostorFade;    // distance the impostor starts and finishes fading in
+
+void main()
+{
+    mat4 instanceModel = mat4(aInstanceRow0, aInstanceRow1, aInstanceRow2, aInstanceRow3);
+    vec3 origin = instanceModel[3].xyz;
+
+    impostorFade = clamp((length(u_camPos - origin) - u_impostorFade.x) / (u_impostorFade.y - u_impostorFade.x), 0.0, 1.0);
+
+    // Still drawn as a mesh, a degenerate triangle skips rasterization
+    if (impostorFade <= 0.0)
+    {
+        gl_Position = vec4(0.0);
+        return;
+    }
+
+    // Assumes uniform scale and rotation around y only (trees, props)
+    float scale = length(instanceModel[0].xyz);
+    instanceRotation = mat3(instanceModel) / scale;
+
+    // Rotates around the up axis to face the camera
+    vec3 base = vec3(instanceModel * vec4(u_impostorCenter, 1.0));
+    vec3 toCamera = u_camPos - base;
+    vec2 toCameraXZ = length(toCamera.xz) > 0.0001 ? normalize(toCamera.xz) : vec2(0.0, 1.0);
+    vec3 right = vec3(toCameraXZ.y, 0.0, -toCameraXZ.x); // cross(up, toCamera)
+
+    fragPos = base + right * (aQuad.x * u_impostorRadius * scale)
+                   + vec3(0.0, mix(u_impostorHeight.x, u_impostorHeight.y, aQuad.y) * scale, 0.0);
+    fogDistance = length(u_camPos - fragPos);
+
+    // View direction in model space, baked view k looks from angle 2 pi k / u_impostorViews around y
+    vec3 modelDir = transpose(instanceRotation) * vec3(toCameraXZ.x, 0.0, toCameraXZ.y);
+    float view = atan(modelDir.x, modelDir.z) / 6.28318530718 * float(u_impostorViews);
+    view = mod(view + float(u_impostorViews), float(u_impostorViews));
+    float view0 = floor(view);
+    float view1 = mod(view0 + 1.0, float(u_impostorViews));
+    viewBlend = view - view0;
+
+    float u = aQuad.x * 0.5 + 0.5;
+    texCoord0 = vec2((view0 + u) / float(u_impostorViews), aQuad.y);
+    texCoord1 = vec2((view1 + u) / float(u_impostorViews), aQuad.y);
+
+    gl_Position = u_projection * u_view * vec4(fragPos, 1.0);
+}
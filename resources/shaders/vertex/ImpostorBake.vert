@@ -0,0 +1,18 @@
+// Impostor Bake Vertex Shader, renders a Model into the ImpostorAtlas tiles
+#version 400 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 normal;
+out vec2 texCoord;
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+
+void main()
+{
+    normal = aNormal; // stays in model space, Impostor.frag rotates it per instance
+    texCoord = aTexCoord;
+    gl_Position = u_projection * u_view * vec4(aPos, 1.0);
+}
@@ -18,15 +18,29 @@ out vec2 texCoord;
 out vec3 tangent;
 out vec3 bitangent;
 out float fogDistance;
+flat out float impostorFade; // 0 = mesh only, 1 = impostor only
 
 uniform mat4 u_view;
 uniform mat4 u_projection;
 uniform vec3 u_camPos;
+uniform vec2 u_impostorFade; // distance the mesh starts and stops fading into the impostor, y = 0 = no impostor
 
 void main()
 {
     // Reconstruct instance model matrix from columns
     mat4 instanceModel = mat4(aInstanceRow0, aInstanceRow1, aInstanceRow2, aInstanceRow3);
+
+    // Per instance, so the whole instance fades with the same pattern as its impostor
+    impostorFade = 0.0;
+    if (u_impostorFade.y > 0.0)
+        impostorFade = clamp((length(u_camPos - instanceModel[3].xyz) - u_impostorFade.x) / (u_impostorFade.y - u_impostorFade.x), 0.0, 1.0);
+
+    // Completely replaced by the impostor, a degenerate triangle skips rasterization
+    if (impostorFade >= 1.0)
+    {
+        gl_Position = vec4(0.0);
+        return;
+    }
     
     fragPos = vec3(instanceModel * vec4(aPos, 1.0));
     normal = mat3(transpose(inverse(instanceModel))) * aNormal;
@@ -1,13 +1,12 @@
 // Terrain Vertex Shader with height-based texture blending
 #version 400 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec3 aNormal; // unused, normals come from derivatives in TerrainBlend.frag
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in float aHeight;
 layout (location = 4) in float aWaterMask;
 
 out vec3 fragPos;
-out vec3 normal;
 out vec2 texCoord;
 out float height;
 out float waterMask;
@@ -21,7 +20,6 @@ uniform vec3 u_camPos;
 void main()
 {
     fragPos = vec3(u_model * vec4(aPos, 1.0));
-    normal = mat3(transpose(inverse(u_model))) * aNormal;
     texCoord = aTexCoord;
     height = aHeight;
     waterMask = aWaterMask;
@@ -0,0 +1,42 @@
+// Terrain Vertex Shader for TC_GPU_DISPLACEMENT, every chunk draws the same flat grid
+// and takes its heights from its layer of u_heightMaps. Same outputs as Terrain.vert (used with TerrainBlend.frag)
+#version 400 core
+layout (location = 0) in vec2 aLocalXZ; // chunk local x/z in world units
+layout (location = 2) in vec2 aFlags;   // x = water mask, y = 1 for skirt vertices
+
+out vec3 fragPos;
+out vec2 texCoord;
+out float height;
+out float waterMask;
+out float fogDistance;
+out vec3 splatCoord; // TerrainSplat.frag
+
+uniform mat4 u_model; // chunk origin
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform vec3 u_camPos;
+
+uniform sampler2DArray u_heightMaps; // unscaled perlin heights, one texel per grid vertex
+uniform int u_heightLayer;           // layer of this chunk
+uniform float u_vertexStep;          // TerrainConfig::vertexStep
+uniform float u_heightScale;         // perlin height -> world units
+uniform float u_skirtDepth;          // TerrainConfig::lodSkirtDepth
+uniform float u_splatSize;           // texels per side of a splat layer, the same as the height map
+uniform int u_splatLayer;            // layer of this chunk
+
+void main()
+{
+    ivec2 texel = ivec2(aLocalXZ / u_vertexStep + 0.5);
+    height = texelFetch(u_heightMaps, ivec3(texel, u_heightLayer), 0).r;
+    vec3 localPos = vec3(aLocalXZ.x, height * u_heightScale - aFlags.y * u_skirtDepth, aLocalXZ.y);
+
+    fragPos = vec3(u_model * vec4(localPos, 1.0));
+    texCoord = fragPos.xz / 10.0;
+    waterMask = aFlags.x;
+    splatCoord = vec3((vec2(texel) + 0.5) / u_splatSize, float(u_splatLayer));
+    
+    // Calculate distance from camera for fog
+    fogDistance = length(u_camPos - fragPos);
+    
+    gl_Position = u_projection * u_view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,41 @@
+// Terrain Vertex Shader for TerrainVertexPacked chunk vertices (8 bytes each)
+// Same outputs as Terrain.vert so it is used together with TerrainBlend.frag
+#version 400 core
+layout (location = 0) in vec2 aLocalXZ;   // chunk local x/z in world units
+layout (location = 1) in float aHeight;   // 0-1 over u_heightRange
+layout (location = 2) in vec2 aFlags;     // x = water mask, y = 1 for skirt vertices
+
+out vec3 fragPos;
+out vec2 texCoord;
+out float height;
+out float waterMask;
+out float fogDistance;
+out vec3 splatCoord; // TerrainSplat.frag
+
+uniform mat4 u_model; // chunk origin
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform vec3 u_camPos;
+
+uniform vec2 u_heightRange;  // TC_PACKED_HEIGHT_MIN, TC_PACKED_HEIGHT_MAX
+uniform float u_heightScale; // perlin height -> world units
+uniform float u_skirtDepth;  // TerrainConfig::lodSkirtDepth
+uniform float u_vertexStep;  // TerrainConfig::vertexStep
+uniform float u_splatSize;   // texels per side of a splat layer, one per grid vertex
+uniform int u_splatLayer;    // layer of this chunk
+
+void main()
+{
+    height = mix(u_heightRange.x, u_heightRange.y, aHeight);
+    vec3 localPos = vec3(aLocalXZ.x, height * u_heightScale - aFlags.y * u_skirtDepth, aLocalXZ.y);
+
+    fragPos = vec3(u_model * vec4(localPos, 1.0));
+    texCoord = fragPos.xz / 10.0;
+    waterMask = aFlags.x;
+    splatCoord = vec3((aLocalXZ / u_vertexStep + 0.5) / u_splatSize, float(u_splatLayer));
+    
+    // Calculate distance from camera for fog
+    fogDistance = length(u_camPos - fragPos);
+    
+    gl_Position = u_projection * u_view * vec4(fragPos, 1.0);
+}
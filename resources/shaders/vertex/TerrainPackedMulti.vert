@@ -0,0 +1,49 @@
+// Terrain Vertex Shader for chunks in the ChunkMegaBuffer (TerrainVertexPacked, 8 bytes each)
+// Same as TerrainPacked.vert, but all chunks are drawn in one glMultiDrawElementsBaseVertex so
+// the chunk origin comes from the ChunkData block instead of u_model
+#version 400 core
+layout (location = 0) in vec2 aLocalXZ;   // chunk local x/z in world units
+layout (location = 1) in float aHeight;   // 0-1 over u_heightRange
+layout (location = 2) in vec2 aFlags;     // x = water mask, y = 1 for skirt vertices
+
+out vec3 fragPos;
+out vec2 texCoord;
+out float height;
+out float waterMask;
+out float fogDistance;
+out vec3 splatCoord; // TerrainSplat.frag
+
+// One entry per mega buffer slot, xyz = chunk origin, w = splat layer. Size must match TC_MEGA_BUFFER_SLOTS
+layout (std140) uniform ChunkData
+{
+    vec4 u_chunkOrigins[1024];
+};
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform vec3 u_camPos;
+
+uniform int u_verticesPerChunk; // vertices per mega buffer slot
+uniform vec2 u_heightRange;     // TC_PACKED_HEIGHT_MIN, TC_PACKED_HEIGHT_MAX
+uniform float u_heightScale;    // perlin height -> world units
+uniform float u_skirtDepth;     // TerrainConfig::lodSkirtDepth
+uniform float u_vertexStep;     // TerrainConfig::vertexStep
+uniform float u_splatSize;      // texels per side of a splat layer, one per grid vertex
+
+void main()
+{
+    // gl_VertexID includes the base vertex of the draw, which is slot * u_verticesPerChunk
+    vec4 chunkData = u_chunkOrigins[gl_VertexID / u_verticesPerChunk];
+    vec3 origin = chunkData.xyz;
+
+    height = mix(u_heightRange.x, u_heightRange.y, aHeight);
+    fragPos = origin + vec3(aLocalXZ.x, height * u_heightScale - aFlags.y * u_skirtDepth, aLocalXZ.y);
+    texCoord = fragPos.xz / 10.0;
+    waterMask = aFlags.x;
+    splatCoord = vec3((aLocalXZ / u_vertexStep + 0.5) / u_splatSize, chunkData.w);
+
+    // Calculate distance from camera for fog
+    fogDistance = length(u_camPos - fragPos);
+
+    gl_Position = u_projection * u_view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,23 @@
+// Water Vertex Shader for WaterRenderer
+// A fixed grid in cell units, moved to the camera by u_offset and scaled by u_cellSize
+#version 400 core
+layout (location = 0) in vec2 aCell; // local x/z in grid cells
+
+out vec3 fragPos;
+out vec2 texCoord;
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+
+uniform vec2 u_offset;    // camera position snapped to whole cells
+uniform float u_cellSize; // world units per cell
+uniform float u_seaLevel;
+
+void main()
+{
+    vec2 worldXZ = u_offset + aCell * u_cellSize;
+    fragPos = vec3(worldXZ.x, u_seaLevel, worldXZ.y);
+    texCoord = worldXZ / 10.0; // same as the terrain shaders
+
+    gl_Position = u_projection * u_view * vec4(fragPos, 1.0);
+}
@@ -97,5 +97,6 @@ std::unique_ptr<AnimatedInstanceFrame> AnimatedInstanceRenderer::createAnimatedI
 	std::unique_ptr<Model> model = std::make_unique<Model>(modelPath, overrideTexture);
 
 	frame->m_InstancedRenderer.init(std::move(model));
+	frame->m_InstancedRenderer.enableGpuCulling(); // keeps drawing every instance if the GL version is too old
 	return frame;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "Common.h"
 #include "Input/UserInput.h"
+#include "Frustum.h"
 
 // // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 // enum Camera_Movement
@@ -46,6 +47,12 @@ public:
 		return glm::perspective(glm::radians(m_Config.fov), m_Config.aspect, m_Config.near, m_Config.far);
 	};
 
+	// Frustum planes in world space, for culling
+	Frustum getFrustum() const
+	{
+		return Frustum::fromMatrix(getProjectionMatrix() * getViewMatrix());
+	}
+
 
 	//move the camera around a target point based on user input
     void orbitControl(InputManager *inputManager, float deltaTime);
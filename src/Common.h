@@ -21,6 +21,7 @@
 namespace fs = std::filesystem;
 inline const fs::path VERTEX_SHADER_DIR = fs::path("resources") / "shaders" / "vertex";
 inline const fs::path FRAGMENT_SHADER_DIR = fs::path("resources") / "shaders" / "fragment";
+inline const fs::path COMPUTE_SHADER_DIR = fs::path("resources") / "shaders" / "compute";
 
 inline const fs::path TEXTURE_DIR = fs::path("resources") / "textures";
 
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as 6 planes (ax + by + cz + d >= 0 is inside), used to skip things that are off screen
+struct Frustum
+{
+    glm::vec4 planes[6]; // left, right, bottom, top, near, far
+
+    // Gribb/Hartmann plane extraction from a projection * view matrix
+    static Frustum fromMatrix(const glm::mat4 &viewProjection)
+    {
+        // glm is column major, m[c][r]. Build the rows
+        glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+        glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+        glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+        glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+        Frustum f;
+        f.planes[0] = row3 + row0;
+        f.planes[1] = row3 - row0;
+        f.planes[2] = row3 + row1;
+        f.planes[3] = row3 - row1;
+        f.planes[4] = row3 + row2;
+        f.planes[5] = row3 - row2;
+        return f;
+    }
+
+    // False only if the box is completely outside one of the planes (conservative, may keep some boxes that are just outside a corner)
+    bool intersectsAABB(const glm::vec3 &min, const glm::vec3 &max) const
+    {
+        for (const glm::vec4 &p : planes)
+        {
+            // The box corner furthest along the plane normal
+            glm::vec3 positive(p.x >= 0.0f ? max.x : min.x,
+                               p.y >= 0.0f ? max.y : min.y,
+                               p.z >= 0.0f ? max.z : min.z);
+            if (glm::dot(glm::vec3(p), positive) + p.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
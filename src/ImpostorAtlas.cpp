@@ -0,0 +1,157 @@
+#include "ImpostorAtlas.h"
+#include "MeshRenderable.h"
+#include "VertexBufferLayout.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+ImpostorAtlas::ImpostorAtlas(const Model &model, int viewCount, int tileSize)
+    : m_viewCount(viewCount)
+{
+    const ModelData *data = model.getModelData().get();
+    assert(data && "ImpostorAtlas needs a loaded model");
+
+    // The quad stands on the model's up axis and is wide enough for every view direction
+    glm::vec3 size = data->m_boundsMax - data->m_boundsMin;
+    m_center = glm::vec3((data->m_boundsMin.x + data->m_boundsMax.x) * 0.5f, 0.0f, (data->m_boundsMin.z + data->m_boundsMax.z) * 0.5f);
+    m_radius = glm::length(glm::vec2(size.x, size.z)) * 0.5f;
+    m_heightRange = glm::vec2(data->m_boundsMin.y, data->m_boundsMax.y);
+
+    const float quad[] = {
+        -1.0f, 0.0f,
+        1.0f, 0.0f,
+        -1.0f, 1.0f,
+        1.0f, 1.0f};
+    const unsigned short indices[] = {0, 1, 2, 2, 1, 3};
+
+    m_vertexArray = std::make_unique<VertexArray>();
+    m_vertexBuffer = std::make_unique<VertexBuffer>(quad, sizeof(quad), m_vertexArray.get());
+    VertexBufferLayout layout;
+    layout.push<float>(2);
+    m_vertexArray->addBuffer(m_vertexBuffer.get(), layout);
+    m_indexBuffer = std::make_unique<IndexBuffer>(indices, 6); // VAO is still bound, so it keeps this IBO
+
+    bake(model, tileSize);
+}
+
+void ImpostorAtlas::bake(const Model &model, int tileSize)
+{
+    const int width = tileSize * m_viewCount;
+    m_diffuse = Texture::CreateRenderTexture2D(width, tileSize, "u_impostorDiffuse");
+    m_ambient = Texture::CreateRenderTexture2D(width, tileSize, "u_impostorAmbient");
+    m_normal = Texture::CreateRenderTexture2D(width, tileSize, "u_impostorNormal");
+
+    GLuint fbo, depth;
+    GLCALL(glGenFramebuffers(1, &fbo));
+    GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    GLCALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_diffuse->getID(), 0));
+    GLCALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_ambient->getID(), 0));
+    GLCALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_normal->getID(), 0));
+    GLCALL(glGenRenderbuffers(1, &depth));
+    GLCALL(glBindRenderbuffer(GL_RENDERBUFFER, depth));
+    GLCALL(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, tileSize));
+    GLCALL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth));
+    const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+    GLCALL(glDrawBuffers(3, drawBuffers));
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        DEBUG_PRINT("Impostor framebuffer incomplete, impostors will be empty");
+    }
+    else
+    {
+        // Render state the bake needs, put back afterwards
+        GLint viewport[4];
+        GLfloat clearColor[4];
+        GLCALL(glGetIntegerv(GL_VIEWPORT, viewport));
+        GLCALL(glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor));
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        GLCALL(glEnable(GL_DEPTH_TEST));
+        GLCALL(glDisable(GL_CULL_FACE)); // leaves and such are often single sided
+        GLCALL(glDisable(GL_BLEND));
+
+        // Transparent black everywhere the model is not, alpha is the coverage
+        GLCALL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+        GLCALL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+        Shader bakeShader;
+        bakeShader.addShader("ImpostorBake.vert", ShaderType::VERTEX);
+        bakeShader.addShader("ImpostorBake.frag", ShaderType::FRAGMENT);
+        bakeShader.createProgram();
+        bakeShader.bind();
+
+        const float distance = m_radius + 1.0f;
+        glm::mat4 projection = glm::ortho(-m_radius, m_radius, m_heightRange.x, m_heightRange.y, 0.0f, 2.0f * distance);
+        bakeShader.setUniform("u_projection", projection);
+
+        // View k looks at the model from direction (sin a, 0, cos a), a = 2 pi k / viewCount. Impostor.vert picks tiles the same way.
+        for (int k = 0; k < m_viewCount; k++)
+        {
+            float angle = glm::two_pi<float>() * (float)k / (float)m_viewCount;
+            glm::vec3 direction(std::sin(angle), 0.0f, std::cos(angle));
+            glm::mat4 view = glm::lookAt(m_center + direction * distance, m_center, glm::vec3(0.0f, 1.0f, 0.0f));
+            bakeShader.setUniform("u_view", view);
+            GLCALL(glViewport(k * tileSize, 0, tileSize, tileSize));
+
+            for (const auto &mr : model.getModelData()->getMeshRenderables())
+            {
+                Mesh *mesh = mr->getMesh();
+                if (!mesh || !mesh->indexBuffer)
+                    continue;
+
+                // Only the colors, the impostor is lit without specular
+                for (const auto &[name, value] : mr->getUniforms())
+                {
+                    if (name == "u_material_ambient" || name == "u_material_diffuse")
+                        std::visit([&, name](auto &&v)
+                                   { bakeShader.setUniform(name, v); }, value);
+                }
+
+                bakeShader.setUniform("u_hasTexture", mr->m_textureReferences.empty() ? 0 : 1);
+                for (const auto &texture : mr->m_textureReferences)
+                {
+                    texture->bindNew(texture->getID() % REQUIRED_NUM_TEXTURE_UNITS);
+                    bakeShader.setUniform("u_texture_diffuse", texture->getSlot());
+                }
+
+                mesh->vertexArray->bind();
+                mesh->indexBuffer->bind();
+                GLCALL(glDrawElements(GL_TRIANGLES, mesh->indexBuffer->getCount(), mesh->indexBuffer->getType(), nullptr));
+            }
+        }
+
+        GLCALL(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+        GLCALL(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+        if (!depthTest)
+            glDisable(GL_DEPTH_TEST);
+        if (cullFace)
+            glEnable(GL_CULL_FACE);
+        if (blend)
+            glEnable(GL_BLEND);
+    }
+
+    // Only the textures are kept
+    GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    GLCALL(glDeleteRenderbuffers(1, &depth));
+    GLCALL(glDeleteFramebuffers(1, &fbo));
+}
+
+void ImpostorAtlas::bind(Shader &shader) const
+{
+    RenderingContext *rContext = RenderingContext::Current();
+    for (const auto &texture : {m_diffuse, m_ambient, m_normal})
+    {
+        if (rContext->m_boundTextures[texture->getSlot()] != texture->getID())
+            texture->bindNew(texture->getID() % REQUIRED_NUM_TEXTURE_UNITS);
+        shader.setUniform(texture->m_targetUniform, texture->getSlot());
+    }
+
+    shader.setUniform("u_impostorCenter", m_center);
+    shader.setUniform("u_impostorRadius", m_radius);
+    shader.setUniform("u_impostorHeight", m_heightRange);
+    shader.setUniform("u_impostorViews", m_viewCount);
+
+    if (rContext->m_boundVAO != m_vertexArray->getID())
+        m_vertexArray->bind();
+}
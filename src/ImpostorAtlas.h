@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Common.h"
+#include "Model.h"
+#include "Texture.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+
+#include <memory>
+
+/**
+ * @brief A Model baked from several directions into textures, drawn as a camera facing quad far away.
+ *
+ * The model is rendered with an orthographic camera from viewCount directions around its up axis
+ * (one tile per direction, side by side) into three atlases: diffuse color + coverage, ambient color
+ * and model space normal. The impostor shader picks the tiles closest to the view direction and
+ * lights them like the mesh, so rotated and scaled instances still look right.
+ *
+ * Baked once in the constructor (needs a current GL context), the quad is drawn by InstancedRenderer.
+ */
+class ImpostorAtlas
+{
+public:
+    ImpostorAtlas(const Model &model, int viewCount = 8, int tileSize = 128);
+
+    ImpostorAtlas(const ImpostorAtlas &) = delete;
+    ImpostorAtlas &operator=(const ImpostorAtlas &) = delete;
+
+    int getViewCount() const { return m_viewCount; }
+
+    // Bind the atlases and quad uniforms to shader (bound), then the quad VAO for an instanced draw
+    void bind(Shader &shader) const;
+    const IndexBuffer &getIndexBuffer() const { return *m_indexBuffer; }
+    const VertexArray &getVertexArray() const { return *m_vertexArray; }
+
+private:
+    int m_viewCount;
+
+    // Quad extent in model space: base center on the up axis, half width and the height range
+    glm::vec3 m_center;
+    float m_radius;
+    glm::vec2 m_heightRange;
+
+    std::shared_ptr<Texture> m_diffuse;
+    std::shared_ptr<Texture> m_ambient;
+    std::shared_ptr<Texture> m_normal;
+
+    // Unit quad, x in [-1, 1] and y in [0, 1]
+    std::unique_ptr<VertexArray> m_vertexArray;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<IndexBuffer> m_indexBuffer;
+
+    void bake(const Model &model, int tileSize);
+};
@@ -8,13 +8,21 @@
  * @param usage a hint to the GL implementation of how the data is going to be used (e.g. rendered once and never again, or rendered very many times and changed frequently)
  */
 IndexBuffer::IndexBuffer(const unsigned int *data, unsigned int count, BufferUsage usage)
-    : m_Count(count)
+    : m_Count(count), m_Type(GL_UNSIGNED_INT)
 {
     GLCALL(glGenBuffers(1, &m_RendererID));
     GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));
     GLCALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, static_cast<GLenum>(usage)));    
 }
 
+IndexBuffer::IndexBuffer(const unsigned short *data, unsigned int count, BufferUsage usage)
+    : m_Count(count), m_Type(GL_UNSIGNED_SHORT)
+{
+    GLCALL(glGenBuffers(1, &m_RendererID));
+    GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));
+    GLCALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned short), data, static_cast<GLenum>(usage)));
+}
+
 IndexBuffer::~IndexBuffer()
 {
 //     DEBUG_PRINT("Deleting IndexBuffer with ID: " << m_RendererID);
@@ -7,9 +7,13 @@ class IndexBuffer
 private:
     GLuint m_RendererID; // Unique ID for the buffer
     unsigned int m_Count; // Number of indices
+    GLenum m_Type;        // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
 public:
     
     IndexBuffer(const unsigned int *data, unsigned int count, BufferUsage usage = BufferUsage::STATIC_DRAW);
+
+    // 16-bit indices, for meshes with at most 65536 vertices (e.g. terrain chunks)
+    IndexBuffer(const unsigned short *data, unsigned int count, BufferUsage usage = BufferUsage::STATIC_DRAW);
     
     template<typename T>
     IndexBuffer(const std::vector<T>& data, BufferUsage usage = BufferUsage::STATIC_DRAW)
@@ -22,4 +26,6 @@ public:
     void bind() const;
     void unbind() const;
     inline unsigned int getCount() const { return m_Count; }
+    // Index type to pass to glDrawElements
+    inline GLenum getType() const { return m_Type; }
 };
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "InstancedRenderer.h"
+#include "ImpostorAtlas.h"
 #include "MeshRenderable.h"
 #include "RenderingContext.h"
+#include "Frustum.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <iostream>
 
 InstancedRenderer::InstancedRenderer()
@@ -14,6 +17,11 @@ InstancedRenderer::~InstancedRenderer()
     {
         glDeleteBuffers(1, &m_instanceVBO);
     }
+    if (m_visibleVBO != 0)
+    {
+        glDeleteBuffers(1, &m_visibleVBO);
+        glDeleteBuffers(1, &m_commandBuffer);
+    }
 }
 
 void InstancedRenderer::init(std::unique_ptr<Model> model)
@@ -24,10 +32,11 @@ void InstancedRenderer::init(std::unique_ptr<Model> model)
     m_instancedShader->addShader("Instanced.vert", ShaderType::VERTEX);
 
     // DEBUG_PRINT("modelpath " << m_sourceModel->m_modelPath << " model has texture diffuse: " << m_sourceModel->getModelData()->m_hasTextureDiffuse);
+    // The FADE variants dissolve into the impostor (enableImpostors), without impostors they are the plain ones
     if (m_sourceModel->getModelData()->m_hasTextureDiffuse)
-        m_instancedShader->addShader("PhongMTL_FOG_diffTEX.frag", ShaderType::FRAGMENT);
+        m_instancedShader->addShader("PhongMTL_FOG_FADE_diffTEX.frag", ShaderType::FRAGMENT);
     else
-        m_instancedShader->addShader("PhongMTL_FOG.frag", ShaderType::FRAGMENT);
+        m_instancedShader->addShader("PhongMTL_FOG_FADE.frag", ShaderType::FRAGMENT);
 
     m_instancedShader->createProgram();
 
@@ -35,20 +44,299 @@ void InstancedRenderer::init(std::unique_ptr<Model> model)
     glGenBuffers(1, &m_instanceVBO);
 }
 
+void InstancedRenderer::enableImpostors(float fadeStart, float fadeEnd, int viewCount, int tileSize)
+{
+    assert(m_sourceModel && fadeEnd > fadeStart);
+
+    if (!m_impostor)
+    {
+        m_impostor = std::make_unique<ImpostorAtlas>(*m_sourceModel, viewCount, tileSize);
+        m_impostorShader = std::make_shared<Shader>();
+        m_impostorShader->addShader("Impostor.vert", ShaderType::VERTEX);
+        m_impostorShader->addShader("Impostor.frag", ShaderType::FRAGMENT);
+        m_impostorShader->createProgram();
+    }
+    m_impostorFade = glm::vec2(fadeStart, fadeEnd);
+    m_commandsDirty = true;
+}
+
+void InstancedRenderer::disableImpostors()
+{
+    m_impostor.reset();
+    m_impostorShader.reset();
+    m_impostorFade = glm::vec2(0.0f);
+    m_commandsDirty = true;
+}
+
+bool InstancedRenderer::enableGpuCulling()
+{
+    assert(m_sourceModel);
+
+    if (!GLAD_GL_VERSION_4_3)
+    {
+        DEBUG_PRINT("GPU instance culling needs OpenGL 4.3, drawing every instance instead");
+        return false;
+    }
+
+    const ModelData *data = m_sourceModel->getModelData().get();
+    for (const auto &mr : data->getMeshRenderables())
+    {
+        if (mr->getMesh() && !mr->getMesh()->indexBuffer)
+            return false;
+    }
+
+    // Sphere around the bounding box, scaled with the instance in the shader
+    m_boundingSphere = glm::vec4((data->m_boundsMin + data->m_boundsMax) * 0.5f,
+                                 glm::length(data->m_boundsMax - data->m_boundsMin) * 0.5f);
+
+    m_cullShader = std::make_shared<Shader>();
+    m_cullShader->addShader("InstanceCull.comp", ShaderType::COMPUTE);
+    m_cullShader->createProgram();
+
+    glGenBuffers(1, &m_visibleVBO);
+    glGenBuffers(1, &m_commandBuffer);
+    return true;
+}
+
+void InstancedRenderer::cullInstances(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &camPos)
+{
+    const auto &meshRenderables = m_sourceModel->getModelData()->getMeshRenderables();
+
+    // Room for every instance in both lists
+    if (m_visibleCapacity != m_capacity)
+    {
+        m_visibleCapacity = m_capacity;
+        glBindBuffer(GL_ARRAY_BUFFER, m_visibleVBO);
+        glBufferData(GL_ARRAY_BUFFER, 2 * m_visibleCapacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_commandsDirty = true; // the impostors start at the capacity
+    }
+
+    // Instance counts start at zero, the shader counts them up. The command buffer is only reallocated
+    // when the commands change, every other frame just the zeroed commands are written over it.
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+    if (m_commandsDirty)
+    {
+        m_commands.clear();
+        for (const auto &mr : meshRenderables)
+        {
+            Mesh *mesh = mr->getMesh();
+            m_commands.push_back({mesh ? mesh->indexBuffer->getCount() : 0u, 0, 0, 0, 0});
+        }
+        if (m_impostor)
+            m_commands.push_back({m_impostor->getIndexBuffer().getCount(), 0, 0, 0, static_cast<GLuint>(m_visibleCapacity)});
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_DYNAMIC_DRAW);
+        m_commandsDirty = false;
+    }
+    else
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    static const char *planeNames[6] = {"u_frustumPlanes[0]", "u_frustumPlanes[1]", "u_frustumPlanes[2]",
+                                        "u_frustumPlanes[3]", "u_frustumPlanes[4]", "u_frustumPlanes[5]"};
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    m_cullShader->bind();
+    for (int i = 0; i < 6; i++)
+    {
+        // Normalized so the distance can be compared to the radius
+        m_cullShader->setUniform(planeNames[i], frustum.planes[i] / glm::length(glm::vec3(frustum.planes[i])));
+    }
+    m_cullShader->setUniform("u_instanceCount", static_cast<int>(m_instanceTransforms.size()));
+    m_cullShader->setUniform("u_boundingSphere", m_boundingSphere);
+    m_cullShader->setUniform("u_camPos", camPos);
+    m_cullShader->setUniform("u_impostorFade", m_impostor ? m_impostorFade : glm::vec2(0.0f));
+    m_cullShader->setUniform("u_impostorOffset", static_cast<int>(m_visibleCapacity));
+    m_cullShader->setUniform("u_impostorCommand", static_cast<int>(meshRenderables.size()));
+
+    Shader::bindStorageBuffer(0, m_instanceVBO);
+    Shader::bindStorageBuffer(1, m_visibleVBO);
+    Shader::bindStorageBuffer(2, m_commandBuffer);
+    m_cullShader->dispatchCompute(static_cast<GLuint>((m_instanceTransforms.size() + 63) / 64));
+
+    // The other meshes draw the same instances as the first one, copy its count over on the GPU
+    if (meshRenderables.size() > 1)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+        for (size_t i = 1; i < meshRenderables.size(); i++)
+        {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                offsetof(DrawElementsIndirectCommand, instanceCount),
+                                i * sizeof(DrawElementsIndirectCommand) + offsetof(DrawElementsIndirectCommand, instanceCount),
+                                sizeof(GLuint));
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void InstancedRenderer::bindInstanceAttributes(GLuint buffer) const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    // mat4 takes 4 vertex attribute slots (locations 5, 6, 7, 8)
+    for (int i = 0; i < 4; i++)
+    {
+        GLuint loc = 5 + i;
+        glEnableVertexAttribArray(loc);
+        glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void *)(sizeof(glm::vec4) * i));
+        glVertexAttribDivisor(loc, 1); // One per instance
+    }
+}
+
+void InstancedRenderer::unbindInstanceAttributes() const
+{
+    for (int i = 0; i < 4; i++)
+    {
+        glDisableVertexAttribArray(5 + i);
+    }
+}
+
 void InstancedRenderer::clearInstances()
 {
     m_instanceTransforms.clear();
+    m_ranges.clear();
+    m_freeHandles.clear();
+    m_holes.clear();
+    m_holeInstances = 0;
     m_dirty = true;
 }
 
-void InstancedRenderer::addInstance(const glm::vec3 &position, float scale, float rotationY)
+int InstancedRenderer::addRange(const std::vector<glm::mat4> &transforms)
+{
+    InstanceRange range;
+    range.count = transforms.size();
+    range.live = true;
+    range.offset = m_instanceTransforms.size();
+
+    // First hole big enough, the rest of it stays a hole
+    for (size_t i = 0; i < m_holes.size(); i++)
+    {
+        if (m_holes[i].count < range.count)
+            continue;
+        range.offset = m_holes[i].offset;
+        m_holes[i].offset += range.count;
+        m_holes[i].count -= range.count;
+        m_holeInstances -= range.count;
+        if (m_holes[i].count == 0)
+        {
+            m_holes[i] = m_holes.back();
+            m_holes.pop_back();
+        }
+        break;
+    }
+
+    if (range.offset + range.count > m_instanceTransforms.size())
+        m_instanceTransforms.resize(range.offset + range.count);
+    std::copy(transforms.begin(), transforms.end(), m_instanceTransforms.begin() + range.offset);
+    uploadRange(range.offset, range.count);
+
+    int handle;
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+        m_ranges[handle] = range;
+    }
+    else
+    {
+        handle = (int)m_ranges.size();
+        m_ranges.push_back(range);
+    }
+    return handle;
+}
+
+void InstancedRenderer::removeRange(int handle)
+{
+    assert(handle >= 0 && handle < (int)m_ranges.size() && m_ranges[handle].live);
+    InstanceRange &range = m_ranges[handle];
+    range.live = false;
+    m_freeHandles.push_back(handle);
+
+    if (range.offset + range.count == m_instanceTransforms.size())
+    {
+        // Last range, just shorten the buffer (and drop holes that are now at the end too)
+        m_instanceTransforms.resize(range.offset);
+        bool shrunk = true;
+        while (shrunk)
+        {
+            shrunk = false;
+            for (size_t i = 0; i < m_holes.size(); i++)
+            {
+                if (m_holes[i].offset + m_holes[i].count != m_instanceTransforms.size())
+                    continue;
+                m_instanceTransforms.resize(m_holes[i].offset);
+                m_holeInstances -= m_holes[i].count;
+                m_holes[i] = m_holes.back();
+                m_holes.pop_back();
+                shrunk = true;
+                break;
+            }
+        }
+        return;
+    }
+
+    // Zero matrices put every vertex at the origin with w = 0, nothing gets rasterized
+    std::fill(m_instanceTransforms.begin() + range.offset, m_instanceTransforms.begin() + range.offset + range.count, glm::mat4(0.0f));
+    uploadRange(range.offset, range.count);
+    m_holes.push_back(range);
+    m_holeInstances += range.count;
+}
+
+void InstancedRenderer::uploadRange(size_t offset, size_t count)
+{
+    // Doesnt fit (or a full upload is pending anyway), render uploads everything
+    if (m_dirty || offset + count > m_capacity)
+    {
+        m_dirty = true;
+        return;
+    }
+    if (count == 0)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(glm::mat4), count * sizeof(glm::mat4), &m_instanceTransforms[offset]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_uploadedInstances += count;
+}
+
+void InstancedRenderer::compactRanges()
+{
+    std::vector<glm::mat4> compacted;
+    compacted.reserve(m_instanceTransforms.size() - m_holeInstances);
+    for (InstanceRange &range : m_ranges)
+    {
+        if (!range.live)
+            continue;
+        compacted.insert(compacted.end(), m_instanceTransforms.begin() + range.offset, m_instanceTransforms.begin() + range.offset + range.count);
+        range.offset = compacted.size() - range.count;
+    }
+
+    m_instanceTransforms = std::move(compacted);
+    m_holes.clear();
+    m_holeInstances = 0;
+    m_dirty = true;
+}
+
+glm::mat4 InstancedRenderer::makeTransform(const glm::vec3 &position, float scale, float rotationY)
 {
     glm::mat4 transform(1.0f);
     transform = glm::translate(transform, position);
     transform = glm::rotate(transform, glm::radians(rotationY), glm::vec3(0.0f, 1.0f, 0.0f));
     transform = glm::scale(transform, glm::vec3(scale));
+    return transform;
+}
 
-    m_instanceTransforms.push_back(transform);
+void InstancedRenderer::addInstance(const glm::vec3 &position, float scale, float rotationY)
+{
+    m_instanceTransforms.push_back(makeTransform(position, scale, rotationY));
     m_dirty = true;
 }
 
@@ -58,11 +346,16 @@ void InstancedRenderer::uploadInstanceData()
     assert(m_dirty && !m_instanceTransforms.empty());
 #endif
 
+    // Room to grow, so ranges added later can go in with glBufferSubData
+    if (m_instanceTransforms.size() > m_capacity || m_capacity == 0)
+    {
+        m_capacity = std::max<size_t>(m_instanceTransforms.size() * 2, 256);
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER,
-                 m_instanceTransforms.size() * sizeof(glm::mat4),
-                 m_instanceTransforms.data(),
-                 GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_instanceTransforms.size() * sizeof(glm::mat4), m_instanceTransforms.data());
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     m_dirty = false;
@@ -77,6 +370,10 @@ void InstancedRenderer::setFogUniforms(const glm::vec3 &fogColor, float fogStart
 
 void InstancedRenderer::render(const glm::mat4 view, const glm::mat4 projection, const PhongLightConfig *phongLight)
 {
+    // Mostly holes, not worth drawing them anymore
+    if (m_holeInstances * 2 > m_instanceTransforms.size())
+        compactRanges();
+
     if (!m_sourceModel || m_instanceTransforms.empty())
         return;
 
@@ -86,14 +383,21 @@ void InstancedRenderer::render(const glm::mat4 view, const glm::mat4 projection,
 
     // TODO: bind textures from the model's mesh renderables
 
+    // Camera position for fog
+    glm::vec3 camPos = glm::vec3(glm::inverse(view)[3]);
+
+    // With GPU culling only the visible instances are drawn, the counts never come back to the CPU
+    const bool gpuCulling = m_cullShader != nullptr;
+    if (gpuCulling)
+        cullInstances(view, projection, camPos);
+    const GLuint instanceBuffer = gpuCulling ? m_visibleVBO : m_instanceVBO;
+
     m_instancedShader->bind();
 
     // Set common uniforms
     m_instancedShader->setUniform("u_view", view);
     m_instancedShader->setUniform("u_projection", projection);
 
-    // Camera position for fog
-    glm::vec3 camPos = glm::vec3(glm::inverse(view)[3]);
     m_instancedShader->setUniform("u_camPos", camPos);
 
     // Fog uniforms
@@ -101,6 +405,9 @@ void InstancedRenderer::render(const glm::mat4 view, const glm::mat4 projection,
     m_instancedShader->setUniform("u_fogStart", m_fogStart);
     m_instancedShader->setUniform("u_fogEnd", m_fogEnd);
 
+    // (0, 0) = never fade out
+    m_instancedShader->setUniform("u_impostorFade", m_impostor ? m_impostorFade : glm::vec2(0.0f));
+
     // Light uniforms
     if (phongLight)
     {
@@ -110,9 +417,14 @@ void InstancedRenderer::render(const glm::mat4 view, const glm::mat4 projection,
         m_instancedShader->setUniform("u_light_specular", phongLight->specularLight);
     }
 
+    if (gpuCulling)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+
     auto meshRenderables = m_sourceModel->getModelData()->getMeshRenderables();
-    for (const auto &mr : meshRenderables)
+    for (size_t i = 0; i < meshRenderables.size(); i++)
     {
+        const auto &mr = meshRenderables[i];
+
         // Get the mesh
         Mesh *mesh = mr->getMesh();
         if (!mesh)
@@ -142,25 +454,22 @@ void InstancedRenderer::render(const glm::mat4 view, const glm::mat4 projection,
         mesh->vertexArray->bind();
 
         // Setup instance attribute pointers (mat4 = 4 vec4s)
-        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        bindInstanceAttributes(instanceBuffer);
 
-        // mat4 takes 4 vertex attribute slots (locations 5, 6, 7, 8)
-        for (int i = 0; i < 4; i++)
+        // Draw instanced
+        if (gpuCulling)
         {
-            GLuint loc = 5 + i;
-            glEnableVertexAttribArray(loc);
-            glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
-                                  (void *)(sizeof(glm::vec4) * i));
-            glVertexAttribDivisor(loc, 1); // One per instance
+            // Command i of the cull pass (enableGpuCulling made sure there is an index buffer)
+            mesh->indexBuffer->bind();
+            glDrawElementsIndirect(GL_TRIANGLES, mesh->indexBuffer->getType(),
+                                   (const void *)(i * sizeof(DrawElementsIndirectCommand)));
         }
-
-        // Draw instanced
-        if (mesh->indexBuffer)
+        else if (mesh->indexBuffer)
         {
             mesh->indexBuffer->bind();
             glDrawElementsInstanced(GL_TRIANGLES,
                                     mesh->indexBuffer->getCount(),
-                                    GL_UNSIGNED_INT,
+                                    mesh->indexBuffer->getType(),
                                     nullptr,
                                     static_cast<GLsizei>(m_instanceTransforms.size()));
         }
@@ -172,11 +481,47 @@ void InstancedRenderer::render(const glm::mat4 view, const glm::mat4 projection,
         }
 
         // Cleanup instance attributes
-        for (int i = 0; i < 4; i++)
+        unbindInstanceAttributes();
+    }
+
+    // Far instances as quads, the vertex shader drops the ones that are still meshes
+    if (m_impostor)
+    {
+        m_impostorShader->bind();
+        m_impostorShader->setUniform("u_view", view);
+        m_impostorShader->setUniform("u_projection", projection);
+        m_impostorShader->setUniform("u_camPos", camPos);
+        m_impostorShader->setUniform("u_fogColor", m_fogColor);
+        m_impostorShader->setUniform("u_fogStart", m_fogStart);
+        m_impostorShader->setUniform("u_fogEnd", m_fogEnd);
+        m_impostorShader->setUniform("u_impostorFade", m_impostorFade);
+        if (phongLight)
         {
-            glDisableVertexAttribArray(5 + i);
+            m_impostorShader->setUniform("u_light_position", phongLight->lightPosition);
+            m_impostorShader->setUniform("u_light_ambient", phongLight->ambientLight);
+            m_impostorShader->setUniform("u_light_diffuse", phongLight->diffuseLight);
+        }
+
+        m_impostor->bind(*m_impostorShader);
+        bindInstanceAttributes(instanceBuffer);
+        if (gpuCulling)
+        {
+            // The last command, its base instance points at the impostor list
+            glDrawElementsIndirect(GL_TRIANGLES, m_impostor->getIndexBuffer().getType(),
+                                   (const void *)(meshRenderables.size() * sizeof(DrawElementsIndirectCommand)));
+        }
+        else
+        {
+            glDrawElementsInstanced(GL_TRIANGLES,
+                                    m_impostor->getIndexBuffer().getCount(),
+                                    m_impostor->getIndexBuffer().getType(),
+                                    nullptr,
+                                    static_cast<GLsizei>(m_instanceTransforms.size()));
         }
+        unbindInstanceAttributes();
     }
 
+    if (gpuCulling)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -11,6 +11,8 @@
 #include <memory>
 #include <glm/glm.hpp>
 
+class ImpostorAtlas;
+
 /**
  * @brief Renders many instances of a model in a single draw call using GPU instancing.
  *
@@ -26,12 +28,29 @@ public:
     // Initialize with the model to instance
     void init(std::unique_ptr<Model> model);
 
+    // Bake the model into an ImpostorAtlas (call after init). Instances further away than fadeStart
+    // dissolve into a camera facing quad, past fadeEnd only the quad is drawn. Only the first call
+    // bakes, later ones just move the fade band.
+    void enableImpostors(float fadeStart, float fadeEnd, int viewCount = 8, int tileSize = 128);
+
+    // Back to full meshes at any distance, frees the atlas
+    void disableImpostors();
+
+    // Cull the instances on the GPU (call after init): a compute shader frustum tests every instance,
+    // writes the visible ones to a second buffer and fills in indirect draw commands, so the CPU cost
+    // of render does not depend on the instance count. Needs GL 4.3, returns false (and keeps
+    // drawing every instance) if it is not available or the model has meshes without indices.
+    bool enableGpuCulling();
+
     // Clear all instances
     void clearInstances();
 
     // Add a model instance at the given position
     void addInstance(const glm::vec3 &position, float scale = 1.0f, float rotationY = 0.0f);
 
+    // The instance transform addInstance uses, rotationY in degrees
+    static glm::mat4 makeTransform(const glm::vec3 &position, float scale = 1.0f, float rotationY = 0.0f);
+
     // Upload instance data to GPU (call after adding all instances)        
     void uploadInstanceData();
 
@@ -41,13 +60,28 @@ public:
     // Set fog uniforms
     void setFogUniforms(const glm::vec3 &fogColor, float fogStart, float fogEnd);
 
-    // Get instance count
-    size_t getInstanceCount() const { return m_instanceTransforms.size(); }
+    // Get instance count (holes left by removeRange not included)
+    size_t getInstanceCount() const { return m_instanceTransforms.size() - m_holeInstances; }
 
     void replaceInstances(const std::vector<glm::mat4> &newTransforms)
     {
+        clearInstances();
         m_instanceTransforms = newTransforms;
-        m_dirty = true;
+    }
+
+    // Stable instance ranges, one per owner (e.g. a terrain chunk). Adding one only uploads that range
+    // (glBufferSubData), removing one leaves a hole that later ranges reuse. Holes are drawn as
+    // degenerate (all zero) instances until they make up half the buffer, then render compacts it.
+    // The returned handle stays valid until removeRange or clearInstances.
+    int addRange(const std::vector<glm::mat4> &transforms);
+    void removeRange(int range);
+
+    // Instances written with glBufferSubData since the last call, for profiling
+    size_t takeUploadedInstanceCount()
+    {
+        size_t count = m_uploadedInstances;
+        m_uploadedInstances = 0;
+        return count;
     }
 
 private:
@@ -63,6 +97,35 @@ private:
     // Instanced shader
     std::shared_ptr<Shader> m_instancedShader;
 
+    // Far distance quads (enableImpostors)
+    std::unique_ptr<ImpostorAtlas> m_impostor;
+    std::shared_ptr<Shader> m_impostorShader;
+    glm::vec2 m_impostorFade = glm::vec2(0.0f);
+
+    // GPU culling (enableGpuCulling)
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+    std::shared_ptr<Shader> m_cullShader;
+    GLuint m_visibleVBO = 0;     // visible meshes at the front, visible impostors from m_capacity
+    GLuint m_commandBuffer = 0;  // one command per mesh, then the impostor
+    size_t m_visibleCapacity = 0;
+    glm::vec4 m_boundingSphere = glm::vec4(0.0f); // model space center and radius
+    std::vector<DrawElementsIndirectCommand> m_commands; // instance counts are zero, reset every frame
+    bool m_commandsDirty = true;                         // rebuild m_commands and reallocate m_commandBuffer (capacity or impostor changed)
+
+    // Run the cull shader over all instances, afterwards the commands are ready to draw from m_visibleVBO
+    void cullInstances(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &camPos);
+
+    // Point instance attributes 5-8 of the bound VAO at buffer
+    void bindInstanceAttributes(GLuint buffer) const;
+    void unbindInstanceAttributes() const;
+
     // Fog parameters
     glm::vec3 m_fogColor = glm::vec3(0.5f, 0.9f, 0.95f);
     float m_fogStart = 80.0f;
@@ -70,4 +133,25 @@ private:
 
     // Whether instance data needs re-upload
     bool m_dirty = true;
+
+    // Instances the GPU buffer has room for, grows by doubling
+    size_t m_capacity = 0;
+    size_t m_uploadedInstances = 0;
+
+    struct InstanceRange
+    {
+        size_t offset = 0; // first instance in m_instanceTransforms
+        size_t count = 0;
+        bool live = false;
+    };
+    std::vector<InstanceRange> m_ranges; // indexed by handle
+    std::vector<int> m_freeHandles;
+    std::vector<InstanceRange> m_holes;  // removed ranges that have not been reused yet
+    size_t m_holeInstances = 0;
+
+    // Write instances [offset, offset + count) of m_instanceTransforms to the GPU buffer
+    void uploadRange(size_t offset, size_t count);
+
+    // Move all live ranges to the front, drop the holes and upload everything once
+    void compactRanges();
 };
@@ -15,6 +15,11 @@ public:
         : vertexArray(std::move(va)), vertexBuffer(std::move(vb)), indexBuffer(std::move(ib))
     {}
 
+    // Index buffer shared between several meshes (e.g. the terrain chunk grid indices)
+    Mesh(std::unique_ptr<VertexArray> va, std::unique_ptr<VertexBuffer> vb, std::shared_ptr<IndexBuffer> ib)
+        : vertexArray(std::move(va)), vertexBuffer(std::move(vb)), indexBuffer(std::move(ib))
+    {}
+
     Mesh(std::unique_ptr<VertexArray> va, std::unique_ptr<VertexBuffer> vb)   
         : vertexArray(std::move(va)), vertexBuffer(std::move(vb)), indexBuffer(nullptr)
     {}
@@ -22,7 +27,7 @@ public:
 
     std::unique_ptr<VertexArray> vertexArray;
     std::unique_ptr<VertexBuffer> vertexBuffer; // we just need to keep a reference to the vertexbuffer to avoid it being deleted (and freed on the GPU)
-    std::unique_ptr<IndexBuffer> indexBuffer;
+    std::shared_ptr<IndexBuffer> indexBuffer; // shared_ptr so meshes can share one IBO
 
     static std::shared_ptr<Mesh> createBoxMesh(){
 
@@ -72,7 +72,7 @@ void MeshRenderable::render(const glm::mat4 view, const glm::mat4 projection, co
 
         int count = m_mesh->indexBuffer->getCount();
         
-        GLCALL(glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr));
+        GLCALL(glDrawElements(GL_TRIANGLES, count, m_mesh->indexBuffer->getType(), nullptr));
     }
     else
     {
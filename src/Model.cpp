@@ -47,6 +47,7 @@ Model::Model(const std::filesystem::path &path, std::optional<std::shared_ptr<Te
     // DEBUG_PRINT("Processing model at path: " << path << " with " << ai_scene->mNumMeshes << " meshes.");
 
     m_modelData = std::make_shared<ModelData>();
+    bool firstVertex = true;
 
     // Process all meshes in the scene
     for (unsigned int i = 0; i < ai_scene->mNumMeshes; i++)
@@ -134,6 +135,10 @@ Model::Model(const std::filesystem::path &path, std::optional<std::shared_ptr<Te
             }
 
             vertices.push_back(vertex);
+
+            m_modelData->m_boundsMin = firstVertex ? vertex.Position : glm::min(m_modelData->m_boundsMin, vertex.Position);
+            m_modelData->m_boundsMax = firstVertex ? vertex.Position : glm::max(m_modelData->m_boundsMax, vertex.Position);
+            firstVertex = false;
         }
 
         // Create buffers and upload data to GPU
@@ -28,6 +28,10 @@ public:
         return m_meshRenderables;
     }
 
+    // Model space bounding box of all meshes
+    glm::vec3 m_boundsMin = glm::vec3(0.0f);
+    glm::vec3 m_boundsMax = glm::vec3(0.0f);
+
     bool m_hasTextureDiffuse = false;
     // bool m_hasTextureSpecular = false; // not implemented, not a priority either
     // bool m_hasTextureNormal = false; // not implemented, not a priority either
@@ -121,6 +121,8 @@ void Shader::addShader(const std::string &filename_nopath, ShaderType type)
         directory = VERTEX_SHADER_DIR;
     else if (type == ShaderType::FRAGMENT)
         directory = FRAGMENT_SHADER_DIR;
+    else if (type == ShaderType::COMPUTE)
+        directory = COMPUTE_SHADER_DIR; // a compute shader has to be the only stage in its program
     else
     {
         throw std::runtime_error("Shader::addShader: Unsupported shader type for automatic directory selection.");
@@ -251,6 +253,27 @@ void Shader::setUniform(const std::string &name, const glm::mat4 &v)
     GLCALL(glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(v)));
 }
 
+void Shader::bindStorageBuffer(GLuint binding, GLuint buffer)
+{
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer));
+}
+
+void Shader::bindStorageBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    GLCALL(glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, offset, size));
+}
+
+void Shader::dispatchCompute(GLuint groupsX, GLuint groupsY, GLuint groupsZ, GLbitfield barriers) const
+{
+    assert(RenderingContext::Current()->m_boundShader == m_RendererID);
+
+    GLCALL(glDispatchCompute(groupsX, groupsY, groupsZ));
+    if (barriers)
+    {
+        GLCALL(glMemoryBarrier(barriers));
+    }
+}
+
 int Shader::getUniformLocation(const std::string &name)
 {
     // Check cache first
@@ -81,6 +81,19 @@ public:
     void setUniform(const std::string &name, const glm::vec4 &v);
     void setUniform(const std::string &name, const glm::mat4 &v);
 
+    // Compute programs (ShaderType::COMPUTE, needs GL 4.3)
+    // Attach buffer to the storage block declared with layout(std430, binding = binding)
+    static void bindStorageBuffer(GLuint binding, GLuint buffer);
+    // Same, for size bytes from offset (a multiple of GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT)
+    static void bindStorageBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    /**
+     * @brief Runs groupsX * groupsY * groupsZ work groups of this program, which has to be bound.
+     * @param barriers glMemoryBarrier bits for how the shader's writes are read next
+     * (e.g. GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT), 0 to leave that to the caller
+     */
+    void dispatchCompute(GLuint groupsX, GLuint groupsY = 1, GLuint groupsZ = 1, GLbitfield barriers = 0) const;
+
 private:
     /**
      * @brief
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+
+// Terrain chunk represents a subdivided portion of the terrain
+struct ChunkCoord
+{
+    int x;
+    int z;
+
+    bool operator==(const ChunkCoord &other) const
+    {
+        return x == other.x && z == other.z;
+    }
+};
+
+// Hash function for ChunkCoord to use in unordered_map
+namespace std
+{
+    template <>
+    struct hash<ChunkCoord>
+    {
+        size_t operator()(const ChunkCoord &coord) const
+        {
+            return hash<int>()(coord.x) ^ (hash<int>()(coord.z) << 1);
+        }
+    };
+}
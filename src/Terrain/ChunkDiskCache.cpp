@@ -0,0 +1,347 @@
+#include "ChunkDiskCache.h"
+#include "TerrainConfig.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t REGION_MAGIC = 0x5243474F; // "OGCR"
+    constexpr uint32_t REGION_VERSION = 2; // 2: VegetationInstance records instead of tree positions
+    constexpr int REGION_SLOTS = TC_CACHE_REGION_SIZE * TC_CACHE_REGION_SIZE;
+
+    // Start of every region file, followed by REGION_SLOTS SlotEntry
+    struct RegionHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t parameterHash;
+        uint32_t regionSize;
+        uint32_t verticesPerAxis;
+    };
+
+    // Where a chunk record is in the file, size 0 = not cached.
+    // A record is the height grid followed by instanceCount VegetationInstance.
+    struct SlotEntry
+    {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t instanceCount;
+    };
+
+    constexpr size_t TABLE_OFFSET = sizeof(RegionHeader);
+    constexpr size_t DATA_OFFSET = TABLE_OFFSET + REGION_SLOTS * sizeof(SlotEntry);
+
+    // Rounds towards -infinity, chunk -1 is in region -1
+    int floorDiv(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    ChunkCoord regionOf(const ChunkCoord &coord)
+    {
+        return {floorDiv(coord.x, TC_CACHE_REGION_SIZE), floorDiv(coord.z, TC_CACHE_REGION_SIZE)};
+    }
+
+    // Index of coord in its region's slot table
+    int slotOf(const ChunkCoord &coord)
+    {
+        ChunkCoord region = regionOf(coord);
+        int localX = coord.x - region.x * TC_CACHE_REGION_SIZE;
+        int localZ = coord.z - region.z * TC_CACHE_REGION_SIZE;
+        return localZ * TC_CACHE_REGION_SIZE + localX;
+    }
+}
+
+// An open region file. Reads go through a read only mapping of the whole file, writes use
+// plain positioned writes and drop the mapping (it is mapped again on the next read).
+struct ChunkDiskCache::Region
+{
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    const uint8_t *mapped = nullptr;
+    uint64_t mappedSize = 0;
+    uint64_t fileSize = 0;
+    std::vector<SlotEntry> slots;
+
+    bool open(const std::filesystem::path &path)
+    {
+#ifdef _WIN32
+        file = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        fileSize = (uint64_t)size.QuadPart;
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        fstat(fd, &st);
+        fileSize = (uint64_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void unmap()
+    {
+        if (!mapped)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(mapped);
+        CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        munmap((void *)mapped, mappedSize);
+#endif
+        mapped = nullptr;
+        mappedSize = 0;
+    }
+
+    bool map()
+    {
+        unmap();
+        if (fileSize == 0)
+            return false;
+#ifdef _WIN32
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return false;
+        mapped = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!mapped)
+        {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+#else
+        void *p = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            return false;
+        mapped = (const uint8_t *)p;
+#endif
+        mappedSize = fileSize;
+        return true;
+    }
+
+    bool writeAt(const void *data, size_t size, uint64_t offset)
+    {
+        unmap(); // windows cant grow a file with a view open, keep both platforms the same
+#ifdef _WIN32
+        OVERLAPPED ov = {};
+        ov.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD written = 0;
+        if (!WriteFile(file, data, (DWORD)size, &written, &ov) || written != size)
+            return false;
+#else
+        const uint8_t *bytes = (const uint8_t *)data;
+        while (size > 0)
+        {
+            ssize_t written = pwrite(fd, bytes, size, (off_t)offset);
+            if (written <= 0)
+                return false;
+            bytes += written;
+            offset += (uint64_t)written;
+            size -= (size_t)written;
+        }
+#endif
+        fileSize = std::max(fileSize, offset + size);
+        return true;
+    }
+
+    bool truncate()
+    {
+        unmap();
+#ifdef _WIN32
+        LARGE_INTEGER zero = {};
+        if (!SetFilePointerEx(file, zero, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+            return false;
+#else
+        if (ftruncate(fd, 0) != 0)
+            return false;
+#endif
+        fileSize = 0;
+        return true;
+    }
+
+    ~Region()
+    {
+        unmap();
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+};
+
+ChunkDiskCache::ChunkDiskCache(const std::filesystem::path &directory, uint64_t parameterHash, int verticesPerAxis)
+    : m_parameterHash(parameterHash), m_verticesPerAxis(verticesPerAxis),
+      m_heightsBytes((size_t)verticesPerAxis * verticesPerAxis * sizeof(float))
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << parameterHash;
+    m_directory = directory / name.str();
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec)
+    {
+        DEBUG_PRINT("Chunk disk cache disabled, could not create " << m_directory << ": " << ec.message());
+        return;
+    }
+
+    // Caches of other terrain parameters are never valid again
+    for (const auto &entry : std::filesystem::directory_iterator(directory, ec))
+    {
+        if (entry.is_directory() && entry.path().filename() != m_directory.filename())
+        {
+            DEBUG_PRINT("Removing stale chunk cache " << entry.path());
+            std::filesystem::remove_all(entry.path(), ec);
+        }
+    }
+
+    m_open = true;
+}
+
+ChunkDiskCache::~ChunkDiskCache() = default;
+
+ChunkDiskCache::Region *ChunkDiskCache::getRegion(const ChunkCoord &coord)
+{
+    ChunkCoord regionCoord = regionOf(coord);
+    auto it = m_regions.find(regionCoord);
+    if (it != m_regions.end())
+        return it->second.get();
+
+    std::ostringstream name;
+    name << "r." << regionCoord.x << "." << regionCoord.z << ".bin";
+
+    auto region = std::make_unique<Region>();
+    if (!region->open(m_directory / name.str()))
+    {
+        DEBUG_PRINT("Could not open chunk cache region " << name.str());
+        m_regions[regionCoord] = nullptr; // dont try again every chunk
+        return nullptr;
+    }
+
+    RegionHeader expected = {REGION_MAGIC, REGION_VERSION, m_parameterHash, TC_CACHE_REGION_SIZE, (uint32_t)m_verticesPerAxis};
+    region->slots.assign(REGION_SLOTS, SlotEntry{0, 0, 0});
+
+    bool valid = region->fileSize >= DATA_OFFSET && region->map() &&
+                 std::memcmp(region->mapped, &expected, sizeof(RegionHeader)) == 0;
+    if (valid)
+    {
+        std::memcpy(region->slots.data(), region->mapped + TABLE_OFFSET, REGION_SLOTS * sizeof(SlotEntry));
+    }
+    else
+    {
+        // New (or broken) file, start it over with an empty table
+        if (!region->truncate() ||
+            !region->writeAt(&expected, sizeof(RegionHeader), 0) ||
+            !region->writeAt(region->slots.data(), REGION_SLOTS * sizeof(SlotEntry), TABLE_OFFSET))
+        {
+            DEBUG_PRINT("Could not initialize chunk cache region " << name.str());
+            m_regions[regionCoord] = nullptr;
+            return nullptr;
+        }
+    }
+
+    Region *r = region.get();
+    m_regions[regionCoord] = std::move(region);
+    return r;
+}
+
+bool ChunkDiskCache::load(const ChunkCoord &coord, std::vector<float> &heightGrid, std::vector<VegetationInstance> &vegetation)
+{
+    if (!m_open)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Region *region = getRegion(coord);
+    if (!region)
+        return false;
+
+    const SlotEntry &slot = region->slots[slotOf(coord)];
+    if (slot.size == 0 || slot.size != m_heightsBytes + slot.instanceCount * sizeof(VegetationInstance))
+        return false;
+
+    // Mapped again after every write, and the file may have grown since
+    if (slot.offset + slot.size > region->mappedSize)
+    {
+        if (!region->map() || slot.offset + slot.size > region->mappedSize)
+            return false;
+    }
+
+    // Straight out of the page cache, no read() into a staging buffer
+    const float *heights = (const float *)(region->mapped + slot.offset);
+    heightGrid.assign(heights, heights + m_verticesPerAxis * m_verticesPerAxis);
+
+    const VegetationInstance *instances = (const VegetationInstance *)(region->mapped + slot.offset + m_heightsBytes);
+    vegetation.assign(instances, instances + slot.instanceCount);
+    return true;
+}
+
+bool ChunkDiskCache::contains(const ChunkCoord &coord)
+{
+    if (!m_open)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Region *region = getRegion(coord);
+    return region && region->slots[slotOf(coord)].size != 0;
+}
+
+void ChunkDiskCache::store(const ChunkCoord &coord, const std::vector<float> &heightGrid, const std::vector<VegetationInstance> &vegetation)
+{
+    if (!m_open || heightGrid.size() * sizeof(float) != m_heightsBytes)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Region *region = getRegion(coord);
+    if (!region)
+        return;
+
+    int slotIndex = slotOf(coord);
+    SlotEntry &slot = region->slots[slotIndex];
+    if (slot.size != 0)
+        return;
+
+    // Record first, then the table entry pointing at it, so a crash in between only loses this chunk
+    SlotEntry entry;
+    entry.offset = std::max<uint64_t>(region->fileSize, DATA_OFFSET);
+    entry.size = (uint32_t)(m_heightsBytes + vegetation.size() * sizeof(VegetationInstance));
+    entry.instanceCount = (uint32_t)vegetation.size();
+
+    if (!region->writeAt(heightGrid.data(), m_heightsBytes, entry.offset) ||
+        (!vegetation.empty() && !region->writeAt(vegetation.data(), vegetation.size() * sizeof(VegetationInstance), entry.offset + m_heightsBytes)) ||
+        !region->writeAt(&entry, sizeof(SlotEntry), TABLE_OFFSET + slotIndex * sizeof(SlotEntry)))
+    {
+        DEBUG_PRINT("Could not write chunk " << coord.x << ", " << coord.z << " to the disk cache");
+        return;
+    }
+
+    slot = entry;
+}
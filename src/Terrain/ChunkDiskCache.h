@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ChunkCoord.h"
+#include "VegetationScatter.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Heights and vegetation of generated chunks on disk, so chunks we walk back to
+ * (or load again next session) are read back instead of generated from noise again.
+ *
+ * One region file per TC_CACHE_REGION_SIZE x TC_CACHE_REGION_SIZE chunks, read through a
+ * memory mapping. Files live in a directory named after the terrain parameter hash, so any
+ * change to the terrain gives an empty cache and the old directories are deleted.
+ *
+ * Thread safe, called from the chunk worker threads.
+ */
+class ChunkDiskCache
+{
+public:
+    ChunkDiskCache(const std::filesystem::path &directory, uint64_t parameterHash, int verticesPerAxis);
+    ~ChunkDiskCache();
+
+    ChunkDiskCache(const ChunkDiskCache &) = delete;
+    ChunkDiskCache &operator=(const ChunkDiskCache &) = delete;
+
+    // False if the cache directory could not be created, load/store then do nothing
+    bool isOpen() const { return m_open; }
+
+    // Fill heightGrid (verticesPerAxis^2 values) and vegetation. False if coord is not cached.
+    bool load(const ChunkCoord &coord, std::vector<float> &heightGrid, std::vector<VegetationInstance> &vegetation);
+
+    // Whether load would find coord, without reading the chunk
+    bool contains(const ChunkCoord &coord);
+
+    // Append a chunk to its region file. Chunks that are already cached are not written again.
+    void store(const ChunkCoord &coord, const std::vector<float> &heightGrid, const std::vector<VegetationInstance> &vegetation);
+
+    struct Region;
+
+private:
+    std::filesystem::path m_directory;
+    uint64_t m_parameterHash;
+    int m_verticesPerAxis;
+    size_t m_heightsBytes; // one height grid
+    bool m_open = false;
+
+    std::mutex m_mutex;
+    std::unordered_map<ChunkCoord, std::unique_ptr<Region>> m_regions; // keyed by region coord
+
+    // Open (or create) the region file holding coord. Caller holds m_mutex.
+    Region *getRegion(const ChunkCoord &coord);
+};
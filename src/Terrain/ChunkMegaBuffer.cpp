@@ -0,0 +1,103 @@
+#include "ChunkMegaBuffer.h"
+
+ChunkMegaBuffer::ChunkMegaBuffer(int slotCount, int verticesPerSlot, const VertexBufferLayout &layout,
+                                 const std::vector<std::vector<unsigned short>> &lodIndices)
+    : m_slotCount(slotCount), m_verticesPerSlot(verticesPerSlot), m_stride(layout.getStride())
+{
+    // Storage for every slot up front, filled in by upload()
+    m_vertexArray = std::make_unique<VertexArray>();
+    m_vertexBuffer = std::make_unique<VertexBuffer>(nullptr, (unsigned int)(slotCount * verticesPerSlot * m_stride), m_vertexArray.get(), BufferUsage::DYNAMIC_DRAW);
+    m_vertexArray->addBuffer(m_vertexBuffer.get(), layout);
+
+    // All LOD levels back to back in one index buffer
+    std::vector<unsigned short> indices;
+    for (const auto &lod : lodIndices)
+    {
+        m_lodOffsets.push_back(indices.size() * sizeof(unsigned short));
+        m_lodCounts.push_back((GLsizei)lod.size());
+        indices.insert(indices.end(), lod.begin(), lod.end());
+    }
+    m_indexBuffer = std::make_unique<IndexBuffer>(indices); // VAO is still bound, so it keeps this IBO
+
+    GLCALL(glGenBuffers(1, &m_uniformBuffer));
+    GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer));
+    GLCALL(glBufferData(GL_UNIFORM_BUFFER, slotCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW));
+
+    // Handed out from the back, so low slots first
+    m_freeSlots.reserve(slotCount);
+    for (int slot = slotCount - 1; slot >= 0; slot--)
+        m_freeSlots.push_back(slot);
+}
+
+ChunkMegaBuffer::~ChunkMegaBuffer()
+{
+    GLCALL(glDeleteBuffers(1, &m_uniformBuffer));
+}
+
+int ChunkMegaBuffer::allocate()
+{
+    if (m_freeSlots.empty())
+        return -1;
+    int slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    return slot;
+}
+
+void ChunkMegaBuffer::free(int slot)
+{
+    assert(slot >= 0 && slot < m_slotCount);
+    m_freeSlots.push_back(slot);
+}
+
+void ChunkMegaBuffer::upload(int slot, const void *vertices, const glm::vec4 &chunkData)
+{
+    assert(slot >= 0 && slot < m_slotCount);
+
+    m_vertexBuffer->bind();
+    GLCALL(glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)slot * m_verticesPerSlot * m_stride, (GLsizeiptr)m_verticesPerSlot * m_stride, vertices));
+
+    setChunkData(slot, chunkData);
+}
+
+void ChunkMegaBuffer::setChunkData(int slot, const glm::vec4 &chunkData)
+{
+    assert(slot >= 0 && slot < m_slotCount);
+
+    GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer));
+    GLCALL(glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)slot * sizeof(glm::vec4), sizeof(glm::vec4), &chunkData));
+}
+
+void ChunkMegaBuffer::addDraw(int slot, int lod)
+{
+    m_counts.push_back(m_lodCounts[lod]);
+    m_offsets.push_back((const void *)(uintptr_t)m_lodOffsets[lod]);
+    m_baseVertices.push_back(slot * m_verticesPerSlot);
+}
+
+void ChunkMegaBuffer::draw(const Shader &shader)
+{
+    if (m_counts.empty())
+        return;
+
+    // The block binding is program state, only needs setting once per program
+    if (m_blockProgram != shader.getID())
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(shader.getID(), "ChunkData");
+        if (blockIndex != GL_INVALID_INDEX)
+        {
+            GLCALL(glUniformBlockBinding(shader.getID(), blockIndex, UNIFORM_BLOCK_BINDING));
+        }
+        m_blockProgram = shader.getID();
+    }
+    GLCALL(glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BINDING, m_uniformBuffer));
+
+    RenderingContext *rContext = RenderingContext::Current();
+    if (rContext->m_boundVAO != m_vertexArray->getID())
+        m_vertexArray->bind();
+
+    GLCALL(glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_counts.data(), GL_UNSIGNED_SHORT, m_offsets.data(), (GLsizei)m_counts.size(), m_baseVertices.data()));
+
+    m_counts.clear();
+    m_offsets.clear();
+    m_baseVertices.clear();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Common.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "VertexBufferLayout.h"
+#include "Shader.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief One vertex buffer for the geometry of all terrain chunks, drawn with a single
+ * glMultiDrawElementsBaseVertex.
+ *
+ * Every chunk has the same vertex count, so the buffer is a slab of equally sized slots.
+ * Freed slots are handed out again, nothing is reallocated after the constructor.
+ * The index lists of every LOD level share one index buffer, a draw picks its level by offset.
+ *
+ * Per chunk data (the chunk origin) lives in a uniform block indexed by slot. The shader gets
+ * the slot from gl_VertexID / verticesPerSlot, gl_VertexID includes the base vertex
+ * (gl_DrawID would need GL 4.6).
+ */
+class ChunkMegaBuffer
+{
+public:
+    // The uniform block in the shader must hold slotCount vec4 (std140), see TerrainPackedMulti.vert
+    static constexpr GLuint UNIFORM_BLOCK_BINDING = 0;
+
+    ChunkMegaBuffer(int slotCount, int verticesPerSlot, const VertexBufferLayout &layout,
+                    const std::vector<std::vector<unsigned short>> &lodIndices);
+    ~ChunkMegaBuffer();
+
+    ChunkMegaBuffer(const ChunkMegaBuffer &) = delete;
+    ChunkMegaBuffer &operator=(const ChunkMegaBuffer &) = delete;
+
+    // Slot for a new chunk, -1 if every slot is taken
+    int allocate();
+    void free(int slot);
+    size_t getFreeSlotCount() const { return m_freeSlots.size(); }
+    int getSlotCount() const { return m_slotCount; }
+
+    // Write the vertices (verticesPerSlot * stride bytes) and origin of a chunk into its slot
+    void upload(int slot, const void *vertices, const glm::vec4 &chunkData);
+
+    // Only the origin, for a slot whose vertices were written on the GPU (GpuTerrainGenerator)
+    void setChunkData(int slot, const glm::vec4 &chunkData);
+
+    // The vertex storage, slot n starts at vertex n * verticesPerSlot
+    GLuint getVertexBufferID() const { return m_vertexBuffer->getID(); }
+    int getVerticesPerSlot() const { return m_verticesPerSlot; }
+
+    // Queue a chunk for the next draw()
+    void addDraw(int slot, int lod);
+    size_t getQueuedDrawCount() const { return m_counts.size(); }
+
+    // Draw everything queued in one call and clear the queue. shader must be bound,
+    // its uniforms and textures are the callers business.
+    void draw(const Shader &shader);
+
+private:
+    int m_slotCount;
+    int m_verticesPerSlot;
+    unsigned int m_stride;
+
+    std::unique_ptr<VertexArray> m_vertexArray;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<IndexBuffer> m_indexBuffer;
+    GLuint m_uniformBuffer = 0;
+
+    // Where each LOD level's indices start in m_indexBuffer, and how many there are
+    std::vector<size_t> m_lodOffsets;
+    std::vector<GLsizei> m_lodCounts;
+
+    std::vector<int> m_freeSlots;
+
+    // Draw queue, arguments of glMultiDrawElementsBaseVertex
+    std::vector<GLsizei> m_counts;
+    std::vector<const void *> m_offsets;
+    std::vector<GLint> m_baseVertices;
+
+    GLuint m_blockProgram = 0; // program the uniform block binding was set for
+};
@@ -0,0 +1,92 @@
+#include "ChunkWorkerPool.h"
+#include "TerrainChunk.h"
+
+#include <algorithm>
+
+ChunkWorkerPool::ChunkWorkerPool(BuildFunction buildFunction, unsigned int numThreads)
+    : m_buildFunction(std::move(buildFunction))
+{
+    if (numThreads == 0)
+    {
+        unsigned int hw = std::thread::hardware_concurrency();
+        numThreads = hw > 1 ? hw - 1 : 1; // leave one core for the render thread
+    }
+
+    m_threads.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; i++)
+        m_threads.emplace_back(&ChunkWorkerPool::workerLoop, this);
+}
+
+ChunkWorkerPool::~ChunkWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopping = true;
+        m_queue.clear();
+    }
+    m_queueCondition.notify_all();
+
+    for (auto &t : m_threads)
+        t.join();
+}
+
+void ChunkWorkerPool::request(ChunkBuildRequest request)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.push_back(std::move(request));
+    }
+    m_queueCondition.notify_one();
+}
+
+std::vector<ChunkBuildRequest> ChunkWorkerPool::discardQueued(const std::function<bool(const ChunkBuildRequest &)> &shouldDiscard)
+{
+    std::vector<ChunkBuildRequest> discarded;
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+
+    auto it = std::remove_if(m_queue.begin(), m_queue.end(),
+                             [&](const ChunkBuildRequest &r)
+                             {
+                                 if (!shouldDiscard(r))
+                                     return false;
+                                 discarded.push_back(r);
+                                 return true;
+                             });
+    m_queue.erase(it, m_queue.end());
+    return discarded;
+}
+
+size_t ChunkWorkerPool::collectFinished(std::vector<std::unique_ptr<ChunkBuildData>> &out, size_t maxCount)
+{
+    std::lock_guard<std::mutex> lock(m_finishedMutex);
+
+    size_t count = std::min(maxCount, m_finished.size());
+    // Oldest first so chunks come in roughly in the order they were requested
+    for (size_t i = 0; i < count; i++)
+        out.push_back(std::move(m_finished[i]));
+    m_finished.erase(m_finished.begin(), m_finished.begin() + count);
+    return count;
+}
+
+void ChunkWorkerPool::workerLoop()
+{
+    while (true)
+    {
+        ChunkBuildRequest request;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this]
+                                  { return m_stopping || !m_queue.empty(); });
+            if (m_stopping)
+                return;
+
+            request = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        std::unique_ptr<ChunkBuildData> data = m_buildFunction(request);
+
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        m_finished.push_back(std::move(data));
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ChunkCoord.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ChunkBuildData; // defined in TerrainChunk.h
+struct TerrainConfig;
+class ChunkDiskCache;
+
+// A chunk to build with the given config, read from and stored in diskCache (may be null). The edges are height rows/columns copied from neighbours
+// that were resident when the request was made (verticesPerAxis values each), empty means compute them. heightGrid is the whole
+// grid of a height only chunk that is being promoted (or of a GPU generated chunk), then no heights are computed at all.
+// A GPU generated chunk also has its vertices in mega buffer slot megaBufferSlot already, no vertices are built.
+struct ChunkBuildRequest
+{
+    ChunkCoord coord;
+    std::shared_ptr<const TerrainConfig> config;
+    std::shared_ptr<ChunkDiskCache> diskCache;
+    std::vector<float> edgeMinX; // column gx = 0
+    std::vector<float> edgeMaxX; // column gx = verticesPerAxis - 1
+    std::vector<float> edgeMinZ; // row gz = 0
+    std::vector<float> edgeMaxZ; // row gz = verticesPerAxis - 1
+    std::vector<float> heightGrid; // verticesPerAxis^2 or empty
+    int megaBufferSlot = -1;
+    uint32_t megaBufferGeneration = 0; // the mega buffer the slot belongs to, see TerrainChunkManager::m_megaBufferGeneration
+};
+
+/**
+ * @brief Small thread pool that builds the CPU side of terrain chunks (heights, vertices, trees).
+ *
+ * Requests are pushed from the main thread, built on the workers, and handed back through
+ * collectFinished(). Nothing in here touches OpenGL, the GL upload stays on the main thread.
+ */
+class ChunkWorkerPool
+{
+public:
+    using BuildFunction = std::function<std::unique_ptr<ChunkBuildData>(const ChunkBuildRequest &)>;
+
+    // numThreads == 0 picks hardware_concurrency() - 1 (at least one worker)
+    ChunkWorkerPool(BuildFunction buildFunction, unsigned int numThreads = 0);
+    ~ChunkWorkerPool();
+
+    ChunkWorkerPool(const ChunkWorkerPool &) = delete;
+    ChunkWorkerPool &operator=(const ChunkWorkerPool &) = delete;
+
+    // Queue a chunk for building. Never blocks on the workers.
+    void request(ChunkBuildRequest request);
+
+    // Drop queued (not yet started) requests matching the predicate. Returns the dropped requests.
+    std::vector<ChunkBuildRequest> discardQueued(const std::function<bool(const ChunkBuildRequest &)> &shouldDiscard);
+
+    // Move at most maxCount finished builds into out. Returns how many were moved.
+    size_t collectFinished(std::vector<std::unique_ptr<ChunkBuildData>> &out, size_t maxCount);
+
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+private:
+    void workerLoop();
+
+    BuildFunction m_buildFunction;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<ChunkBuildRequest> m_queue;
+    bool m_stopping = false;
+
+    std::mutex m_finishedMutex;
+    std::vector<std::unique_ptr<ChunkBuildData>> m_finished;
+};
@@ -0,0 +1,204 @@
+#include "GpuTerrainGenerator.h"
+#include "TerrainNoise.h"
+
+#include <cassert>
+#include <cstring>
+
+bool GpuTerrainGenerator::isSupported()
+{
+    return GLAD_GL_VERSION_4_3;
+}
+
+GpuTerrainGenerator::GpuTerrainGenerator(const TerrainConfig &config)
+{
+    assert(isSupported());
+
+    m_shader = std::make_unique<Shader>();
+    m_shader->addShader("TerrainHeights.comp", ShaderType::COMPUTE);
+    m_shader->createProgram();
+
+    // The noise parameters never change, same as the TerrainGenerator they come from
+    m_shader->bind();
+    m_shader->setUniform("u_ridgeSampleFactor", config.ridgeSampleFactor);
+    m_shader->setUniform("u_ridgeNoise", glm::vec3(config.ridgeNoiseLacunarity, config.ridgeNoiseGain, config.ridgeNoiseOffset));
+    m_shader->setUniform("u_ridgeOctaves", config.ridgeNoiseOctaves);
+    m_shader->setUniform("u_ridgeDetailFactor", config.ridgeDetailFactor);
+    m_shader->setUniform("u_hillSampleFactor", config.hillSampleFactor);
+    m_shader->setUniform("u_hillNoise", glm::vec2(config.hillNoiseLacunarity, config.hillNoiseGain));
+    m_shader->setUniform("u_hillOctaves", config.hillNoiseOctaves);
+    m_shader->setUniform("u_seaSampleFactor", glm::vec2(config.seaSampleFactorX, config.seaSampleFactorZ));
+    m_shader->setUniform("u_seaNoise", glm::vec2(config.seaSampleLacunarity, config.seaSampleGain));
+    m_shader->setUniform("u_seaOctaves", config.seaSampleOctaves);
+    m_shader->setUniform("u_seaLevel", glm::vec2(config.seaLevel, config.seaLevelOffset));
+    m_shader->setUniform("u_mountainCenter", glm::vec2(config.width * 0.05f, config.height * 0.05f));
+    m_shader->setUniform("u_heightRange", glm::vec2(TC_PACKED_HEIGHT_MIN, TC_PACKED_HEIGHT_MAX));
+    m_shader->unbind();
+
+    int tables[1024];
+    TerrainNoise::copyPerlinTables(tables, tables + 512);
+    GLCALL(glGenBuffers(1, &m_tableBuffer));
+    GLCALL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tableBuffer));
+    GLCALL(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(tables), tables, GL_STATIC_DRAW));
+    GLCALL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+}
+
+GpuTerrainGenerator::~GpuTerrainGenerator()
+{
+    for (Job &job : m_jobs)
+    {
+        if (job.fence)
+            glDeleteSync(job.fence);
+        GLCALL(glDeleteBuffers(1, &job.heightBuffer));
+        GLCALL(glDeleteBuffers(1, &job.readbackBuffer));
+    }
+    GLCALL(glDeleteBuffers(1, &m_tableBuffer));
+}
+
+bool GpuTerrainGenerator::submit(const ChunkCoord &coord, std::shared_ptr<const TerrainConfig> config, int tag,
+                                 GLuint vertexBuffer, int firstVertex)
+{
+    Job *job = nullptr;
+    for (Job &j : m_jobs)
+    {
+        if (!j.inFlight)
+        {
+            job = &j;
+            break;
+        }
+    }
+    if (!job)
+        return false;
+
+    const int N = config->verticesPerAxis();
+    job->inFlight = true;
+    job->coord = coord;
+    job->config = std::move(config);
+    job->tag = tag;
+    job->heightCount = (size_t)N * N;
+
+    if (job->capacity < job->heightCount)
+    {
+        if (!job->heightBuffer)
+        {
+            GLCALL(glGenBuffers(1, &job->heightBuffer));
+            GLCALL(glGenBuffers(1, &job->readbackBuffer));
+        }
+        job->capacity = job->heightCount;
+        GLCALL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, job->heightBuffer));
+        GLCALL(glBufferData(GL_SHADER_STORAGE_BUFFER, job->capacity * sizeof(float), nullptr, GL_DYNAMIC_COPY));
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, job->readbackBuffer));
+        GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, job->capacity * sizeof(float), nullptr, GL_STREAM_READ));
+        GLCALL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    }
+
+    const TerrainConfig &chunkConfig = *job->config;
+    m_shader->bind();
+    m_shader->setUniform("u_chunkOriginX", coord.x * chunkConfig.chunkSize);
+    m_shader->setUniform("u_chunkOriginZ", coord.z * chunkConfig.chunkSize);
+    m_shader->setUniform("u_vertexStep", chunkConfig.vertexStep);
+    m_shader->setUniform("u_gridSize", N);
+    m_shader->setUniform("u_writeVertices", vertexBuffer ? 1 : 0);
+    m_shader->setUniform("u_firstVertex", firstVertex);
+
+    Shader::bindStorageBuffer(0, m_tableBuffer);
+    Shader::bindStorageBuffer(1, job->heightBuffer);
+    Shader::bindStorageBuffer(2, vertexBuffer ? vertexBuffer : job->heightBuffer); // never written without vertices
+
+    // The vertices are drawn from, the heights copied
+    GLuint groups = (GLuint)((N + 7) / 8);
+    m_shader->dispatchCompute(groups, groups, 1, GL_BUFFER_UPDATE_BARRIER_BIT | (vertexBuffer ? GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT : 0));
+
+    GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, job->heightBuffer));
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, job->readbackBuffer));
+    GLCALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, job->heightCount * sizeof(float)));
+    GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    return true;
+}
+
+void GpuTerrainGenerator::finishJob(Job &job, std::vector<Result> &out)
+{
+    Result result{job.coord, std::move(job.config), job.tag, std::vector<float>(job.heightCount)};
+
+    GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, job.readbackBuffer));
+    const void *mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, job.heightCount * sizeof(float), GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        std::memcpy(result.heightGrid.data(), mapped, job.heightCount * sizeof(float));
+        GLCALL(glUnmapBuffer(GL_COPY_READ_BUFFER));
+    }
+    else
+    {
+        DEBUG_PRINT("GpuTerrainGenerator: could not map the heights of chunk " << job.coord.x << ", " << job.coord.z);
+        result.heightGrid.clear();
+    }
+    GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+
+    glDeleteSync(job.fence);
+    job.fence = nullptr;
+    job.inFlight = false;
+    out.push_back(std::move(result));
+}
+
+size_t GpuTerrainGenerator::collectFinished(std::vector<Result> &out, bool wait)
+{
+    size_t collected = 0;
+    for (Job &job : m_jobs)
+    {
+        if (!job.inFlight)
+            continue;
+
+        // The flush makes sure the fence gets to the GPU at all, a zero timeout only asks whether it has signalled
+        GLuint64 timeout = wait ? 1000000000ull : 0;
+        GLenum status = glClientWaitSync(job.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (status == GL_TIMEOUT_EXPIRED)
+            continue;
+        if (status == GL_WAIT_FAILED)
+        {
+            // Like a cancelled job, handed back without heights so the caller frees its slot and asks again
+            DEBUG_PRINT("GpuTerrainGenerator: waiting for chunk " << job.coord.x << ", " << job.coord.z << " failed");
+            glDeleteSync(job.fence);
+            job.fence = nullptr;
+            job.inFlight = false;
+            out.push_back({job.coord, std::move(job.config), job.tag, {}});
+            collected++;
+            continue;
+        }
+
+        finishJob(job, out);
+        collected++;
+    }
+    return collected;
+}
+
+void GpuTerrainGenerator::cancelAll(std::vector<Result> &out)
+{
+    for (Job &job : m_jobs)
+    {
+        if (!job.inFlight)
+            continue;
+        glDeleteSync(job.fence);
+        job.fence = nullptr;
+        job.inFlight = false;
+        out.push_back({job.coord, std::move(job.config), job.tag, {}});
+    }
+}
+
+bool GpuTerrainGenerator::hasFreeJob() const
+{
+    return getInFlightCount() < MAX_JOBS;
+}
+
+size_t GpuTerrainGenerator::getInFlightCount() const
+{
+    size_t count = 0;
+    for (const Job &job : m_jobs)
+    {
+        if (job.inFlight)
+            count++;
+    }
+    return count;
+}
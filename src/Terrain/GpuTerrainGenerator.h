@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Common.h"
+#include "Shader.h"
+#include "ChunkCoord.h"
+#include "TerrainConfig.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Chunk heights from a compute shader (TerrainHeights.comp), the GPU side of TerrainGenerator.
+ *
+ * The shader evaluates the noise layers of TerrainGenerator::getPerlinHeight for every grid vertex of a
+ * chunk and can pack the chunk's vertices straight into a vertex buffer, so the mesh never passes through
+ * the CPU. Only the height grid comes back (trees and gameplay heights need it): it is copied
+ * into a read back buffer behind a fence, and mapped once the fence has signalled a frame or two later.
+ * Nothing waits on the GPU.
+ *
+ * The shader has no noise cache and the GPU rounds differently (fused multiply adds, pow), so the heights
+ * are close to but not bit for bit the CPU ones. The CPU noise is the reference, gputerraintest compares them,
+ * and only CPU heights go to the disk cache.
+ */
+class GpuTerrainGenerator
+{
+public:
+    // Compute shaders and shader storage buffers need OpenGL 4.3
+    static bool isSupported();
+
+    // Only the noise parameters of config are used (the TerrainGenerator's config)
+    explicit GpuTerrainGenerator(const TerrainConfig &config);
+    ~GpuTerrainGenerator();
+
+    GpuTerrainGenerator(const GpuTerrainGenerator &) = delete;
+    GpuTerrainGenerator &operator=(const GpuTerrainGenerator &) = delete;
+
+    // Start generating a chunk with the grid of config. With a vertexBuffer its TerrainVertexPacked (grid, then
+    // skirts, like buildChunkVertices) are written there from vertex firstVertex on. tag is handed back with
+    // the heights. False if every job is in flight.
+    bool submit(const ChunkCoord &coord, std::shared_ptr<const TerrainConfig> config, int tag = -1,
+                GLuint vertexBuffer = 0, int firstVertex = 0);
+
+    struct Result
+    {
+        ChunkCoord coord;
+        std::shared_ptr<const TerrainConfig> config;
+        int tag;
+        std::vector<float> heightGrid; // verticesPerAxis^2, row major like Chunk::heightGrid. Empty if cancelled.
+    };
+
+    // Move the chunks whose heights are back into out, returns how many. Only blocks with wait (tests).
+    // A job whose fence could not be waited on comes back without heights, like a cancelled one.
+    size_t collectFinished(std::vector<Result> &out, bool wait = false);
+
+    // Forget every job in flight, they are moved into out without heights
+    void cancelAll(std::vector<Result> &out);
+
+    bool hasFreeJob() const;
+    size_t getInFlightCount() const;
+
+    static constexpr int MAX_JOBS = 8;
+
+private:
+    std::unique_ptr<Shader> m_shader;
+    GLuint m_tableBuffer = 0; // TerrainNoise perlin tables
+
+    // One chunk on its way. The buffers are kept for the next chunk and only grow.
+    struct Job
+    {
+        bool inFlight = false;
+        ChunkCoord coord = {0, 0};
+        std::shared_ptr<const TerrainConfig> config;
+        int tag = -1;
+        size_t heightCount = 0;
+
+        GLuint heightBuffer = 0;   // written by the shader
+        GLuint readbackBuffer = 0; // copy of it the CPU maps, the buffer version of a PBO
+        size_t capacity = 0;       // floats in both
+        GLsync fence = nullptr;
+    };
+    Job m_jobs[MAX_JOBS];
+
+    // Map the read back buffer of a finished job and hand its heights over
+    void finishJob(Job &job, std::vector<Result> &out);
+};
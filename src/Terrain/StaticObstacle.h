@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Something that does not move and blocks walking, a circle on the XZ plane (trees)
+struct StaticObstacle
+{
+    glm::vec2 posXZ;
+    float radius;
+};
+
+// Push a circle of the given radius at proposed out of every obstacle it overlaps
+inline glm::vec2 resolveObstacleCollisions(const glm::vec2 &proposed, float radius, const std::vector<StaticObstacle> &obstacles)
+{
+    glm::vec2 result = proposed;
+
+    for (const auto &o : obstacles)
+    {
+        glm::vec2 diff = result - o.posXZ;
+        float dist = glm::length(diff);
+        float minDist = radius + o.radius;
+
+        if (dist < minDist && dist > 0.0001f)
+        {
+            glm::vec2 normal = diff / dist;
+            result = o.posXZ + normal * minDist;
+        }
+    }
+
+    return result;
+}
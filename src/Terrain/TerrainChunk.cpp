@@ -1,197 +1,1191 @@
 #include "TerrainChunk.h"
 #include "Error.h"
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <iostream>
+#include <limits>
 #include <glm/gtc/matrix_transform.hpp>
 
-std::unique_ptr<Chunk> TerrainChunkManager::generateNewChunk(const ChunkCoord &coord)
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TERRAIN_HEIGHTS_SSE2 1
+#endif
+
+void TerrainChunkManager::buildHeightField(const ChunkBuildRequest &request, std::vector<float> &heights) const
+{
+    const TerrainConfig &config = *request.config;
+    const int N = config.verticesPerAxis();
+    const int worldOffsetX = request.coord.x * config.chunkSize;
+    const int worldOffsetZ = request.coord.z * config.chunkSize;
+
+    heights.assign(N * N, 0.0f);
+    std::vector<char> known(N * N, 0);
+
+    // Borders shared with resident neighbours. Same world positions, so same heights bit for bit.
+    auto copyEdge = [&](const std::vector<float> &edge, int start, int stride)
+    {
+        if (edge.size() != (size_t)N)
+            return;
+        for (int i = 0; i < N; i++)
+        {
+            heights[start + i * stride] = edge[i];
+            known[start + i * stride] = 1;
+        }
+    };
+    copyEdge(request.edgeMinX, 0, N);
+    copyEdge(request.edgeMaxX, N - 1, N);
+    copyEdge(request.edgeMinZ, 0, 1);
+    copyEdge(request.edgeMaxZ, (N - 1) * N, 1);
+
+    // Everything else in one batch
+    std::vector<float> xs, zs, out;
+    std::vector<int> targets;
+    xs.reserve(N * N);
+    zs.reserve(N * N);
+    targets.reserve(N * N);
+    for (int gz = 0; gz < N; gz++)
+    {
+        for (int gx = 0; gx < N; gx++)
+        {
+            if (known[gz * N + gx])
+                continue;
+            xs.push_back((float)(worldOffsetX + gx * config.vertexStep));
+            zs.push_back((float)(worldOffsetZ + gz * config.vertexStep));
+            targets.push_back(gz * N + gx);
+        }
+    }
+
+    out.resize(targets.size());
+    m_generator->getPerlinHeightBatch(xs.data(), zs.data(), out.data(), out.size());
+    for (size_t i = 0; i < targets.size(); i++)
+        heights[targets[i]] = out[i];
+}
+
+ChunkBuildRequest TerrainChunkManager::makeBuildRequest(const ChunkCoord &coord) const
 {
-    std::vector<TerrainVertex> vertices;
-    std::vector<unsigned int> indices;
+    const int N = m_config->verticesPerAxis();
+    ChunkBuildRequest request;
+    request.coord = coord;
+    request.config = m_config;
+    request.diskCache = m_diskCache;
+
+    auto copyEdge = [&](const ChunkCoord &neighbour, int start, int stride, std::vector<float> &edge)
+    {
+        // Height only chunks have the same grid
+        const std::vector<float> *grid = nullptr;
+        if (Chunk *c = findChunk(neighbour))
+            grid = &c->heightGrid;
+        else if (auto it = m_heightOnlyIndex.find(neighbour); it != m_heightOnlyIndex.end())
+            grid = &it->second->heightGrid;
+        if (!grid || grid->size() != N * N)
+            return;
+        edge.resize(N);
+        for (int i = 0; i < N; i++)
+            edge[i] = (*grid)[start + i * stride];
+    };
 
-    // Pre-allocate memory
-    vertices.reserve(TC_CELLS_PER_CHUNK * 6 + 6); // terrain + water plane
-    indices.reserve(TC_CELLS_PER_CHUNK * 6 + 6);
+    // Our min x column is the max x column of the chunk to the left, and so on
+    copyEdge({coord.x - 1, coord.z}, N - 1, N, request.edgeMinX);
+    copyEdge({coord.x + 1, coord.z}, 0, N, request.edgeMaxX);
+    copyEdge({coord.x, coord.z - 1}, (N - 1) * N, 1, request.edgeMinZ);
+    copyEdge({coord.x, coord.z + 1}, 0, 1, request.edgeMaxZ);
 
-    // Constants
+    return request;
+}
+
+// Ground, grass, mountain and water weight of every grid vertex (TC_SPLAT_MAPS): the height bands TerrainBlend.frag
+// picks from with an if chain per fragment, as ramps. TerrainSplat.frag interpolates them between the vertices.
+static void bakeSplatWeights(const TerrainConfig &config, const std::vector<float> &heightGrid, std::vector<uint8_t> &weights)
+{
+    const int N = config.verticesPerAxis();
+    weights.resize((size_t)N * N * 4);
+
+    auto ramp = [](float h, float from, float to)
+    { return std::clamp((h - from) / (to - from), 0.0f, 1.0f); };
+
+    for (int i = 0; i < N * N; i++)
+    {
+        float h = heightGrid[i];
+        long grass = std::lround((ramp(h, 0.15f, 0.20f) - ramp(h, 0.40f, 0.48f)) * 255.0f);
+        long mountain = std::lround(ramp(h, 0.70f, 0.75f) * 255.0f); // only above the grass band
+        weights[i * 4 + 0] = (uint8_t)(255 - grass - mountain);
+        weights[i * 4 + 1] = (uint8_t)grass;
+        weights[i * 4 + 2] = (uint8_t)mountain;
+        weights[i * 4 + 3] = 0; // chunks have no water of their own, the WaterRenderer draws it
+    }
+}
+
+// Vertices of a chunk mesh: one per grid point, then a lowered skirt copy of every edge vertex.
+// Flat shading is done in TerrainBlend.frag from screen space derivatives, so no normals are needed.
+static void buildChunkVertices([[maybe_unused]] const ChunkCoord &coord, const TerrainConfig &config, const std::vector<float> &heightGrid, std::vector<ChunkVertex> &vertices)
+{
+    const int N = config.verticesPerAxis();
+#if !TC_PACKED_VERTICES
     constexpr float heightScale = 100.0f;
-    constexpr float seaLevel = 0.13f * heightScale + 0.1f;
-    const int worldOffsetX = coord.x * TC_CHUNK_SIZE;
-    const int worldOffsetZ = coord.z * TC_CHUNK_SIZE;
+    const int worldOffsetX = coord.x * config.chunkSize;
+    const int worldOffsetZ = coord.z * config.chunkSize;
+#endif
 
-    // Helper to add a triangle with flat shading
-    auto addTriangle = [&](const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3,
-                           float h1, float h2, float h3, float waterMask)
+    auto makeVertex = [&](int gx, int gz, bool skirt) -> ChunkVertex
     {
-        glm::vec3 normal = glm::normalize(glm::cross(p2 - p1, p3 - p1));
-        unsigned int baseIdx = vertices.size();
+        float h = heightGrid[gz * N + gx];
+#if TC_PACKED_VERTICES
+        // Chunk local position, the chunk origin is the model matrix
+        float normalizedHeight = (h - TC_PACKED_HEIGHT_MIN) / (TC_PACKED_HEIGHT_MAX - TC_PACKED_HEIGHT_MIN);
+        normalizedHeight = std::clamp(normalizedHeight, 0.0f, 1.0f);
+        return {(uint16_t)(gx * config.vertexStep), (uint16_t)(gz * config.vertexStep),
+                (uint16_t)std::lround(normalizedHeight * 65535.0f),
+                0, (uint8_t)(skirt ? 255 : 0)};
+#else
+        glm::vec3 pos((float)(worldOffsetX + gx * config.vertexStep), h * heightScale, (float)(worldOffsetZ + gz * config.vertexStep));
+        if (skirt)
+            pos.y -= config.lodSkirtDepth;
+        return {pos, glm::vec3(0.0f, 1.0f, 0.0f),
+                glm::vec2(pos.x / 10.0f, pos.z / 10.0f),
+                h, 0.0f};
+#endif
+    };
 
-        auto addVertex = [&](const glm::vec3 &pos, float h)
+    vertices.reserve(N * N + 4 * N);
+    for (int gz = 0; gz < N; gz++)
+    {
+        for (int gx = 0; gx < N; gx++)
         {
-            vertices.push_back({pos, normal,
-                                glm::vec2(pos.x / 10.0f, pos.z / 10.0f),
-                                h, waterMask});
-        };
+            vertices.push_back(makeVertex(gx, gz, false));
+        }
+    }
+
+    // Skirts: a lowered copy of every edge vertex, in the order min z, max z, min x, max x
+    for (int i = 0; i < N; i++)
+        vertices.push_back(makeVertex(i, 0, true));
+    for (int i = 0; i < N; i++)
+        vertices.push_back(makeVertex(i, N - 1, true));
+    for (int i = 0; i < N; i++)
+        vertices.push_back(makeVertex(0, i, true));
+    for (int i = 0; i < N; i++)
+        vertices.push_back(makeVertex(N - 1, i, true));
+}
+
+static void sampleHeightGridBatch(const std::vector<float> &heightGrid, int gridSize, const ChunkCoord &coord,
+                                  const float *xs, const float *zs, float *out, size_t n, int chunkSize, int vertexStep);
+
+void TerrainChunkManager::scatterVegetation(const ChunkCoord &coord, const TerrainConfig &config, const std::vector<float> &heightGrid, std::vector<VegetationInstance> &vegetation) const
+{
+    constexpr float heightScale = 100.0f;
+    constexpr float seaLevel = 0.13f * heightScale + 0.1f;
+
+    const size_t first = vegetation.size();
+    m_vegetationScatter.scatter((float)(coord.x * config.chunkSize), (float)(coord.z * config.chunkSize), (float)config.chunkSize, vegetation);
+    const size_t n = vegetation.size() - first;
+
+    // On the surface (the triangles of the grid, not just the nearest vertex)
+    std::vector<float> xs(n), zs(n), heights(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        xs[i] = vegetation[first + i].position.x;
+        zs[i] = vegetation[first + i].position.z;
+    }
+    sampleHeightGridBatch(heightGrid, config.verticesPerAxis(), coord, xs.data(), zs.data(), heights.data(), n, config.chunkSize, config.vertexStep);
+
+    // Nothing below or at sea level (in water), and every type only in its height band
+    size_t kept = first;
+    for (size_t i = 0; i < n; i++)
+    {
+        VegetationInstance instance = vegetation[first + i];
+        const VegetationType &type = VEGETATION_TYPES[instance.type];
+        float y = heights[i];
+        if (y <= seaLevel || y < type.minHeight * heightScale || y > type.maxHeight * heightScale)
+            continue;
+        instance.position.y = y;
+        vegetation[kept++] = instance;
+    }
+    vegetation.resize(kept);
+}
+
+void TerrainChunkManager::buildObstacleGrid(const ChunkCoord &coord, const TerrainConfig &config, const std::vector<VegetationInstance> &vegetation,
+                                            std::vector<uint32_t> &cellStart, std::vector<StaticObstacle> &obstacles)
+{
+    constexpr int CELLS = TC_OBSTACLE_GRID_CELLS;
+    const float CELL_SIZE = (float)config.chunkSize / CELLS;
+    const float worldOffsetX = (float)(coord.x * config.chunkSize);
+    const float worldOffsetZ = (float)(coord.z * config.chunkSize);
+
+    auto cellOf = [&](const glm::vec3 &p)
+    {
+        int cx = std::clamp((int)((p.x - worldOffsetX) / CELL_SIZE), 0, CELLS - 1);
+        int cz = std::clamp((int)((p.z - worldOffsetZ) / CELL_SIZE), 0, CELLS - 1);
+        return cz * CELLS + cx;
+    };
+
+    // Counting sort by cell: count, prefix sum, then place. Types without a radius are walked through.
+    cellStart.assign(CELLS * CELLS + 1, 0);
+    for (const VegetationInstance &v : vegetation)
+    {
+        if (VEGETATION_TYPES[v.type].obstacleRadius > 0.0f)
+            cellStart[cellOf(v.position) + 1]++;
+    }
+    for (int i = 0; i < CELLS * CELLS; i++)
+        cellStart[i + 1] += cellStart[i];
+
+    obstacles.resize(cellStart.back());
+    std::vector<uint32_t> next(cellStart.begin(), cellStart.end() - 1);
+    for (const VegetationInstance &v : vegetation)
+    {
+        float radius = VEGETATION_TYPES[v.type].obstacleRadius;
+        if (radius > 0.0f)
+            obstacles[next[cellOf(v.position)]++] = {glm::vec2(v.position.x, v.position.z), radius};
+    }
+}
+
+std::unique_ptr<ChunkBuildData> TerrainChunkManager::buildChunkData(const ChunkBuildRequest &request) const
+{
+    const ChunkCoord &coord = request.coord;
+    const TerrainConfig &config = *request.config;
+    ChunkDiskCache *diskCache = request.diskCache.get();
+    auto data = std::make_unique<ChunkBuildData>();
+    data->coord = coord;
+    data->config = request.config;
+
+    // Generated on the GPU: heights from the request, the vertices are in the mega buffer already
+    const bool gpuGenerated = request.megaBufferSlot >= 0;
+    data->megaBufferSlot = request.megaBufferSlot;
+    data->megaBufferGeneration = request.megaBufferGeneration;
+
+    // Generated before (this session or an earlier one)? Then there is no noise to evaluate at all
+    bool cached = !gpuGenerated && diskCache && diskCache->load(coord, data->heightGrid, data->vegetation);
+
+    if (!cached)
+    {
+        // Every vertex height is evaluated once here, the mesh, the vegetation and getPreciseHeightAt read from it.
+        // A promoted height only chunk already has them.
+        if (request.heightGrid.size() == (size_t)config.verticesPerAxis() * config.verticesPerAxis())
+            data->heightGrid = request.heightGrid;
+        else
+            buildHeightField(request, data->heightGrid);
+
+        // Populate chunk with vegetation (for instanced rendering)
+        scatterVegetation(coord, config, data->heightGrid, data->vegetation);
+
+        // GPU heights are close to but not exactly the CPU ones (the reference), they are not kept for the CPU path to reuse
+        if (diskCache && !gpuGenerated)
+            diskCache->store(coord, data->heightGrid, data->vegetation);
+    }
+
+#if TC_GPU_DISPLACEMENT
+    // No per chunk mesh, the heights go to the GPU as a layer of the height map array in uploadChunk
+#else
+    if (!gpuGenerated)
+        buildChunkVertices(coord, config, data->heightGrid, data->vertices);
+#endif
+
+    buildObstacleGrid(coord, config, data->vegetation, data->obstacleCellStart, data->obstacles);
+    data->heightPyramid.build(data->heightGrid, config.cellsPerAxis(), 100.0f);
+#if TC_SPLAT_MAPS
+    bakeSplatWeights(config, data->heightGrid, data->splatWeights);
+#endif
+
+    // Water is now rendered globally by TerrainChunkManager to avoid seams
+
+    return data;
+}
 
-        addVertex(p1, h1);
-        addVertex(p2, h2);
-        addVertex(p3, h3);
+std::shared_ptr<ChunkDiskCache> TerrainChunkManager::makeDiskCache(const TerrainConfig &config) const
+{
+#if TC_DISK_CACHE
+    // One directory per chunk layout, so switching presets back and forth keeps both caches
+    std::filesystem::path directory = std::filesystem::path(TC_CACHE_DIR) / (std::to_string(config.chunkSize) + "x" + std::to_string(config.vertexStep));
+    return std::make_shared<ChunkDiskCache>(directory, computeTerrainHash(config), config.verticesPerAxis());
+#else
+    (void)config;
+    return nullptr;
+#endif
+}
 
-        indices.insert(indices.end(), {baseIdx, baseIdx + 1, baseIdx + 2});
+uint64_t TerrainChunkManager::computeTerrainHash(const TerrainConfig &config) const
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void *data, size_t size)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
     };
 
-    // Generate terrain vertices
-    for (int z = 0; z < TC_CHUNK_SIZE; z += TC_VERTEX_STEP)
+    // Layout of the cached data
+    const int layout[] = {config.chunkSize, config.vertexStep, config.verticesPerAxis()};
+    mix(layout, sizeof(layout));
+
+    // Rather than listing every noise parameter (and forgetting the next one), hash what the
+    // generator actually produces at a set of fixed points. Any parameter or noise code change shows up here.
+    for (int i = 0; i < 256; i++)
     {
-        for (int x = 0; x < TC_CHUNK_SIZE; x += TC_VERTEX_STEP)
+        float x = (float)((i * 7919) % 20011 - 10000) * 3.7f;
+        float z = (float)((i * 104729) % 20011 - 10000) * 2.9f;
+        float height = m_generator->getPerlinHeight(x, z);
+        mix(&height, sizeof(height));
+    }
+
+    // Same for the vegetation: its tile, types and density noise
+    uint64_t vegetationHash = m_vegetationScatter.getHash();
+    mix(&vegetationHash, sizeof(vegetationHash));
+
+    return hash;
+}
+
+// 16-bit grid indices of one LOD level, the same for every chunk
+static std::vector<unsigned short> buildChunkIndices(const TerrainConfig &config, int lod)
+{
+    const int N = config.verticesPerAxis();
+    const int cells = config.cellsPerAxis();
+    assert(N * N + 4 * N <= 65536 && "chunk grid too big for 16-bit indices");
+
+    // Grid lines used by this level. The last one is always included so the chunk keeps its full
+    // size even when the step does not divide cellsPerAxis (8x on a 20 cell chunk is 0, 8, 16, 20)
+    std::vector<int> samples;
+    for (int g = 0; g < cells; g += 1 << lod)
+        samples.push_back(g);
+    samples.push_back(cells);
+
+    const int quads = (int)samples.size() - 1;
+    std::vector<unsigned short> indices;
+    indices.reserve(quads * quads * 6 + 4 * quads * 6);
+
+    for (int zi = 0; zi < quads; zi++)
+    {
+        for (int xi = 0; xi < quads; xi++)
         {
-            int worldX = worldOffsetX + x;
-            int worldZ = worldOffsetZ + z;
-
-            // Sample heights at quad corners
-            float h_tl = m_generator->getPerlinHeight((float)worldX, (float)worldZ);
-            float h_tr = m_generator->getPerlinHeight((float)(worldX + TC_VERTEX_STEP), (float)worldZ);
-            float h_bl = m_generator->getPerlinHeight((float)worldX, (float)(worldZ + TC_VERTEX_STEP));
-            float h_br = m_generator->getPerlinHeight((float)(worldX + TC_VERTEX_STEP), (float)(worldZ + TC_VERTEX_STEP));
-
-            // Calculate positions
-            glm::vec3 pos_tl((float)worldX, h_tl * heightScale, (float)worldZ);
-            glm::vec3 pos_tr((float)(worldX + TC_VERTEX_STEP), h_tr * heightScale, (float)worldZ);
-            glm::vec3 pos_bl((float)worldX, h_bl * heightScale, (float)(worldZ + TC_VERTEX_STEP));
-            glm::vec3 pos_br((float)(worldX + TC_VERTEX_STEP), h_br * heightScale, (float)(worldZ + TC_VERTEX_STEP));
-
-            // Add two triangles for the quad
-            addTriangle(pos_tl, pos_bl, pos_tr, h_tl, h_bl, h_tr, 0.0f);
-            addTriangle(pos_tr, pos_bl, pos_br, h_tr, h_bl, h_br, 0.0f);
+            unsigned short topLeft = samples[zi] * N + samples[xi];
+            unsigned short topRight = samples[zi] * N + samples[xi + 1];
+            unsigned short bottomLeft = samples[zi + 1] * N + samples[xi];
+            unsigned short bottomRight = samples[zi + 1] * N + samples[xi + 1];
+
+            // Same diagonal as Chunk::getPreciseHeightAt (TL-BL-TR, TR-BL-BR)
+            indices.insert(indices.end(), {topLeft, bottomLeft, topRight});
+            indices.insert(indices.end(), {topRight, bottomLeft, bottomRight});
         }
     }
 
-    // Water is now rendered globally by TerrainChunkManager to avoid seams
+    // Skirt quads hang from the edge vertices of this level down to their lowered copies.
+    // Whichever of two neighbouring chunks has the higher edge covers the crack with its skirt.
+    // They face out of the chunk (WorldManager renders with back face culling), flip flips the winding.
+    auto addSkirt = [&](int side, bool flip, auto gridIndex)
+    {
+        const int skirtBase = N * N + side * N;
+        for (int i = 0; i < quads; i++)
+        {
+            unsigned short a = gridIndex(samples[i]);
+            unsigned short b = gridIndex(samples[i + 1]);
+            unsigned short skirtA = skirtBase + samples[i];
+            unsigned short skirtB = skirtBase + samples[i + 1];
+            if (flip)
+            {
+                std::swap(a, b);
+                std::swap(skirtA, skirtB);
+            }
+            indices.insert(indices.end(), {a, skirtA, b});
+            indices.insert(indices.end(), {b, skirtA, skirtB});
+        }
+    };
+    addSkirt(0, true, [](int i) { return i; });
+    addSkirt(1, false, [N](int i) { return (N - 1) * N + i; });
+    addSkirt(2, false, [N](int i) { return i * N; });
+    addSkirt(3, true, [N](int i) { return i * N + N - 1; });
 
+    return indices;
+}
+
+std::unique_ptr<Chunk> TerrainChunkManager::uploadChunk(ChunkBuildData &data)
+{
+    // Only data of the current layout gets here, finishConfigSwitch swaps m_config before uploading
+    assert(data.config->sameChunkLayout(*m_config));
+    const int chunkSize = m_config->chunkSize;
+    const int N = m_config->verticesPerAxis();
+
+#if TC_SPLAT_MAPS
+    // Its weights into a free layer of the splat array, the chunk shaders sample it instead of the height bands
+    int splatLayer = allocateSplatLayer();
+    m_splatMaps->uploadLayer(splatLayer, data.splatWeights.data());
+#else
+    int splatLayer = -1;
+#endif
+
+#if TC_MEGA_BUFFER
+    if (!m_megaBuffer)
+        createMegaBuffer(*data.config);
+
+    // GPU generated chunks come with their slot
+    int slot = data.megaBufferSlot;
+    if (slot < 0)
+    {
+        // Every slot taken, make room by evicting the least recently used inactive chunk
+        if (m_megaBuffer->getFreeSlotCount() == 0)
+            evictChunks(SIZE_MAX, 1);
+
+        // Only fails if TC_MEGA_BUFFER_SLOTS chunks are active, the chunk is then resident but not drawn
+        slot = m_megaBuffer->allocate();
+    }
+    if (slot >= 0)
+    {
+        glm::vec4 origin((float)(data.coord.x * chunkSize), 0.0f, (float)(data.coord.z * chunkSize), (float)splatLayer);
+        if (data.megaBufferSlot >= 0)
+            m_megaBuffer->setChunkData(slot, origin);
+        else
+            m_megaBuffer->upload(slot, data.vertices.data(), origin);
+    }
+    else
+    {
+        DEBUG_PRINT("Chunk mega buffer is full, chunk " << data.coord.x << ", " << data.coord.z << " will not be drawn");
+    }
+
+    std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(data.coord, nullptr);
+    chunk->megaBufferSlot = slot;
+#else
     // Create meshrenderable
     auto va_ptr = std::make_unique<VertexArray>();
-    auto vb_ptr = std::make_unique<VertexBuffer>(vertices.data(), vertices.size() * sizeof(TerrainVertex), va_ptr.get());
+#if TC_GPU_DISPLACEMENT
+    // Every chunk draws the same flat grid, only the VAO is per chunk (it holds the chunk's LOD index buffer)
+    if (!m_gridVertexBuffer)
+    {
+        std::vector<ChunkVertex> grid;
+        buildChunkVertices({0, 0}, *m_config, std::vector<float>(N * N, 0.0f), grid);
+        m_gridVertexBuffer = std::make_unique<VertexBuffer>(grid.data(), grid.size() * sizeof(ChunkVertex), va_ptr.get());
+    }
+    std::unique_ptr<VertexBuffer> vb_ptr; // owned by the manager
+    VertexBuffer *chunkVertexBuffer = m_gridVertexBuffer.get();
+#else
+    auto vb_ptr = std::make_unique<VertexBuffer>(data.vertices.data(), data.vertices.size() * sizeof(ChunkVertex), va_ptr.get());
+    VertexBuffer *chunkVertexBuffer = vb_ptr.get();
+#endif
     VertexBufferLayout layout;
+#if TC_PACKED_VERTICES
+    layout.push<unsigned short>(2);           // local x, z
+    layout.pushNormalized<unsigned short>(1); // height
+    layout.pushNormalized<unsigned char>(2);  // waterMask, skirt
+#else
     layout.push<float>(3); // position
     layout.push<float>(3); // normal
     layout.push<float>(2); // texCoord
     layout.push<float>(1); // height
     layout.push<float>(1); // waterMask
-    va_ptr->addBuffer(vb_ptr.get(), layout);
-    auto ibo_ptr = std::make_unique<IndexBuffer>(indices.data(), indices.size());
-    auto mesh_ptr = std::make_shared<Mesh>(std::move(va_ptr), std::move(vb_ptr), std::move(ibo_ptr));
+#endif
+    va_ptr->addBuffer(chunkVertexBuffer, layout);
+    // Every chunk uses the same grid indices. Bind the shared IBO while our VAO is bound so the VAO remembers it.
+    // New chunks start at full detail, updateChunkLods moves them to their level.
+    if (!m_chunkIndexBuffers[0])
+    {
+        for (int lod = 0; lod < TC_LOD_LEVELS; lod++)
+            m_chunkIndexBuffers[lod] = std::make_shared<IndexBuffer>(buildChunkIndices(*m_config, lod)); // until the chunk layout changes
+    }
+    m_chunkIndexBuffers[0]->bind();
+
+    auto mesh_ptr = std::make_shared<Mesh>(std::move(va_ptr), std::move(vb_ptr), m_chunkIndexBuffers[0]);
+#if TC_PACKED_VERTICES
+    auto chunkTerrain_mr = std::make_unique<MeshRenderable>(mesh_ptr, m_chunkShader);
+    chunkTerrain_mr->setTransform(glm::translate(glm::mat4(1.0f), glm::vec3((float)(data.coord.x * chunkSize), 0.0f, (float)(data.coord.z * chunkSize))));
+#else
     auto chunkTerrain_mr = std::make_unique<MeshRenderable>(mesh_ptr, m_terrainShader);
+#endif
     chunkTerrain_mr->m_textureReferences = m_terrainTextures;
 
+#if TC_GPU_DISPLACEMENT
+    // The only per chunk upload: its heights into a free layer of the height map array
+    int heightMapLayer = allocateHeightMapLayer();
+    m_heightMaps->uploadLayer(heightMapLayer, data.heightGrid.data());
+    chunkTerrain_mr->m_textureReferences.push_back(m_heightMaps);
+    chunkTerrain_mr->setUniform("u_heightLayer", heightMapLayer);
+#endif
+#if TC_SPLAT_MAPS
+    chunkTerrain_mr->m_textureReferences.push_back(m_splatMaps);
+    chunkTerrain_mr->setUniform("u_splatLayer", splatLayer);
+#endif
+
     // Create chunk
-    std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(coord, std::move(chunkTerrain_mr));
+    std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(data.coord, std::move(chunkTerrain_mr));
+#endif
+    chunk->heightGrid = std::move(data.heightGrid);
+    chunk->gridSize = N;
+#if TC_GPU_DISPLACEMENT
+    chunk->heightMapLayer = heightMapLayer;
+#endif
+    chunk->splatLayer = splatLayer;
+
+    // Bounds from the height grid, the skirts hang below the lowest vertex
+    auto [minHeight, maxHeight] = std::minmax_element(chunk->heightGrid.begin(), chunk->heightGrid.end());
+    chunk->boundsMin = glm::vec3((float)(data.coord.x * chunkSize), *minHeight * 100.0f - m_config->lodSkirtDepth, (float)(data.coord.z * chunkSize));
+    chunk->boundsMax = glm::vec3((float)((data.coord.x + 1) * chunkSize), *maxHeight * 100.0f, (float)((data.coord.z + 1) * chunkSize));
+    chunk->vegetation = std::move(data.vegetation);
+    chunk->obstacleCellStart = std::move(data.obstacleCellStart);
+    chunk->obstacles = std::move(data.obstacles);
+    chunk->heightPyramid = std::move(data.heightPyramid);
+
+    // What this chunk costs us, for the memory budget. The shared index buffers are not counted.
+    size_t cpuBytes = sizeof(Chunk) + chunk->heightGrid.capacity() * sizeof(float) +
+                      chunk->vegetation.capacity() * sizeof(VegetationInstance) +
+                      chunk->obstacleCellStart.capacity() * sizeof(uint32_t) + chunk->obstacles.capacity() * sizeof(StaticObstacle) +
+                      chunk->heightPyramid.memoryBytes();
+    if (chunk->terrain_mr)
+        cpuBytes += sizeof(MeshRenderable) + sizeof(Mesh);
+#if TC_MEGA_BUFFER
+    size_t gpuBytes = m_megaBuffer->getVerticesPerSlot() * sizeof(ChunkVertex) + sizeof(glm::vec4); // its slot and origin
+#elif TC_GPU_DISPLACEMENT
+    size_t gpuBytes = N * N * sizeof(float); // height map layer
+#else
+    size_t gpuBytes = data.vertices.size() * sizeof(ChunkVertex);
+#endif
+    if (splatLayer >= 0)
+        gpuBytes += (size_t)N * N * 4; // splat layer
+    chunk->memoryBytes = cpuBytes + gpuBytes;
 
-    
-    chunk->heightGrid.assign(TC_VERTICES_PER_AXIS, std::vector<float>(TC_VERTICES_PER_AXIS));
+    // Mark trees as needing update
+    m_treesNeedUpdate = true;
 
-    for (int gz = 0; gz < TC_VERTICES_PER_AXIS; gz++)
+    return chunk;
+}
+
+void TerrainChunkManager::createMegaBuffer(const TerrainConfig &config)
+{
+    VertexBufferLayout layout;
+    layout.push<unsigned short>(2);           // local x, z
+    layout.pushNormalized<unsigned short>(1); // height
+    layout.pushNormalized<unsigned char>(2);  // waterMask, skirt
+
+    std::vector<std::vector<unsigned short>> lodIndices;
+    for (int lod = 0; lod < TC_LOD_LEVELS; lod++)
+        lodIndices.push_back(buildChunkIndices(config, lod));
+
+    // Grid vertices and the four skirts, see buildChunkVertices
+    const int N = config.verticesPerAxis();
+    m_megaBuffer = std::make_unique<ChunkMegaBuffer>(TC_MEGA_BUFFER_SLOTS, N * N + 4 * N, layout, lodIndices);
+    m_megaBufferGeneration++;
+}
+
+bool TerrainChunkManager::submitGpuChunk(const ChunkCoord &coord)
+{
+    if (!m_gpuGenerator->hasFreeJob())
+        return false;
+
+    // Reading a cached chunk back is cheaper than generating it, and keeps its heights bit for bit
+    if (m_diskCache && m_diskCache->contains(coord))
+        return false;
+
+    if (!m_megaBuffer)
+        createMegaBuffer(*m_config);
+    if (m_megaBuffer->getFreeSlotCount() == 0)
+        evictChunks(SIZE_MAX, 1);
+    int slot = m_megaBuffer->allocate();
+    if (slot < 0)
+        return false;
+
+    m_gpuGenerator->submit(coord, m_config, slot, m_megaBuffer->getVertexBufferID(), slot * m_megaBuffer->getVerticesPerSlot());
+    return true;
+}
+
+void TerrainChunkManager::collectGpuChunks()
+{
+    std::vector<GpuTerrainGenerator::Result> results;
+    m_gpuGenerator->collectFinished(results);
+
+    for (auto &result : results)
     {
-        for (int gx = 0; gx < TC_VERTICES_PER_AXIS; gx++)
+        // Could not be read back or its fence failed, the next updateChunks asks for it again
+        if (result.heightGrid.empty())
         {
-            float worldX = worldOffsetX + gx * TC_VERTEX_STEP;
-            float worldZ = worldOffsetZ + gz * TC_VERTEX_STEP;
-
-            // EXACT match to mesh vertex samples
-            chunk->heightGrid[gz][gx] = m_generator->getPerlinHeight(worldX, worldZ);
+            m_megaBuffer->free(result.tag);
+            m_pendingChunks.erase(result.coord);
+            m_ringDirty = true;
+            continue;
         }
+
+        // Trees, obstacles, the pyramid and the disk cache still need the CPU
+        ChunkBuildRequest request;
+        request.coord = result.coord;
+        request.config = result.config;
+        request.diskCache = m_diskCache;
+        request.heightGrid = std::move(result.heightGrid);
+        request.megaBufferSlot = result.tag;
+        request.megaBufferGeneration = m_megaBufferGeneration;
+        m_workerPool->request(std::move(request));
     }
+}
 
-    // Populate chunk with tree positions (for instanced rendering)
+void TerrainChunkManager::cancelGpuChunks(bool freeSlots)
+{
+    std::vector<GpuTerrainGenerator::Result> cancelled;
+    m_gpuGenerator->cancelAll(cancelled);
+    for (auto &result : cancelled)
+    {
+        if (freeSlots)
+            m_megaBuffer->free(result.tag);
+        m_pendingChunks.erase(result.coord);
+    }
+    m_ringDirty = true;
+}
 
-    for (int z = 0; z < TC_CHUNK_SIZE; z += TC_VERTEX_STEP)
+void TerrainChunkManager::releaseDiscardedRequests(const std::vector<ChunkBuildRequest> &discarded)
+{
+    for (const ChunkBuildRequest &r : discarded)
     {
-        for (int x = 0; x < TC_CHUNK_SIZE; x += TC_VERTEX_STEP)
-        {
-            float tree_perlin = m_generator->foo_treePerlin((float)(worldOffsetX + x), (float)(worldOffsetZ + z));
+        if (r.megaBufferSlot >= 0 && m_megaBuffer && r.megaBufferGeneration == m_megaBufferGeneration)
+            m_megaBuffer->free(r.megaBufferSlot);
+    }
+}
+
+int TerrainChunkManager::allocateHeightMapLayer()
+{
+    const int N = m_config->verticesPerAxis();
 
-            if (tree_perlin > 0.3f) // threshold for tree placement
+    if (m_freeHeightMapLayers.empty())
+    {
+        // Out of layers, make the array twice as big. GL 4.0 has no glCopyImageSubData,
+        // but every resident chunk still has its heights on the CPU so just upload them again.
+        int oldCount = m_heightMaps ? m_heightMaps->getLayerCount() : 0;
+        int newCount = std::max(64, oldCount * 2);
+        std::shared_ptr<Texture> heightMaps = Texture::CreateFloatTextureArray(N, N, newCount, "u_heightMaps");
+
+        for (auto &chunk : m_chunks)
+        {
+            if (chunk->heightMapLayer < 0)
                 continue;
+            heightMaps->uploadLayer(chunk->heightMapLayer, chunk->heightGrid.data());
+            std::replace(chunk->terrain_mr->m_textureReferences.begin(), chunk->terrain_mr->m_textureReferences.end(), m_heightMaps, heightMaps);
+        }
 
-            float worldX = worldOffsetX + x;
-            float worldZ = worldOffsetZ + z;
-            float y = m_generator->getPerlinHeight((float)worldX, (float)worldZ);
-            y *= heightScale;
-            
-            // Don't place trees below or at sea level (in water)
-            if (y <= seaLevel)
+        for (int layer = newCount - 1; layer >= oldCount; layer--)
+            m_freeHeightMapLayers.push_back(layer);
+        m_heightMaps = heightMaps;
+    }
+
+    int layer = m_freeHeightMapLayers.back();
+    m_freeHeightMapLayers.pop_back();
+    return layer;
+}
+
+int TerrainChunkManager::allocateSplatLayer()
+{
+    const int N = m_config->verticesPerAxis();
+
+    if (m_freeSplatLayers.empty())
+    {
+        // Same as allocateHeightMapLayer: twice as many layers, the weights of the resident chunks are baked
+        // again from their heights (cheaper than keeping them around on the CPU)
+        int oldCount = m_splatMaps ? m_splatMaps->getLayerCount() : 0;
+        int newCount = std::max(64, oldCount * 2);
+        std::shared_ptr<Texture> splatMaps = Texture::CreateColorTextureArray(N, N, newCount, "u_splatMaps");
+
+        std::vector<uint8_t> weights;
+        for (auto &chunk : m_chunks)
+        {
+            if (chunk->splatLayer < 0)
                 continue;
-            
-            // Just store the position - trees will be rendered via instancing
-            chunk->treePositions.push_back(glm::vec3((float)worldX, y, (float)worldZ));
+            bakeSplatWeights(*m_config, chunk->heightGrid, weights);
+            splatMaps->uploadLayer(chunk->splatLayer, weights.data());
+            if (chunk->terrain_mr)
+                std::replace(chunk->terrain_mr->m_textureReferences.begin(), chunk->terrain_mr->m_textureReferences.end(), m_splatMaps, splatMaps);
         }
+
+        for (int layer = newCount - 1; layer >= oldCount; layer--)
+            m_freeSplatLayers.push_back(layer);
+        m_splatMaps = splatMaps;
     }
-    
-    // Mark trees as needing update
+
+    int layer = m_freeSplatLayers.back();
+    m_freeSplatLayers.pop_back();
+    return layer;
+}
+
+Chunk *TerrainChunkManager::findChunk(const ChunkCoord &coord) const
+{
+    auto it = m_chunkIndex.find(coord);
+    return it != m_chunkIndex.end() ? it->second : nullptr;
+}
+
+void TerrainChunkManager::addChunk(std::unique_ptr<Chunk> chunk)
+{
+    Chunk *c = chunk.get();
+    m_chunkIndex[c->coord] = c;
+    m_lru.push_front(c);
+    c->lruPosition = m_lru.begin();
+    m_residentBytes += c->memoryBytes;
+    m_chunks.push_back(std::move(chunk));
+
+    // Requested before it had heights only, the full chunk answers height queries now
+    auto it = m_heightOnlyIndex.find(c->coord);
+    if (it != m_heightOnlyIndex.end())
+    {
+        m_heightOnlyLru.erase(it->second);
+        m_heightOnlyIndex.erase(it);
+    }
+}
+
+void TerrainChunkManager::touchChunk(Chunk *chunk)
+{
+    m_lru.splice(m_lru.begin(), m_lru, chunk->lruPosition);
+}
+
+TerrainChunkManager::ChunkStoreStats TerrainChunkManager::getChunkStoreStats() const
+{
+    ChunkStoreStats stats = m_stats;
+    stats.residentChunks = m_chunks.size();
+    stats.residentBytes = m_residentBytes;
+    stats.budgetBytes = m_memoryBudget;
+    stats.heightOnlyChunks = m_heightOnlyLru.size();
+    return stats;
+}
+
+TerrainChunkManager::StreamingStats TerrainChunkManager::getStreamingStats() const
+{
+    StreamingStats stats = m_streamingStats;
+    stats.queuedChunks = m_streamQueue.size();
+    stats.inFlightChunks = m_pendingChunks.size();
+    return stats;
+}
+
+void TerrainChunkManager::processFinishedChunks()
+{
+    if (m_gpuGenerator)
+        collectGpuChunks();
+
+    // One at a time, whatever the budget leaves stays with the worker pool until the next frame
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&]()
+    { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+    std::vector<std::unique_ptr<ChunkBuildData>> finished;
+    for (int collected = 0; collected < m_config->chunkUploadsPerFrame; collected++)
+    {
+        if (collected > 0 && elapsedMs() >= m_config->uploadBudgetMs)
+            break;
+        finished.clear();
+        if (m_workerPool->collectFinished(finished, 1) == 0)
+            break;
+        std::unique_ptr<ChunkBuildData> &data = finished.front();
+
+        // Built for a layout switch, kept on the CPU until the whole ring is there
+        if (m_nextConfig && data->config == m_nextConfig)
+        {
+            m_nextPendingChunks.erase(data->coord);
+            m_nextChunks.push_back(std::move(data));
+            continue;
+        }
+
+        // Started before a layout switch (or one that was cancelled), the grid no longer fits.
+        // GPU generated vertices in a mega buffer that has been replaced since are gone too.
+        if (!data->config->sameChunkLayout(*m_config))
+            continue;
+        if (data->megaBufferSlot >= 0 && data->megaBufferGeneration != m_megaBufferGeneration)
+            continue;
+
+        m_pendingChunks.erase(data->coord);
+
+        // Only requested while not resident, never index a coord twice anyway
+        if (findChunk(data->coord))
+        {
+            if (data->megaBufferSlot >= 0)
+                m_megaBuffer->free(data->megaBufferSlot);
+            continue;
+        }
+
+        std::unique_ptr<Chunk> chunk = uploadChunk(*data);
+        chunk->setActiveStatus(chunk->inBounds(m_ringMin, m_ringMax));
+        addChunk(std::move(chunk));
+
+        // Needed by a ring (not just a height query), it took this long
+        auto needed = m_neededSince.find(data->coord);
+        if (needed != m_neededSince.end())
+        {
+            double latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - needed->second).count();
+            m_neededSince.erase(needed);
+            m_streamingStats.readyChunks++;
+            m_streamingStats.lastLatencyMs = latencyMs;
+            m_streamingStats.maxLatencyMs = std::max(m_streamingStats.maxLatencyMs, latencyMs);
+            m_totalLatencyMs += latencyMs;
+            m_streamingStats.averageLatencyMs = m_totalLatencyMs / m_streamingStats.readyChunks;
+        }
+    }
+    m_streamingStats.uploadMs = elapsedMs();
+
+    if (m_nextConfig && m_nextPendingChunks.empty())
+        finishConfigSwitch();
+}
+
+void TerrainChunkManager::applyConfig()
+{
+    const TerrainConfig &config = *m_config;
+
+    m_memoryBudget = config.chunkMemoryBudget;
+
+    for (const auto &renderer : m_vegetationRenderers)
+    {
+        if (!renderer)
+            continue;
+        if (config.treeImpostorDistance > 0.0f)
+            renderer->enableImpostors(config.treeImpostorDistance, config.treeImpostorDistance + config.treeImpostorFade);
+        else
+            renderer->disableImpostors();
+    }
+
+    // Without packed vertices the skirts are part of the vertices, there is no chunk shader
+    if (m_chunkShader)
+    {
+        m_chunkShader->bind();
+        m_chunkShader->setUniform("u_skirtDepth", config.lodSkirtDepth);
+        const int N = config.verticesPerAxis();
+#if TC_MEGA_BUFFER
+        m_chunkShader->setUniform("u_verticesPerChunk", N * N + 4 * N);
+#endif
+        // Grid position -> splat texel (TC_GPU_DISPLACEMENT also finds its height texel with it)
+        m_chunkShader->setUniform("u_vertexStep", (float)config.vertexStep);
+        m_chunkShader->setUniform("u_splatSize", (float)N);
+    }
+
+#if TC_MEGA_BUFFER
+    // The compute shader writes straight into mega buffer slots, other chunk storage keeps the CPU path
+    if (config.gpuGeneration && !m_gpuGenerator)
+    {
+        if (GpuTerrainGenerator::isSupported())
+            m_gpuGenerator = std::make_unique<GpuTerrainGenerator>(m_generator->getConfig());
+        else
+            DEBUG_PRINT("GPU terrain generation needs OpenGL 4.3, chunks are generated on the CPU instead");
+    }
+    else if (!config.gpuGeneration && m_gpuGenerator)
+    {
+        cancelGpuChunks(true);
+        m_gpuGenerator.reset();
+    }
+#endif
+}
+
+void TerrainChunkManager::setConfig(const TerrainConfig &config)
+{
+    // A layout switch that is still being built is replaced by this one
+    if (m_nextConfig)
+    {
+        std::shared_ptr<const TerrainConfig> cancelled = m_nextConfig;
+        releaseDiscardedRequests(m_workerPool->discardQueued([&](const ChunkBuildRequest &r)
+                                                             { return r.config == cancelled; }));
+        m_nextConfig.reset();
+        m_nextDiskCache.reset();
+        m_nextPendingChunks.clear();
+        m_nextChunks.clear();
+    }
+
+    auto next = std::make_shared<const TerrainConfig>(config);
+
+    // Same grid: the resident chunks stay, only distances, budgets and uniforms change
+    if (config.sameChunkLayout(*m_config))
+    {
+        m_config = next;
+        applyConfig();
+        m_ringDirty = true;
+        return;
+    }
+
+    // New grid: build the ring around the camera in the background, the old chunks keep rendering until it is done.
+    // No edges are shared, the neighbours of the old layout are at other positions.
+    m_nextConfig = next;
+    m_nextDiskCache = makeDiskCache(config);
+
+    ChunkCoord minCoord, maxCoord;
+    chunkRing(m_lastCameraPosition, config, minCoord, maxCoord);
+    for (ChunkCoord c = minCoord; c.x <= maxCoord.x; c.x++)
+    {
+        for (c.z = minCoord.z; c.z <= maxCoord.z; c.z++)
+        {
+            ChunkBuildRequest request;
+            request.coord = c;
+            request.config = m_nextConfig;
+            request.diskCache = m_nextDiskCache;
+            m_nextPendingChunks.insert(c);
+            m_workerPool->request(std::move(request));
+        }
+    }
+}
+
+void TerrainChunkManager::finishConfigSwitch()
+{
+    // Old layout requests that were not started yet are not needed anymore, the ones in flight are dropped when they finish
+    releaseDiscardedRequests(m_workerPool->discardQueued([&](const ChunkBuildRequest &r)
+                                                         { return r.config != m_nextConfig; }));
+    m_pendingChunks.clear();
+    m_streamQueue.clear();
+    m_neededSince.clear();
+
+    // Every resident chunk and everything sized for the old grid goes
+    for (auto &chunk : m_chunks)
+        removeVegetation(*chunk);
+    m_chunks.clear();
+    m_chunkIndex.clear();
+    m_lru.clear();
+    m_residentBytes = 0;
+    m_heightOnlyLru.clear();
+    m_heightOnlyIndex.clear();
+
+    // Their slots go with the mega buffer
+    if (m_gpuGenerator)
+        cancelGpuChunks(false);
+
+    m_megaBuffer.reset();
+    for (auto &indexBuffer : m_chunkIndexBuffers)
+        indexBuffer.reset();
+    m_gridVertexBuffer.reset();
+    m_heightMaps.reset();
+    m_freeHeightMapLayers.clear();
+    m_splatMaps.reset();
+    m_freeSplatLayers.clear();
+
+    m_config = std::move(m_nextConfig);
+    m_diskCache = std::move(m_nextDiskCache);
+    applyConfig();
+
+    // Swap in the new ring in one go
+    chunkRing(m_lastCameraPosition, *m_config, m_ringMin, m_ringMax);
+    for (auto &data : m_nextChunks)
+    {
+        std::unique_ptr<Chunk> chunk = uploadChunk(*data);
+        chunk->setActiveStatus(chunk->inBounds(m_ringMin, m_ringMax));
+        addChunk(std::move(chunk));
+    }
+    m_nextChunks.clear();
+    m_nextPendingChunks.clear();
+
+    // The camera may have moved on while the ring was built
+    m_ringDirty = true;
     m_treesNeedUpdate = true;
+}
 
-    return chunk;
+void TerrainChunkManager::chunkRing(const glm::vec3 &position, const TerrainConfig &config, ChunkCoord &minCoord, ChunkCoord &maxCoord)
+{
+    ChunkCoord center = {static_cast<int>(std::floor(position.x / config.chunkSize)),
+                         static_cast<int>(std::floor(position.z / config.chunkSize))};
+    int chunkRadius = static_cast<int>(std::ceil(config.renderDistance / config.chunkSize));
+
+    minCoord = {center.x - chunkRadius, center.z - chunkRadius};
+    maxCoord = {center.x + chunkRadius, center.z + chunkRadius};
 }
 
 void TerrainChunkManager::loadChunk(const ChunkCoord &coord)
 {
     // Check if chunk already exists. Dont load again
-    for (auto &c : m_chunks)
+    if (Chunk *c = findChunk(coord))
     {
-        if (c->coord == coord)
-        {
-            // Activate
-            c->setActiveStatus(true);
-            return;
-        }
+        // Activate
+        if (!c->isActive())
+            m_treesNeedUpdate = true;
+        c->setActiveStatus(true);
+        touchChunk(c);
+        m_stats.hits++;
+        return;
     }
 
-    // Generate new chunk
-    std::unique_ptr<Chunk> chunk = generateNewChunk(coord);
+    // Already on its way
+    if (m_pendingChunks.count(coord))
+        return;
 
-    m_chunks.push_back(std::move(chunk));
+    m_stats.misses++;
+
+    // Generated by the compute shader when it has a free job, collectGpuChunks passes it on to the worker pool.
+    // Height only chunks already have their heights.
+    if (m_gpuGenerator && !m_heightOnlyIndex.count(coord) && submitGpuChunk(coord))
+    {
+        m_pendingChunks.insert(coord);
+        return;
+    }
+
+    // Build it in the background, it is uploaded by processFinishedChunks in a later frame
+    ChunkBuildRequest request = makeBuildRequest(coord);
+    promoteHeightOnlyChunk(request);
+    m_pendingChunks.insert(coord);
+    m_workerPool->request(std::move(request));
+}
+
+const TerrainChunkManager::HeightOnlyChunk &TerrainChunkManager::getHeightOnlyChunk(const ChunkCoord &coord)
+{
+    auto it = m_heightOnlyIndex.find(coord);
+    if (it != m_heightOnlyIndex.end())
+    {
+        m_heightOnlyLru.splice(m_heightOnlyLru.begin(), m_heightOnlyLru, it->second);
+        m_stats.hits++;
+        return *it->second;
+    }
+    m_stats.misses++;
+
+    // Only the heights, a few hundred noise samples instead of a whole chunk with mesh, trees and upload.
+    // Same values the full chunk gets: the disk cache, neighbour edges and the generator all agree bit for bit.
+    HeightOnlyChunk chunk;
+    chunk.coord = coord;
+    std::vector<VegetationInstance> vegetation;
+    if (!m_diskCache || !m_diskCache->load(coord, chunk.heightGrid, vegetation))
+        buildHeightField(makeBuildRequest(coord), chunk.heightGrid);
+    chunk.heightPyramid.build(chunk.heightGrid, m_config->cellsPerAxis(), 100.0f);
+
+    m_heightOnlyLru.push_front(std::move(chunk));
+    m_heightOnlyIndex[coord] = m_heightOnlyLru.begin();
+
+    while (m_heightOnlyLru.size() > (size_t)std::max(m_config->heightOnlyChunks, 1))
+    {
+        m_heightOnlyIndex.erase(m_heightOnlyLru.back().coord);
+        m_heightOnlyLru.pop_back();
+    }
+    return m_heightOnlyLru.front();
+}
+
+void TerrainChunkManager::promoteHeightOnlyChunk(ChunkBuildRequest &request)
+{
+    auto it = m_heightOnlyIndex.find(request.coord);
+    if (it == m_heightOnlyIndex.end())
+        return;
+
+    // Kept until the full chunk is added, getPreciseHeightAt still needs it while the chunk is in flight
+    request.heightGrid = it->second->heightGrid;
 }
 
 void TerrainChunkManager::garbageCollectChunks()
 {
+    evictChunks(m_memoryBudget, 0);
+}
+
+void TerrainChunkManager::evictChunks(size_t byteBudget, size_t freeSlots)
+{
+    auto needsEviction = [&]()
+    {
+        if (m_residentBytes > byteBudget)
+            return true;
+        return m_megaBuffer && m_megaBuffer->getFreeSlotCount() < freeSlots;
+    };
+    if (!needsEviction())
+        return;
 
 #ifdef DEBUG
     size_t before = m_chunks.size();
 #endif
+    // Least recently used first. Active chunks are in use (and recently touched), they always stay.
+    std::unordered_set<Chunk *> evicted;
+    for (auto it = m_lru.end(); it != m_lru.begin() && needsEviction();)
+    {
+        --it;
+        Chunk *chunk = *it;
+        if (chunk->isActive())
+            continue;
+
+        // Give the height map layer back (TC_GPU_DISPLACEMENT)
+        if (chunk->heightMapLayer >= 0)
+            m_freeHeightMapLayers.push_back(chunk->heightMapLayer);
+        if (chunk->splatLayer >= 0)
+            m_freeSplatLayers.push_back(chunk->splatLayer);
+
+        // Same for the mega buffer slot, the next chunk uploads into it (TC_MEGA_BUFFER)
+        if (chunk->megaBufferSlot >= 0)
+            m_megaBuffer->free(chunk->megaBufferSlot);
+
+        // Deactivated in the same updateChunks, renderTrees has not removed its vegetation yet
+        removeVegetation(*chunk);
+
+        m_residentBytes -= chunk->memoryBytes;
+        m_chunkIndex.erase(chunk->coord);
+        it = m_lru.erase(it);
+        evicted.insert(chunk);
+    }
+
+    if (evicted.empty())
+        return;
+
+    m_stats.evictions += evicted.size();
     m_chunks.erase(std::remove_if(m_chunks.begin(), m_chunks.end(),
-                                  [](const std::unique_ptr<Chunk> &chunk)
-                                  { return !chunk->isActive(); }),
+                                  [&](const std::unique_ptr<Chunk> &chunk)
+                                  { return evicted.count(chunk.get()) != 0; }),
                    m_chunks.end());
 #ifdef DEBUG
-    DEBUG_PRINT("Garbage collecting chunks. Before: " << before << " chunks. After: " << m_chunks.size() << " chunks.");
+    DEBUG_PRINT("Evicted chunks. Before: " << before << " chunks. After: " << m_chunks.size() << " chunks, " << m_residentBytes / 1024 << " KiB resident.");
 #endif
 }
 
-void TerrainChunkManager::updateChunks(const glm::vec3 &cameraPosition)
+void TerrainChunkManager::updateChunks(const glm::vec3 &cameraPosition, const StreamingHint &hint)
 {
-    // Optimization: Only update chunks if camera moved significantly
-    float distanceMoved = glm::distance(cameraPosition, m_lastCameraPosition);
-    if (distanceMoved < TC_UPDATE_THRESHOLD)
-    {
-        return; // Skip update, we havent moved far enough
-    }
+    // Upload whatever the workers finished since last frame (bounded, so we never stall a frame)
+    processFinishedChunks();
 
-    m_lastCameraPosition = cameraPosition;
+    // Cheap, and has to follow the camera more closely than the chunk ring does
+    updateChunkLods(cameraPosition);
 
-    // Calculate which chunks should be loaded based on camera position
-    ChunkCoord cameraChunk = worldToChunk(cameraPosition);
+    // Where the camera will be in a moment if it keeps going
+    float lookahead = hint.sprinting ? m_config->sprintPrefetchSeconds : m_config->prefetchSeconds;
+    glm::vec3 prefetchPosition = cameraPosition + glm::vec3(hint.velocity.x, 0.0f, hint.velocity.z) * lookahead;
+
+    // Optimization: Only update the rings if the camera (or where it is heading) moved significantly
+    float distanceMoved = glm::distance(cameraPosition, m_lastCameraPosition);
+    float prefetchMoved = glm::distance(prefetchPosition, m_lastPrefetchPosition);
+    if (m_ringDirty || distanceMoved >= m_config->updateThreshold || prefetchMoved >= m_config->updateThreshold)
+        updateRing(cameraPosition, prefetchPosition);
 
-    int chunkRadius = static_cast<int>(std::ceil(TC_RENDER_DISTANCE / TC_CHUNK_SIZE)); // TODO: make this a constant? since it is defined by two constants?
+    // Every frame, so the order follows the camera
+    streamChunks(cameraPosition, hint);
+}
 
-    ChunkCoord minCoord = {cameraChunk.x - chunkRadius, cameraChunk.z - chunkRadius};
-    ChunkCoord maxCoord = {cameraChunk.x + chunkRadius, cameraChunk.z + chunkRadius};
+void TerrainChunkManager::updateRing(const glm::vec3 &cameraPosition, const glm::vec3 &prefetchPosition)
+{
+    m_ringDirty = false;
+    m_lastCameraPosition = cameraPosition;
+    m_lastPrefetchPosition = prefetchPosition;
 
-    // Load all chunks in the range
+    // Calculate which chunks should be loaded based on camera position
+    ChunkCoord minCoord, maxCoord;
+    chunkRing(cameraPosition, *m_config, minCoord, maxCoord);
+    m_ringMin = minCoord;
+    m_ringMax = maxCoord;
+
+    // And which ones are loaded ahead of time, the same ring when standing still
+    ChunkCoord prefetchMin, prefetchMax;
+    chunkRing(prefetchPosition, *m_config, prefetchMin, prefetchMax);
+
+    auto inRing = [](const ChunkCoord &c, const ChunkCoord &lo, const ChunkCoord &hi)
+    { return c.x >= lo.x && c.x <= hi.x && c.z >= lo.z && c.z <= hi.z; };
+    auto needed = [&](const ChunkCoord &c)
+    { return inRing(c, minCoord, maxCoord) || inRing(c, prefetchMin, prefetchMax); };
+
+    // Forget queued chunks we have moved away from before they were even started (a layout switch keeps its own)
+    std::vector<ChunkBuildRequest> discarded = m_workerPool->discardQueued([&](const ChunkBuildRequest &r)
+                                                                           { return r.config != m_nextConfig && !needed(r.coord); });
+    for (const ChunkBuildRequest &r : discarded)
+        m_pendingChunks.erase(r.coord);
+    releaseDiscardedRequests(discarded);
+    std::erase_if(m_neededSince, [&](const auto &entry)
+                  { return !needed(entry.first); });
+
+    // Activate the resident chunks of the ring, queue the missing ones of both rings. When each one
+    // became needed is kept from earlier rings.
+    const auto now = std::chrono::steady_clock::now();
+    m_streamQueue.clear();
+    auto require = [&](const ChunkCoord &c, bool active)
+    {
+        if (Chunk *chunk = findChunk(c))
+        {
+            if (active)
+                loadChunk(c);
+            else
+                touchChunk(chunk); // prefetched, kept over older inactive chunks
+            return;
+        }
+        m_neededSince.emplace(c, now);
+        if (!m_pendingChunks.count(c))
+            m_streamQueue.push_back(c);
+    };
     for (ChunkCoord c = minCoord; c.x <= maxCoord.x; c.x++)
     {
         for (c.z = minCoord.z; c.z <= maxCoord.z; c.z++)
+            require(c, true);
+    }
+    for (ChunkCoord c = prefetchMin; c.x <= prefetchMax.x; c.x++)
+    {
+        for (c.z = prefetchMin.z; c.z <= prefetchMax.z; c.z++)
         {
-            loadChunk(c);
+            if (!inRing(c, minCoord, maxCoord))
+                require(c, false);
         }
     }
 
@@ -213,16 +1207,121 @@ void TerrainChunkManager::updateChunks(const glm::vec3 &cameraPosition)
         m_treesNeedUpdate = true;
     }
 
-    if (m_chunks.size() > TC_GC_THRESHOLD)
+    // Only inactive chunks are evicted
+    garbageCollectChunks();
+}
+
+void TerrainChunkManager::streamChunks(const glm::vec3 &cameraPosition, const StreamingHint &hint)
+{
+    const TerrainConfig &config = *m_config;
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&]()
+    { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+    m_streamingStats.generationMs = 0.0;
+
+    // Requested by a height query, or resident, since the queue was built
+    std::erase_if(m_streamQueue, [&](const ChunkCoord &c)
+                  { return findChunk(c) || m_pendingChunks.count(c); });
+
+    size_t maxInFlight = config.maxChunksInFlight > 0 ? (size_t)config.maxChunksInFlight
+                                                      : 2 * (size_t)m_workerPool->getThreadCount() + (m_gpuGenerator ? GpuTerrainGenerator::MAX_JOBS : 0);
+    if (m_streamQueue.empty() || m_pendingChunks.size() >= maxInFlight)
+        return;
+
+    // Flat directions that make a chunk more urgent, zero when there is none
+    auto flatDirection = [](const glm::vec3 &v)
     {
-        garbageCollectChunks();
-        m_treesNeedUpdate = true;  // Trees need update after GC
+        glm::vec2 d(v.x, v.z);
+        float length = glm::length(d);
+        return length > 1e-3f ? d / length : glm::vec2(0.0f);
+    };
+    const glm::vec2 viewDirection = flatDirection(hint.viewDirection);
+    const glm::vec2 moveDirection = flatDirection(hint.velocity);
+
+    // Horizontal distance to the closest point of the chunk (0 for the one we are in), shortened by up to
+    // streamingDirectionWeight for chunks straight ahead
+    auto priority = [&](const ChunkCoord &c)
+    {
+        float minX = (float)(c.x * config.chunkSize);
+        float minZ = (float)(c.z * config.chunkSize);
+        float dx = std::max({minX - cameraPosition.x, 0.0f, cameraPosition.x - (minX + config.chunkSize)});
+        float dz = std::max({minZ - cameraPosition.z, 0.0f, cameraPosition.z - (minZ + config.chunkSize)});
+        float distance = std::sqrt(dx * dx + dz * dz);
+
+        glm::vec2 toCenter(minX + 0.5f * config.chunkSize - cameraPosition.x, minZ + 0.5f * config.chunkSize - cameraPosition.z);
+        float length = glm::length(toCenter);
+        if (length < 1e-3f)
+            return distance;
+        toCenter /= length;
+        float ahead = std::max({0.0f, glm::dot(toCenter, viewDirection), glm::dot(toCenter, moveDirection)});
+        return distance * (1.0f - config.streamingDirectionWeight * ahead);
+    };
+
+    // Min heap on the priority
+    m_streamOrder.clear();
+    for (const ChunkCoord &c : m_streamQueue)
+        m_streamOrder.push_back({priority(c), c});
+    auto later = [](const std::pair<float, ChunkCoord> &a, const std::pair<float, ChunkCoord> &b)
+    { return a.first > b.first; };
+    std::make_heap(m_streamOrder.begin(), m_streamOrder.end(), later);
+
+    size_t requested = 0;
+    while (!m_streamOrder.empty() && m_pendingChunks.size() < maxInFlight)
+    {
+        if (requested > 0 && elapsedMs() >= config.generationBudgetMs)
+            break;
+        std::pop_heap(m_streamOrder.begin(), m_streamOrder.end(), later);
+        loadChunk(m_streamOrder.back().second);
+        m_streamOrder.pop_back();
+        requested++;
     }
+
+    // The rest waits for the next frame
+    m_streamQueue.clear();
+    for (const auto &entry : m_streamOrder)
+        m_streamQueue.push_back(entry.second);
+    m_streamingStats.generationMs = elapsedMs();
 }
 
+void TerrainChunkManager::updateChunkLods(const glm::vec3 &cameraPosition)
+{
+    const TerrainConfig &config = *m_config;
 
-float Chunk::getPreciseHeightAt(float worldX, float worldZ, int chunkSize, int vertexStep) const
+    // Level n starts at lodDistance * 2^(n-1)
+    auto lodDistance = [&](int lod)
+    { return config.lodDistance * (float)(1 << (lod - 1)); };
+
+    for (auto &chunk : m_chunks)
+    {
+        if (!chunk->isActive())
+            continue;
+
+        // Horizontal distance to the closest point of the chunk
+        float minX = (float)(chunk->coord.x * config.chunkSize);
+        float minZ = (float)(chunk->coord.z * config.chunkSize);
+        float dx = std::max({minX - cameraPosition.x, 0.0f, cameraPosition.x - (minX + config.chunkSize)});
+        float dz = std::max({minZ - cameraPosition.z, 0.0f, cameraPosition.z - (minZ + config.chunkSize)});
+        float distance = std::sqrt(dx * dx + dz * dz);
+
+        // Only move a level once we are lodHysteresis past its boundary
+        int lod = chunk->getLod();
+        while (lod + 1 < TC_LOD_LEVELS && distance > lodDistance(lod + 1) + config.lodHysteresis)
+            lod++;
+        while (lod > 0 && distance < lodDistance(lod) - config.lodHysteresis)
+            lod--;
+
+        if (lod != chunk->getLod())
+            chunk->setLod(lod, m_chunkIndexBuffers[lod]);
+    }
+}
+
+// Interpolated height of a chunk's height grid, for full and height only chunks alike
+static float sampleHeightGrid(const std::vector<float> &heightGrid, int gridSize, const ChunkCoord &coord,
+                              float worldX, float worldZ, int chunkSize, int vertexStep)
 {
+    auto gridHeight = [&](int gx, int gz)
+    { return heightGrid[gz * gridSize + gx]; };
+
     // Convert world → local chunk coordinates
     float localX = worldX - coord.x * chunkSize;
     float localZ = worldZ - coord.z * chunkSize;
@@ -252,10 +1351,10 @@ float Chunk::getPreciseHeightAt(float worldX, float worldZ, int chunkSize, int v
     if (raw_j != j) fz = 0.999f;
 
     // --- Fetch quad heights (these are guaranteed valid now) ---------------
-    float h00 = heightGrid[j][i];
-    float h10 = heightGrid[j][i + 1];
-    float h01 = heightGrid[j + 1][i];
-    float h11 = heightGrid[j + 1][i + 1];
+    float h00 = gridHeight(i, j);
+    float h10 = gridHeight(i + 1, j);
+    float h01 = gridHeight(i, j + 1);
+    float h11 = gridHeight(i + 1, j + 1);
 
     // --- FIX 3: Detect "border zeros" and re-sample from neighbor chunk ----
     bool zeroRow = (h00 == 0 && h01 == 0);
@@ -296,151 +1395,400 @@ float Chunk::getPreciseHeightAt(float worldX, float worldZ, int chunkSize, int v
     return h * 100.0f; // your terrain heightScale
 }
 
+// sampleHeightGrid for n points of the same chunk, four at a time with SSE2. Same operations in the same
+// order (and no FMA), so the heights are bit-identical to sampleHeightGrid.
+static void sampleHeightGridBatch(const std::vector<float> &heightGrid, int gridSize, const ChunkCoord &coord,
+                                  const float *xs, const float *zs, float *out, size_t n, int chunkSize, int vertexStep)
+{
+    size_t p = 0;
+#ifdef TERRAIN_HEIGHTS_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 size = _mm_set1_ps((float)chunkSize);
+    const __m128 step = _mm_set1_ps((float)vertexStep);
+    const __m128 maxIndex = _mm_set1_ps((float)(chunkSize / vertexStep - 1));
+    const __m128 originX = _mm_set1_ps((float)(coord.x * chunkSize));
+    const __m128 originZ = _mm_set1_ps((float)(coord.z * chunkSize));
+
+    auto select = [](__m128 mask, __m128 a, __m128 b)
+    { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+    auto floorPs = [](__m128 v)
+    {
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmplt_ps(v, t), _mm_set1_ps(1.0f)));
+    };
+
+    for (; p + 4 <= n; p += 4)
+    {
+        __m128 localX = _mm_sub_ps(_mm_loadu_ps(xs + p), originX);
+        __m128 localZ = _mm_sub_ps(_mm_loadu_ps(zs + p), originZ);
+        __m128 outside = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(localX, zero), _mm_cmplt_ps(localZ, zero)),
+                                   _mm_or_ps(_mm_cmpgt_ps(localX, size), _mm_cmpgt_ps(localZ, size)));
+
+        // Grid indices as floats, they are small integers so the clamp is exact
+        __m128 rawI = floorPs(_mm_div_ps(localX, step));
+        __m128 rawJ = floorPs(_mm_div_ps(localZ, step));
+        __m128 i = _mm_min_ps(_mm_max_ps(rawI, zero), maxIndex);
+        __m128 j = _mm_min_ps(_mm_max_ps(rawJ, zero), maxIndex);
+        __m128 fx = _mm_div_ps(_mm_sub_ps(localX, _mm_mul_ps(i, step)), step);
+        __m128 fz = _mm_div_ps(_mm_sub_ps(localZ, _mm_mul_ps(j, step)), step);
+        fx = select(_mm_cmpneq_ps(rawI, i), _mm_set1_ps(0.999f), fx);
+        fz = select(_mm_cmpneq_ps(rawJ, j), _mm_set1_ps(0.999f), fz);
+
+        // The four corners have no SIMD load without AVX2 gathers
+        // (lanes outside the chunk are clamped to valid indices as well, their result is dropped)
+        alignas(16) int corner[4];
+        _mm_store_si128((__m128i *)corner, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(j, _mm_set1_ps((float)gridSize)), i)));
+        const float *g = heightGrid.data();
+        __m128 h00 = _mm_setr_ps(g[corner[0]], g[corner[1]], g[corner[2]], g[corner[3]]);
+        __m128 h10 = _mm_setr_ps(g[corner[0] + 1], g[corner[1] + 1], g[corner[2] + 1], g[corner[3] + 1]);
+        __m128 h01 = _mm_setr_ps(g[corner[0] + gridSize], g[corner[1] + gridSize], g[corner[2] + gridSize], g[corner[3] + gridSize]);
+        __m128 h11 = _mm_setr_ps(g[corner[0] + gridSize + 1], g[corner[1] + gridSize + 1], g[corner[2] + gridSize + 1], g[corner[3] + gridSize + 1]);
+
+        // Border zeros, see sampleHeightGrid
+        __m128 h00Zero = _mm_cmpeq_ps(h00, zero);
+        __m128 border = _mm_and_ps(h00Zero, _mm_or_ps(_mm_cmpeq_ps(h01, zero), _mm_cmpeq_ps(h10, zero)));
+        if (_mm_movemask_ps(border))
+        {
+            const __m128 almostOne = _mm_set1_ps(0.99f);
+            const __m128 tiny = _mm_set1_ps(0.0001f);
+            fx = select(border, _mm_min_ps(fx, almostOne), fx);
+            fz = select(border, _mm_min_ps(fz, almostOne), fz);
+            h00 = select(border, _mm_max_ps(h00, tiny), h00);
+            h10 = select(border, _mm_max_ps(h10, tiny), h10);
+            h01 = select(border, _mm_max_ps(h01, tiny), h01);
+            h11 = select(border, _mm_max_ps(h11, tiny), h11);
+        }
+
+        // Both triangles, then pick per lane
+        __m128 lower = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h00, _mm_sub_ps(_mm_sub_ps(one, fx), fz)), _mm_mul_ps(h01, fz)), _mm_mul_ps(h10, fx));
+        __m128 upper = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h10, _mm_sub_ps(one, fz)), _mm_mul_ps(h11, _mm_sub_ps(_mm_add_ps(fx, fz), one))),
+                                  _mm_mul_ps(h01, _mm_sub_ps(one, fx)));
+        __m128 h = select(_mm_cmplt_ps(_mm_add_ps(fx, fz), one), lower, upper);
+        _mm_storeu_ps(out + p, _mm_andnot_ps(outside, _mm_mul_ps(h, _mm_set1_ps(100.0f))));
+    }
+#endif
+    for (; p < n; p++)
+        out[p] = sampleHeightGrid(heightGrid, gridSize, coord, xs[p], zs[p], chunkSize, vertexStep);
+}
+
+float Chunk::getPreciseHeightAt(float worldX, float worldZ, int chunkSize, int vertexStep) const
+{
+    return sampleHeightGrid(heightGrid, gridSize, coord, worldX, worldZ, chunkSize, vertexStep);
+}
+
+const std::vector<float> &TerrainChunkManager::getHeightGrid(const ChunkCoord &coord, const HeightPyramid **pyramid)
+{
+    if (Chunk *chunk = findChunk(coord))
+    {
+        touchChunk(chunk);
+        m_stats.hits++;
+        if (pyramid)
+            *pyramid = &chunk->heightPyramid;
+        return chunk->heightGrid;
+    }
+
+    // Gameplay needs the height now, cant wait for the workers, but a mesh is not needed for it.
+    // Enemies spawn well outside the ring, those chunks may never be drawn. A chunk in the ring
+    // is requested as usual and takes these heights along.
+    const HeightOnlyChunk &heightOnly = getHeightOnlyChunk(coord);
+    if (coord.x >= m_ringMin.x && coord.x <= m_ringMax.x && coord.z >= m_ringMin.z && coord.z <= m_ringMax.z)
+        loadChunk(coord);
+    if (pyramid)
+        *pyramid = &heightOnly.heightPyramid;
+    return heightOnly.heightGrid;
+}
+
 float TerrainChunkManager::getPreciseHeightAt(float x, float z)
 {
     ChunkCoord cc = worldToChunk(glm::vec3(x,0,z));
+    return sampleHeightGrid(getHeightGrid(cc), m_config->verticesPerAxis(), cc, x, z, m_config->chunkSize, m_config->vertexStep);
+}
 
-    for (auto &chunk : m_chunks)
+void TerrainChunkManager::getPreciseHeightsBatch(const float *xs, const float *zs, float *out, size_t n)
+{
+    const TerrainConfig &config = *m_config;
+    const float chunkSize = (float)config.chunkSize;
+
+    // Group the points by chunk: an open addressing table from chunk to group, then a counting sort by group.
+    // A comparison sort of a few thousand points costs more than the lookups it saves.
+    const size_t tableSize = std::bit_ceil(std::max<size_t>(2 * n, 16));
+    m_heightQueryTable.assign(tableSize, -1);
+    m_heightQueryChunks.clear();
+    m_heightQueryStart.clear();
+    m_heightQueryGroup.resize(n);
+    for (size_t i = 0; i < n; i++)
     {
-        if (chunk->coord.x == cc.x && chunk->coord.z == cc.z)
+        // Same as worldToChunk without the floorf calls
+        float qx = xs[i] / chunkSize;
+        float qz = zs[i] / chunkSize;
+        ChunkCoord c = {(int)qx, (int)qz};
+        c.x -= qx < (float)c.x;
+        c.z -= qz < (float)c.z;
+
+        // std::hash<ChunkCoord> puts nearby chunks in nearby buckets, that makes long probe runs here
+        size_t slot = (((uint32_t)c.x * 73856093u) ^ ((uint32_t)c.z * 19349663u)) & (tableSize - 1);
+        while (m_heightQueryTable[slot] >= 0 && !(m_heightQueryChunks[m_heightQueryTable[slot]] == c))
+            slot = (slot + 1) & (tableSize - 1);
+        if (m_heightQueryTable[slot] < 0)
         {
-            return chunk->getPreciseHeightAt(x, z, TC_CHUNK_SIZE, TC_VERTEX_STEP);
+            m_heightQueryTable[slot] = (int)m_heightQueryChunks.size();
+            m_heightQueryChunks.push_back(c);
+            m_heightQueryStart.push_back(0);
         }
+        m_heightQueryGroup[i] = m_heightQueryTable[slot];
+        m_heightQueryStart[m_heightQueryGroup[i]]++;
     }
 
-    loadChunk(cc);
+    // Counts to end offsets, then the point indices in group order. Placing them back to front
+    // moves every end down to its group's start.
+    const size_t groups = m_heightQueryChunks.size();
+    for (size_t g = 1; g < groups; g++)
+        m_heightQueryStart[g] += m_heightQueryStart[g - 1];
+    m_heightQueryOrder.resize(n);
+    for (size_t i = n; i-- > 0;)
+        m_heightQueryOrder[--m_heightQueryStart[m_heightQueryGroup[i]]] = (uint32_t)i;
+    m_heightQueryStart.push_back((uint32_t)n);
+
+    // One lookup per chunk, its points interpolated in blocks
+    constexpr size_t BLOCK = 64;
+    float runX[BLOCK], runZ[BLOCK], runOut[BLOCK];
+    for (size_t g = 0; g < groups; g++)
+    {
+        const ChunkCoord &c = m_heightQueryChunks[g];
+        const std::vector<float> &heightGrid = getHeightGrid(c);
 
-    // Now find it again
-    for (auto &chunk : m_chunks)
+        const uint32_t end = m_heightQueryStart[g + 1];
+        for (uint32_t block = m_heightQueryStart[g]; block < end; block += BLOCK)
+        {
+            const size_t count = std::min<size_t>(BLOCK, end - block);
+            for (size_t k = 0; k < count; k++)
+            {
+                runX[k] = xs[m_heightQueryOrder[block + k]];
+                runZ[k] = zs[m_heightQueryOrder[block + k]];
+            }
+            sampleHeightGridBatch(heightGrid, config.verticesPerAxis(), c, runX, runZ, runOut, count, config.chunkSize, config.vertexStep);
+            for (size_t k = 0; k < count; k++)
+                out[m_heightQueryOrder[block + k]] = runOut[k];
+        }
+    }
+}
+
+TerrainHit TerrainChunkManager::raycast(const TerrainRay &ray)
+{
+    const TerrainConfig &config = *m_config;
+    const float chunkSize = (float)config.chunkSize;
+    const glm::vec3 &o = ray.origin;
+    const glm::vec3 &d = ray.direction;
+    TerrainHit hit;
+
+    // 2D DDA over the chunk grid: t where the ray crosses the next chunk border on each axis, and how far apart those are
+    ChunkCoord c = worldToChunk(o);
+    const int stepX = d.x > 0.0f ? 1 : d.x < 0.0f ? -1 : 0;
+    const int stepZ = d.z > 0.0f ? 1 : d.z < 0.0f ? -1 : 0;
+    const float infinity = std::numeric_limits<float>::infinity();
+    float nextX = stepX ? ((c.x + (stepX > 0)) * chunkSize - o.x) / d.x : infinity;
+    float nextZ = stepZ ? ((c.z + (stepZ > 0)) * chunkSize - o.z) / d.z : infinity;
+    const float deltaX = stepX ? chunkSize / std::fabs(d.x) : infinity;
+    const float deltaZ = stepZ ? chunkSize / std::fabs(d.z) : infinity;
+
+    float t = 0.0f;
+    while (t <= ray.maxDistance)
     {
-        if (chunk->coord.x == cc.x && chunk->coord.z == cc.z)
+        const float tExit = std::min({nextX, nextZ, ray.maxDistance});
+
+        const HeightPyramid *pyramid = nullptr;
+        const std::vector<float> &heightGrid = getHeightGrid(c, &pyramid);
+        const glm::vec3 corner((float)(c.x * config.chunkSize), 0.0f, (float)(c.z * config.chunkSize));
+        float tHit;
+        if (pyramid->intersect(heightGrid, (float)config.vertexStep, o - corner, d, t, tExit, tHit, hit.nodeVisits))
+        {
+            hit.hit = true;
+            hit.distance = tHit;
+            hit.position = o + d * tHit;
+            return hit;
+        }
+
+        if (tExit >= ray.maxDistance)
+            break;
+        if (nextX < nextZ)
         {
-            return chunk->getPreciseHeightAt(x, z, TC_CHUNK_SIZE, TC_VERTEX_STEP);
+            c.x += stepX;
+            t = nextX;
+            nextX += deltaX;
+        }
+        else
+        {
+            c.z += stepZ;
+            t = nextZ;
+            nextZ += deltaZ;
         }
     }
+    return hit;
+}
 
-    return 0.0f;
+void TerrainChunkManager::raycastBatch(const TerrainRay *rays, TerrainHit *hits, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        hits[i] = raycast(rays[i]);
 }
 
-void TerrainChunkManager::renderTrees(const glm::mat4& view, const glm::mat4& projection, PhongLightConfig* light)
+bool TerrainChunkManager::hasLineOfSight(const glm::vec3 &from, const glm::vec3 &to)
 {
-    if (!m_treeRenderer)
-        return;
+    return !raycast({from, to - from, 1.0f}).hit;
+}
 
-    // Rebuild instance data if chunks changed
-    if (m_treesNeedUpdate)
+void TerrainChunkManager::renderChunks(const glm::mat4 &view, const glm::mat4 &projection, PhongLightConfig *light)
+{
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    m_visibleChunkCount = 0;
+    m_culledChunkCount = 0;
+    for (const auto &chunk : m_chunks)
     {
-        m_treeRenderer->clearInstances();
-        
-        for (const auto& chunk : m_chunks)
+        if (!chunk->isActive())
+            continue;
+
+        if (!frustum.intersectsAABB(chunk->boundsMin, chunk->boundsMax))
         {
-            if (!chunk->isActive())
-                continue;
-                
-            for (const auto& pos : chunk->treePositions)
-            {
-                // Add some random-ish rotation based on position for variety
-                float rotation = std::fmod(pos.x * 17.3f + pos.z * 31.7f, 360.0f);
-                m_treeRenderer->addInstance(pos, 1.0f, rotation);
-            }
+            m_culledChunkCount++;
+            continue;
         }
-        
-        m_treeRenderer->uploadInstanceData();
-        m_treesNeedUpdate = false;
+
+        m_visibleChunkCount++;
+#if TC_MEGA_BUFFER
+        if (chunk->megaBufferSlot >= 0)
+            m_megaBuffer->addDraw(chunk->megaBufferSlot, chunk->getLod());
+#else
+        chunk->render(view, projection, light);
+#endif
     }
 
-    m_treeRenderer->render(view, projection, light);
+#if TC_MEGA_BUFFER
+    renderMegaBuffer(view, projection, light);
+#endif
 }
 
-void TerrainChunkManager::renderWater(const glm::mat4& view, const glm::mat4& projection, PhongLightConfig* light, const glm::vec3& cameraPosition, float renderDistance)
+void TerrainChunkManager::renderMegaBuffer(const glm::mat4 &view, const glm::mat4 &projection, PhongLightConfig *light)
 {
-    if (!m_terrainShader)
+    if (!m_megaBuffer || m_megaBuffer->getQueuedDrawCount() == 0)
         return;
 
-    constexpr float seaLevel = 0.13f * 100.0f + 0.1f;
-    
-    // Single water layer that covers the same area as terrain
-    // Fog is applied identically to water and terrain in the shader
-    float waterSize = renderDistance;  // Same as terrain render distance
-    
-    // Create a subdivided water grid so fog interpolates correctly
-    // (A simple 4-vertex quad would have fog interpolated from corners only)
-    const int gridSize = 10;  // 10x10 grid = 121 vertices
-    const float step = (waterSize * 2.0f) / gridSize;
-    
-    glm::vec3 normal(0.0f, 1.0f, 0.0f);
-    
-    std::vector<TerrainVertex> vertices;
-    vertices.reserve((gridSize + 1) * (gridSize + 1));
-    
-    for (int z = 0; z <= gridSize; z++)
+    // What MeshRenderable::render does per chunk, once for all of them
+    RenderingContext *rContext = RenderingContext::Current();
+    if (m_chunkShader->getID() != rContext->m_boundShader)
+        m_chunkShader->bind();
+
+    for (const auto &texture : m_terrainTextures)
     {
-        for (int x = 0; x <= gridSize; x++)
+        if (rContext->m_boundTextures[texture->getSlot()] != texture->getID())
+            texture->bindNew(texture->getID() % REQUIRED_NUM_TEXTURE_UNITS);
+        m_chunkShader->setUniform(texture->m_targetUniform, texture->getSlot());
+    }
+
+    if (m_splatMaps)
+    {
+        if (rContext->m_boundTextures[m_splatMaps->getSlot()] != m_splatMaps->getID())
+            m_splatMaps->bindNew(m_splatMaps->getID() % REQUIRED_NUM_TEXTURE_UNITS);
+        m_chunkShader->setUniform(m_splatMaps->m_targetUniform, m_splatMaps->getSlot());
+    }
+
+    m_chunkShader->setUniform("u_view", view);
+    m_chunkShader->setUniform("u_projection", projection);
+    if (light != nullptr)
+    {
+        m_chunkShader->setUniform("u_light_position", light->lightPosition);
+        m_chunkShader->setUniform("u_light_ambient", light->ambientLight);
+        m_chunkShader->setUniform("u_light_diffuse", light->diffuseLight);
+        m_chunkShader->setUniform("u_light_specular", light->specularLight);
+        m_chunkShader->setUniform("u_camPos", glm::vec3(glm::inverse(view)[3]));
+    }
+
+    m_megaBuffer->draw(*m_chunkShader);
+}
+
+void TerrainChunkManager::initVegetationRenderers()
+{
+    for (int t = 0; t < VEGETATION_TYPE_COUNT; t++)
+    {
+        const VegetationType &type = VEGETATION_TYPES[t];
+        auto model = std::make_unique<Model>(MODELS_DIR / type.model);
+        std::shared_ptr<ModelData> data = model->getModelData();
+        if (!data || data->getMeshRenderables().empty())
         {
-            float worldX = cameraPosition.x - waterSize + x * step;
-            float worldZ = cameraPosition.z - waterSize + z * step;
-            
-            vertices.push_back({
-                {worldX, seaLevel, worldZ},
-                normal,
-                {worldX / 10.0f, worldZ / 10.0f},
-                0.13f,
-                1.0f  // waterMask = 1.0 for textured water
-            });
+            DEBUG_PRINT("Vegetation model " << type.model << " did not load, no " << type.name << " will be drawn");
+            continue;
         }
+
+        // Bottom center of the bounds to the origin, then scaled to the type's height
+        glm::vec3 size = data->m_boundsMax - data->m_boundsMin;
+        glm::vec3 base((data->m_boundsMin.x + data->m_boundsMax.x) * 0.5f, data->m_boundsMin.y, (data->m_boundsMin.z + data->m_boundsMax.z) * 0.5f);
+        float scale = size.y > 0.0f ? type.height / size.y : 1.0f;
+        m_vegetationModelTransforms[t] = glm::scale(glm::mat4(1.0f), glm::vec3(scale)) * glm::translate(glm::mat4(1.0f), -base);
+
+        m_vegetationRenderers[t] = std::make_unique<InstancedRenderer>();
+        m_vegetationRenderers[t]->init(std::move(model));
+#if TC_TREE_GPU_CULLING
+        m_vegetationRenderers[t]->enableGpuCulling();
+#endif
     }
-    
-    std::vector<unsigned int> indices;
-    indices.reserve(gridSize * gridSize * 6);
-    
-    for (int z = 0; z < gridSize; z++)
+}
+
+void TerrainChunkManager::removeVegetation(Chunk &chunk)
+{
+    for (int t = 0; t < VEGETATION_TYPE_COUNT; t++)
+    {
+        if (chunk.vegetationRanges[t] >= 0)
+            m_vegetationRenderers[t]->removeRange(chunk.vegetationRanges[t]);
+        chunk.vegetationRanges[t] = -1;
+    }
+    chunk.vegetationShown = false;
+}
+
+void TerrainChunkManager::renderTrees(const glm::mat4& view, const glm::mat4& projection, PhongLightConfig* light)
+{
+    // Only chunks that were activated or deactivated since last time touch the instance buffers
+    if (m_treesNeedUpdate)
     {
-        for (int x = 0; x < gridSize; x++)
+        std::array<std::vector<glm::mat4>, VEGETATION_TYPE_COUNT> transforms;
+        for (const auto& chunk : m_chunks)
         {
-            int topLeft = z * (gridSize + 1) + x;
-            int topRight = topLeft + 1;
-            int bottomLeft = (z + 1) * (gridSize + 1) + x;
-            int bottomRight = bottomLeft + 1;
-            
-            // Two triangles per quad
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
-            
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
+            if (chunk->isActive() && !chunk->vegetationShown)
+            {
+                for (auto &typeTransforms : transforms)
+                    typeTransforms.clear();
+                for (const VegetationInstance &v : chunk->vegetation)
+                {
+                    if (m_vegetationRenderers[v.type])
+                        transforms[v.type].push_back(InstancedRenderer::makeTransform(v.position, v.scaleFactor(), v.rotationDegrees()) *
+                                                     m_vegetationModelTransforms[v.type]);
+                }
+                for (int t = 0; t < VEGETATION_TYPE_COUNT; t++)
+                {
+                    if (!transforms[t].empty())
+                        chunk->vegetationRanges[t] = m_vegetationRenderers[t]->addRange(transforms[t]);
+                }
+                chunk->vegetationShown = true;
+            }
+            else if (!chunk->isActive() && chunk->vegetationShown)
+            {
+                removeVegetation(*chunk);
+            }
         }
+        m_treesNeedUpdate = false;
     }
-    
-    auto va_ptr = std::make_unique<VertexArray>();
-    auto vb_ptr = std::make_unique<VertexBuffer>(vertices.data(), vertices.size() * sizeof(TerrainVertex), va_ptr.get());
-    
-    VertexBufferLayout layout;
-    layout.push<float>(3);
-    layout.push<float>(3);
-    layout.push<float>(2);
-    layout.push<float>(1);
-    layout.push<float>(1);
-    va_ptr->addBuffer(vb_ptr.get(), layout);
-    
-    auto ibo_ptr = std::make_unique<IndexBuffer>(indices.data(), indices.size());
-    auto mesh_ptr = std::make_shared<Mesh>(std::move(va_ptr), std::move(vb_ptr), std::move(ibo_ptr));
-    
-    m_waterMesh = std::make_unique<MeshRenderable>(mesh_ptr, m_terrainShader);
-    m_waterMesh->m_textureReferences = m_terrainTextures;
-    m_waterMesh->setUniform("u_fogColor", m_fogColor);
-    m_waterMesh->setUniform("u_fogStart", m_fogStart);
-    m_waterMesh->setUniform("u_fogEnd", m_fogEnd);
-    
-    m_terrainShader->bind();
-    for (size_t i = 0; i < m_terrainTextures.size(); i++)
+
+    for (const auto &renderer : m_vegetationRenderers)
     {
-        m_terrainTextures[i]->bindNew(static_cast<GLuint>(i));
-        m_terrainShader->setUniform(m_terrainTextures[i]->m_targetUniform, static_cast<int>(i));
+        if (renderer)
+            renderer->render(view, projection, light);
     }
-    
-    m_waterMesh->render(view, projection, light);
+}
+
+void TerrainChunkManager::renderWater(const glm::mat4& view, const glm::mat4& projection, PhongLightConfig* light, const glm::vec3& cameraPosition, float renderDistance)
+{
+    // Single water layer that covers the same area as terrain, fogged like the terrain
+    m_waterRenderer->render(view, projection, light, cameraPosition, renderDistance);
 }
 
 void TerrainChunkManager::collectNearbyObstacles(
@@ -448,23 +1796,46 @@ void TerrainChunkManager::collectNearbyObstacles(
     float range,
     std::vector<StaticObstacle>& out) const
 {
-    float rangeSq = range * range;
-    constexpr float TREE_RADIUS = 1.0f;
-
-    for (const auto& chunk : m_chunks)
+    constexpr int CELLS = TC_OBSTACLE_GRID_CELLS;
+    const int chunkSize = m_config->chunkSize;
+    const float CELL_SIZE = (float)chunkSize / CELLS;
+    const float rangeSq = range * range;
+    const glm::vec2 center(pos.x, pos.z);
+
+    // Chunks the search square touches, usually just one
+    int minChunkX = (int)std::floor((pos.x - range) / chunkSize);
+    int maxChunkX = (int)std::floor((pos.x + range) / chunkSize);
+    int minChunkZ = (int)std::floor((pos.z - range) / chunkSize);
+    int maxChunkZ = (int)std::floor((pos.z + range) / chunkSize);
+
+    for (int chunkZ = minChunkZ; chunkZ <= maxChunkZ; chunkZ++)
     {
-        if (!chunk->isActive())
-            continue;
-
-        for (const glm::vec3& p : chunk->treePositions)
+        for (int chunkX = minChunkX; chunkX <= maxChunkX; chunkX++)
         {
-            glm::vec2 d = glm::vec2(p.x, p.z) - glm::vec2(pos.x, pos.z);
-            if (glm::dot(d, d) <= rangeSq)
+            const Chunk *chunk = findChunk({chunkX, chunkZ});
+            if (!chunk || !chunk->isActive() || chunk->obstacles.empty())
+                continue;
+
+            // Cells of this chunk the search square touches
+            float localX = pos.x - (float)(chunkX * chunkSize);
+            float localZ = pos.z - (float)(chunkZ * chunkSize);
+            int minCellX = std::clamp((int)std::floor((localX - range) / CELL_SIZE), 0, CELLS - 1);
+            int maxCellX = std::clamp((int)std::floor((localX + range) / CELL_SIZE), 0, CELLS - 1);
+            int minCellZ = std::clamp((int)std::floor((localZ - range) / CELL_SIZE), 0, CELLS - 1);
+            int maxCellZ = std::clamp((int)std::floor((localZ + range) / CELL_SIZE), 0, CELLS - 1);
+
+            for (int cz = minCellZ; cz <= maxCellZ; cz++)
             {
-                out.push_back({
-                    glm::vec2(p.x, p.z),
-                    TREE_RADIUS
-                });
+                // The cells of one row are next to each other in obstacles
+                uint32_t begin = chunk->obstacleCellStart[cz * CELLS + minCellX];
+                uint32_t end = chunk->obstacleCellStart[cz * CELLS + maxCellX + 1];
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    const StaticObstacle &o = chunk->obstacles[i];
+                    glm::vec2 d = o.posXZ - center;
+                    if (glm::dot(d, d) <= rangeSq)
+                        out.push_back(o);
+                }
             }
         }
     }
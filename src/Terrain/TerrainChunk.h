@@ -9,54 +9,98 @@
 #include "TerrainGenerator.h"
 #include "../InstancedRenderer.h"
 #include "Model.h"
-
+#include "ChunkCoord.h"
+#include "ChunkWorkerPool.h"
+#include "ChunkDiskCache.h"
+#include "ChunkMegaBuffer.h"
+#include "GpuTerrainGenerator.h"
+#include "WaterRenderer.h"
+#include "StaticObstacle.h"
+#include "TerrainRaycast.h"
+#include "VegetationScatter.h"
+#include "../Frustum.h"
+
+#include <array>
+#include <chrono>
+#include <list>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 
-// Terrain chunk represents a subdivided portion of the terrain
-struct ChunkCoord
-{
-    int x;
-    int z;
+#if TC_GPU_DISPLACEMENT && !TC_PACKED_VERTICES
+#error "TC_GPU_DISPLACEMENT draws a shared grid of TerrainVertexPacked, it needs TC_PACKED_VERTICES"
+#endif
 
-    bool operator==(const ChunkCoord &other) const
-    {
-        return x == other.x && z == other.z;
-    }
-};
+#if TC_MEGA_BUFFER && (!TC_PACKED_VERTICES || TC_GPU_DISPLACEMENT)
+#error "TC_MEGA_BUFFER stores TerrainVertexPacked per chunk, it needs TC_PACKED_VERTICES and no TC_GPU_DISPLACEMENT"
+#endif
 
+#if TC_SPLAT_MAPS && !TC_PACKED_VERTICES
+#error "TC_SPLAT_MAPS is drawn by the chunk shaders of the packed vertex paths, it needs TC_PACKED_VERTICES"
+#endif
 
-struct StaticObstacle
-{
-    glm::vec2 posXZ;
-    float radius;
-};
+#if TC_SPLAT_MAPS
+#define TC_CHUNK_FRAGMENT_SHADER "TerrainSplat.frag"
+#else
+#define TC_CHUNK_FRAGMENT_SHADER "TerrainBlend.frag"
+#endif
+
+#if TC_PACKED_VERTICES
+using ChunkVertex = TerrainVertexPacked;
+#else
+using ChunkVertex = TerrainVertex;
+#endif
 
-// Hash function for ChunkCoord to use in unordered_map
-namespace std
+// CPU side of a chunk, built on a worker thread and turned into a Chunk on the GL thread
+struct ChunkBuildData
 {
-    template <>
-    struct hash<ChunkCoord>
-    {
-        size_t operator()(const ChunkCoord &coord) const
-        {
-            return hash<int>()(coord.x) ^ (hash<int>()(coord.z) << 1);
-        }
-    };
-}
+    ChunkCoord coord;
+    std::shared_ptr<const TerrainConfig> config; // the one it was requested with
+    std::vector<ChunkVertex> vertices; // one per grid point followed by the skirt vertices, indexed by the shared chunk IBOs. Empty with TC_GPU_DISPLACEMENT
+    std::vector<float> heightGrid; // verticesPerAxis^2, row major (gz * verticesPerAxis + gx)
+    HeightPyramid heightPyramid;
+    std::vector<VegetationInstance> vegetation;
+    std::vector<uint32_t> obstacleCellStart; // see Chunk
+    std::vector<StaticObstacle> obstacles;
+    std::vector<uint8_t> splatWeights; // RGBA per grid vertex, same order as heightGrid (TC_SPLAT_MAPS)
+    int megaBufferSlot = -1; // from the request, vertices is empty then
+    uint32_t megaBufferGeneration = 0;
+};
 
 class Chunk : public Renderable
 {
 public:
     Chunk(ChunkCoord c, std::unique_ptr<MeshRenderable> tmr)
         : coord(c), terrain_mr(std::move(tmr)) {
+            vegetationRanges.fill(-1);
           };
     ChunkCoord coord;
-    std::vector<glm::vec3> treePositions;       // Store just positions, rendered via instancing
-    std::unique_ptr<MeshRenderable> terrain_mr; // terrain and water
+    std::vector<VegetationInstance> vegetation; // on the terrain, rendered via instancing
+    std::unique_ptr<MeshRenderable> terrain_mr; // terrain and water. Null with TC_MEGA_BUFFER, the manager draws those
+
+    std::vector<float> heightGrid; // stores unscaled perlin heights, row major gridSize x gridSize
+    int gridSize = 0;              // (chunkSize / vertexStep) + 1
+    HeightPyramid heightPyramid;   // of heightGrid, for ray casts
+    int heightMapLayer = -1;       // layer of the manager's height map array (TC_GPU_DISPLACEMENT)
+    int megaBufferSlot = -1;       // slot of the manager's ChunkMegaBuffer (TC_MEGA_BUFFER)
+    int splatLayer = -1;           // layer of the manager's splat weight array (TC_SPLAT_MAPS)
+    std::array<int, VEGETATION_TYPE_COUNT> vegetationRanges; // instance range per type in the manager's vegetation renderers, only while active
+    bool vegetationShown = false;
+
+    // Vegetation that blocks walking as a TC_OBSTACLE_GRID_CELLS^2 grid over the chunk: the obstacles of cell (cx, cz) are
+    // obstacles[obstacleCellStart[i]] to obstacles[obstacleCellStart[i + 1]], i = cz * TC_OBSTACLE_GRID_CELLS + cx
+    std::vector<uint32_t> obstacleCellStart;
+    std::vector<StaticObstacle> obstacles;
+
+    // TerrainChunkManager bookkeeping: place in its LRU list and CPU + GPU bytes held by this chunk
+    std::list<Chunk *>::iterator lruPosition;
+    size_t memoryBytes = 0;
+
+    float gridHeight(int gx, int gz) const { return heightGrid[gz * gridSize + gx]; }
 
-    std::vector<std::vector<float>> heightGrid; // stores unscaled perlin heights
-    int gridSize = 0;                           // (chunkSize / vertexStep) + 1
+    // World space bounds of the terrain mesh (skirts included), for frustum culling
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
 
     void render(const glm::mat4 view, const glm::mat4 projection, const PhongLightConfig *phongLight) override
     {
@@ -65,12 +109,24 @@ public:
             return;
 
         // Trees are now rendered via instanced rendering in TerrainChunkManager
-        terrain_mr->render(view, projection, phongLight);
+        if (terrain_mr)
+            terrain_mr->render(view, projection, phongLight);
     }
 
     bool isActive() const { return m_active; }
     void setActiveStatus(bool status) { m_active = status; }
 
+    // Render detail level, only changes which of the shared index buffers is drawn.
+    // heightGrid always stays at full resolution, so gameplay heights dont depend on it.
+    // indexBuffer is null with TC_MEGA_BUFFER, the level is passed to the mega buffer draw instead.
+    int getLod() const { return m_lod; }
+    void setLod(int lod, std::shared_ptr<IndexBuffer> indexBuffer)
+    {
+        m_lod = lod;
+        if (terrain_mr)
+            terrain_mr->getMesh()->indexBuffer = std::move(indexBuffer);
+    }
+
     bool inBounds(const ChunkCoord &minCoord, const ChunkCoord &maxCoord) const
     {
         return coord.x >= minCoord.x && coord.x <= maxCoord.x &&
@@ -82,31 +138,127 @@ public:
 private:
     // Active status indicates whether the chunk is currently in use and should be rendered.
     bool m_active = true;
+    int m_lod = 0;
 };
 
 class TerrainChunkManager
 {
 public:
-    TerrainChunkManager(TerrainGenerator *generator, std::vector<std::shared_ptr<Texture>> terrainTextures)
-        : m_generator(generator), m_terrainTextures(terrainTextures)
+    TerrainChunkManager(TerrainGenerator *generator, std::vector<std::shared_ptr<Texture>> terrainTextures,
+                        const TerrainConfig &config = TerrainConfig())
+        : m_generator(generator), m_terrainTextures(terrainTextures), m_config(std::make_shared<const TerrainConfig>(config))
     {        
-        // Initialize instanced tree renderer
-        m_treeRenderer = std::make_unique<InstancedRenderer>();
-        // std::unique_ptr<Model> treeModel = m_generator->m_terrainRenderables.gran->copyFrom(m_generator->m_terrainRenderables.gran.get());
+        // One instanced renderer per vegetation type
+        initVegetationRenderers();
+
+#if TC_MEGA_BUFFER
+        // All chunks are drawn from one buffer, the chunk origin comes from a uniform block instead of u_model
+        m_chunkShader = std::make_shared<Shader>();
+        m_chunkShader->addShader("TerrainPackedMulti.vert", ShaderType::VERTEX);
+        m_chunkShader->addShader(TC_CHUNK_FRAGMENT_SHADER, ShaderType::FRAGMENT);
+        m_chunkShader->createProgram();
+        m_chunkShader->bind();
+        m_chunkShader->setUniform("u_heightRange", glm::vec2(TC_PACKED_HEIGHT_MIN, TC_PACKED_HEIGHT_MAX));
+        m_chunkShader->setUniform("u_heightScale", 100.0f);
+#elif TC_GPU_DISPLACEMENT
+        // Chunks draw one shared flat grid displaced by their layer of m_heightMaps
+        m_chunkShader = std::make_shared<Shader>();
+        m_chunkShader->addShader("TerrainDisplaced.vert", ShaderType::VERTEX);
+        m_chunkShader->addShader(TC_CHUNK_FRAGMENT_SHADER, ShaderType::FRAGMENT);
+        m_chunkShader->createProgram();
+        m_chunkShader->bind();
+        m_chunkShader->setUniform("u_heightScale", 100.0f);
+#elif TC_PACKED_VERTICES
+        // Chunks with packed vertices need their own vertex shader, water keeps using m_terrainShader
+        m_chunkShader = std::make_shared<Shader>();
+        m_chunkShader->addShader("TerrainPacked.vert", ShaderType::VERTEX);
+        m_chunkShader->addShader(TC_CHUNK_FRAGMENT_SHADER, ShaderType::FRAGMENT);
+        m_chunkShader->createProgram();
+        m_chunkShader->bind();
+        m_chunkShader->setUniform("u_heightRange", glm::vec2(TC_PACKED_HEIGHT_MIN, TC_PACKED_HEIGHT_MAX));
+        m_chunkShader->setUniform("u_heightScale", 100.0f);
+#endif
+        // Uniforms and tree settings that come from the config
+        applyConfig();
+
+        // The water shader only needs the two water textures
+        std::vector<std::shared_ptr<Texture>> waterTextures;
+        for (const auto &texture : m_terrainTextures)
+        {
+            if (texture->m_targetUniform == "u_texture3" || texture->m_targetUniform == "u_texture4")
+                waterTextures.push_back(texture);
+        }
+        m_waterRenderer = std::make_unique<WaterRenderer>(0.13f * 100.0f + 0.1f, waterTextures);
 
-        std::unique_ptr<Model> treeModel = std::make_unique<Model>((MODELS_DIR / "gran" / "gran.obj")); // gran som trädet gran        
+        m_diskCache = makeDiskCache(*m_config);
 
-        m_treeRenderer->init(std::move(treeModel));
+        // Chunk meshes are built in the background, only the GL upload happens in updateChunks
+        m_workerPool = std::make_unique<ChunkWorkerPool>(
+            [this](const ChunkBuildRequest &r)
+            { return buildChunkData(r); },
+            TC_WORKER_THREADS);
     };
 
     ~TerrainChunkManager() = default;
 
-    // Load/unload chunks based on camera position
-    void updateChunks(const glm::vec3 &cameraPosition);
+    // Where the camera is heading, for updateChunks. Missing chunks in the view and movement direction are
+    // requested first, and the ring around where the camera will be soon is prefetched (TerrainConfig::prefetchSeconds).
+    struct StreamingHint
+    {
+        glm::vec3 velocity = glm::vec3(0.0f);      // world units per second, only x and z are used
+        glm::vec3 viewDirection = glm::vec3(0.0f); // does not need to be normalized, zero = none
+        bool sprinting = false;                    // look further ahead (TerrainConfig::sprintPrefetchSeconds)
+    };
+
+    // Load/unload chunks based on camera position. Call once per frame, it also uploads finished chunks.
+    void updateChunks(const glm::vec3 &cameraPosition, const StreamingHint &hint);
+    void updateChunks(const glm::vec3 &cameraPosition) { updateChunks(cameraPosition, StreamingHint()); }
+
+    // Switch to another config (e.g. TerrainConfig::preset) at runtime, the generator keeps its noise parameters.
+    // Same chunk layout: takes effect right away. Different chunk size or vertex step: the chunks around the
+    // camera are built with the new layout on the worker pool while the old ones keep rendering, then
+    // updateChunks swaps all of them in one frame (see isSwitchingConfig).
+    void setConfig(const TerrainConfig &config);
+    const TerrainConfig &getConfig() const { return *m_config; }
+
+    // A chunk layout switch is still being built in the background
+    bool isSwitchingConfig() const { return m_nextConfig != nullptr; }
+
+    // Chunks requested from the worker pool that have not been uploaded yet
+    size_t getPendingChunkCount() const { return m_pendingChunks.size(); }
 
-    // Garbage collect unused chunks (chunnks that are not active)
+    // Evict the least recently used inactive chunks until the resident chunks fit in the memory budget
     void garbageCollectChunks();
 
+    // CPU + GPU bytes the resident chunks may use before garbageCollectChunks evicts some
+    void setMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+
+    struct ChunkStoreStats
+    {
+        size_t residentChunks = 0;
+        size_t residentBytes = 0; // CPU + GPU
+        size_t budgetBytes = 0;
+        uint64_t hits = 0;        // lookups (loadChunk, getPreciseHeightAt) that found a resident chunk
+        uint64_t misses = 0;      // lookups that had to build or request the chunk
+        uint64_t evictions = 0;
+        size_t heightOnlyChunks = 0; // chunks kept as just heights, outside the render ring
+    };
+    ChunkStoreStats getChunkStoreStats() const;
+
+    struct StreamingStats
+    {
+        size_t queuedChunks = 0;    // needed (ring or prefetch ring) but not requested yet
+        size_t inFlightChunks = 0;  // requested, on the GPU or the worker pool
+        uint64_t readyChunks = 0;   // needed chunks that became resident
+        double lastLatencyMs = 0.0; // from needed to resident
+        double averageLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+        double generationMs = 0.0;  // main thread time the last updateChunks spent requesting chunks
+        double uploadMs = 0.0;      // and uploading finished ones
+    };
+    StreamingStats getStreamingStats() const;
+
+    // All resident chunks, in no particular order. Use findChunk to look one up.
     std::vector<std::unique_ptr<Chunk>> m_chunks;
     void setShader(std::shared_ptr<Shader> shader) { m_terrainShader = shader; }
 
@@ -116,19 +268,59 @@ public:
         m_fogStart = fogStart;
         m_fogEnd = fogEnd;
 
-        // Also set on tree renderer
-        if (m_treeRenderer)
-            m_treeRenderer->setFogUniforms(fogColor, fogStart, fogEnd);
+        // m_terrainShader gets them from its MeshRenderables, the chunk and water shaders get them here
+        if (m_chunkShader)
+        {
+            m_chunkShader->bind();
+            m_chunkShader->setUniform("u_fogColor", fogColor);
+            m_chunkShader->setUniform("u_fogStart", fogStart);
+            m_chunkShader->setUniform("u_fogEnd", fogEnd);
+        }
+
+        if (m_waterRenderer)
+            m_waterRenderer->setFogUniforms(fogColor, fogStart, fogEnd);
+
+        // Also set on the vegetation renderers
+        for (const auto &renderer : m_vegetationRenderers)
+        {
+            if (renderer)
+                renderer->setFogUniforms(fogColor, fogStart, fogEnd);
+        }
     }
 
+    // Terrain height at world (x, z). Outside the render ring only the chunk's heights are built (no mesh,
+    // trees or GL objects), they are handed to the full chunk when it comes into view.
     float getPreciseHeightAt(float x, float z);
 
-    // Render all trees using instanced rendering (call after rendering chunks)
+    // getPreciseHeightAt for n points, out[i] is the height at (xs[i], zs[i]), bit for bit the same. The points
+    // are grouped by chunk so every chunk is looked up once, and interpolated four at a time.
+    void getPreciseHeightsBatch(const float *xs, const float *zs, float *out, size_t n);
+
+    // First hit of a ray with the terrain surface (the triangles of the full resolution grid). Walks the chunks
+    // the ray crosses and each chunk's HeightPyramid, so a ray costs a few node visits rather than a height
+    // sample every few units. Chunks without heights get height only chunks, like getPreciseHeightAt.
+    TerrainHit raycast(const TerrainRay &ray);
+    void raycastBatch(const TerrainRay *rays, TerrainHit *hits, size_t n);
+
+    // No terrain between from and to (enemy sight lines, projectiles)
+    bool hasLineOfSight(const glm::vec3 &from, const glm::vec3 &to);
+
+    // Render the active chunks whose bounds intersect the view frustum (call before water and trees)
+    void renderChunks(const glm::mat4 &view, const glm::mat4 &projection, PhongLightConfig *light);
+
+    // Chunks drawn / skipped by the last renderChunks, for profiling
+    size_t getVisibleChunkCount() const { return m_visibleChunkCount; }
+    size_t getCulledChunkCount() const { return m_culledChunkCount; }
+
+    // Render all vegetation (trees, boxes) using instanced rendering (call after rendering chunks)
     void renderTrees(const glm::mat4 &view, const glm::mat4 &projection, PhongLightConfig *light);
 
     // Render global water plane (call after terrain, before trees for proper transparency)
     void renderWater(const glm::mat4 &view, const glm::mat4 &projection, PhongLightConfig *light, const glm::vec3 &cameraPosition, float renderDistance);
     
+    // Append the obstacles whose center is within range of pos (XZ only) to out. Only the grid cells
+    // of active chunks that overlap the range are looked at. Out is not cleared, so callers can keep
+    // one vector around and clear it themselves instead of allocating every frame.
     void collectNearbyObstacles(const glm::vec3& pos, float range, std::vector<StaticObstacle>& out) const;
 private:
     TerrainGenerator *m_generator;
@@ -136,6 +328,7 @@ private:
     glm::vec3 m_lastCameraPosition = glm::vec3(0.0f);
 
     std::shared_ptr<Shader> m_terrainShader;                 // Reference to shader (not owned)
+    std::shared_ptr<Shader> m_chunkShader;                   // Shader for packed chunk vertices (TC_PACKED_VERTICES / TC_GPU_DISPLACEMENT / TC_MEGA_BUFFER)
     std::vector<std::shared_ptr<Texture>> m_terrainTextures; // Textures for terrain rendering
 
     // Fog parameters
@@ -143,27 +336,200 @@ private:
     float m_fogStart = 0.0f;
     float m_fogEnd = 0.0f;
 
-    // Instanced tree renderer
-    std::unique_ptr<InstancedRenderer> m_treeRenderer;
+    // Frustum culling stats of the last renderChunks
+    size_t m_visibleChunkCount = 0;
+    size_t m_culledChunkCount = 0;
+
+    // Vegetation: where it goes, and one instanced renderer per type (null if its model did not load).
+    // The model transform stands the model on its base at the origin and scales it to the type's height.
+    VegetationScatter m_vegetationScatter;
+    std::array<std::unique_ptr<InstancedRenderer>, VEGETATION_TYPE_COUNT> m_vegetationRenderers;
+    std::array<glm::mat4, VEGETATION_TYPE_COUNT> m_vegetationModelTransforms;
     bool m_treesNeedUpdate = true;
 
+    void initVegetationRenderers();
+
+    // Take the chunk's instances out of the vegetation renderers
+    void removeVegetation(Chunk &chunk);
+
     // Global water plane (single mesh to avoid seams between chunks)
-    std::unique_ptr<MeshRenderable> m_waterMesh;
+    std::unique_ptr<WaterRenderer> m_waterRenderer;
 
     // Optimization: track last camera position to avoid redundant updates
 
-    // Generate a single chunk
-    std::unique_ptr<Chunk> generateNewChunk(const ChunkCoord &coord);
+    // Chunks currently queued or being built on the worker pool
+    std::unordered_set<ChunkCoord> m_pendingChunks;
+
+    // The ring of chunks that should be active, from the last updateChunks that moved far enough
+    ChunkCoord m_ringMin = {0, 0};
+    ChunkCoord m_ringMax = {-1, -1};
+
+    // Build the CPU data of a chunk (heights, vertices, trees). Thread safe, no GL calls.
+    std::unique_ptr<ChunkBuildData> buildChunkData(const ChunkBuildRequest &request) const;
+
+    // Vegetation of a chunk from the scatter tile, put on the terrain of its height grid
+    void scatterVegetation(const ChunkCoord &coord, const TerrainConfig &config, const std::vector<float> &heightGrid, std::vector<VegetationInstance> &vegetation) const;
+
+    // Sort the vegetation of a chunk that blocks walking into its obstacle grid (see Chunk::obstacleCellStart)
+    static void buildObstacleGrid(const ChunkCoord &coord, const TerrainConfig &config, const std::vector<VegetationInstance> &vegetation,
+                                  std::vector<uint32_t> &cellStart, std::vector<StaticObstacle> &obstacles);
+
+    // The config everything resident was made with. Requests and build data point at the one they were made with.
+    std::shared_ptr<const TerrainConfig> m_config;
+
+    // Set the shader uniforms, memory budget and tree settings from m_config
+    void applyConfig();
+
+    // Chunk layout switch in progress (setConfig): the ring around the camera built with m_nextConfig,
+    // requested but not finished yet and finished but not uploaded. Swapped in by finishConfigSwitch.
+    std::shared_ptr<const TerrainConfig> m_nextConfig;
+    std::shared_ptr<ChunkDiskCache> m_nextDiskCache;
+    std::unordered_set<ChunkCoord> m_nextPendingChunks;
+    std::vector<std::unique_ptr<ChunkBuildData>> m_nextChunks;
+    void finishConfigSwitch();
+
+    // Recompute the ring on the next updateChunks even if the camera did not move
+    bool m_ringDirty = true;
+
+    // Recompute the ring and the prefetch ring, queue the chunks they are missing
+    void updateRing(const glm::vec3 &cameraPosition, const glm::vec3 &prefetchPosition);
+    glm::vec3 m_lastPrefetchPosition = glm::vec3(0.0f);
+
+    // Streaming scheduler: the chunks the rings need that are neither resident nor pending. Every frame the most
+    // urgent ones (closest, then ahead of the camera) are requested, within TerrainConfig::generationBudgetMs and
+    // while fewer than TerrainConfig::maxChunksInFlight are pending.
+    std::vector<ChunkCoord> m_streamQueue;
+    std::vector<std::pair<float, ChunkCoord>> m_streamOrder; // scratch heap of (priority, coord), kept so a frame does not allocate
+    void streamChunks(const glm::vec3 &cameraPosition, const StreamingHint &hint);
+
+    // When each queued or pending chunk became needed, for the latency in StreamingStats
+    std::unordered_map<ChunkCoord, std::chrono::steady_clock::time_point> m_neededSince;
+    StreamingStats m_streamingStats;
+    double m_totalLatencyMs = 0.0;
+
+    // Chunks that should be active around position with config
+    static void chunkRing(const glm::vec3 &position, const TerrainConfig &config, ChunkCoord &minCoord, ChunkCoord &maxCoord);
+
+    // Generated chunks on disk (TC_DISK_CACHE), keyed by computeTerrainHash so terrain changes invalidate it.
+    // Null without TC_DISK_CACHE. Requests carry the cache of their config.
+    std::shared_ptr<ChunkDiskCache> m_diskCache;
+    std::shared_ptr<ChunkDiskCache> makeDiskCache(const TerrainConfig &config) const;
+    uint64_t computeTerrainHash(const TerrainConfig &config) const;
+
+    // Evaluate every grid vertex of a chunk exactly once, edges given in the request are copied
+    void buildHeightField(const ChunkBuildRequest &request, std::vector<float> &heights) const;
+
+    // Request for coord with the shared edges of resident neighbours filled in. Main thread only.
+    ChunkBuildRequest makeBuildRequest(const ChunkCoord &coord) const;
+
+    // 16-bit grid indices shared by every chunk mesh, one per LOD level, created with the first chunk (not with TC_MEGA_BUFFER)
+    std::shared_ptr<IndexBuffer> m_chunkIndexBuffers[TC_LOD_LEVELS];
+
+    // TC_MEGA_BUFFER: vertices of every chunk, one slot each, created with the first chunk
+    std::unique_ptr<ChunkMegaBuffer> m_megaBuffer;
+    uint32_t m_megaBufferGeneration = 0; // bumped when m_megaBuffer is replaced, slots of an older one are stale
+    void createMegaBuffer(const TerrainConfig &config);
+
+    // TerrainConfig::gpuGeneration: chunks loadChunk requests go to the compute shader while it has a free job,
+    // their vertices straight into a mega buffer slot reserved for them. Null when off or without GL 4.3.
+    std::unique_ptr<GpuTerrainGenerator> m_gpuGenerator;
 
-    // Load a chunk
+    // Start coord on m_gpuGenerator, false if it has to be built on the CPU instead
+    bool submitGpuChunk(const ChunkCoord &coord);
+
+    // Hand the chunks whose heights are back to the worker pool (trees, obstacles)
+    void collectGpuChunks();
+
+    // Stop m_gpuGenerator's jobs, their slots are freed unless the mega buffer is about to go anyway
+    void cancelGpuChunks(bool freeSlots);
+
+    // Queued requests that were dropped before they were built: give back the mega buffer slots of
+    // GPU generated ones (unless that buffer has been replaced since)
+    void releaseDiscardedRequests(const std::vector<ChunkBuildRequest> &discarded);
+    void renderMegaBuffer(const glm::mat4 &view, const glm::mat4 &projection, PhongLightConfig *light);
+
+    // Pick the LOD level of every active chunk from its distance to the camera
+    void updateChunkLods(const glm::vec3 &cameraPosition);
+
+    // TC_GPU_DISPLACEMENT: the flat grid every chunk draws, and the chunk heights (R32F, one layer per chunk)
+    std::unique_ptr<VertexBuffer> m_gridVertexBuffer;
+    std::shared_ptr<Texture> m_heightMaps;
+    std::vector<int> m_freeHeightMapLayers;
+    int allocateHeightMapLayer(); // grows m_heightMaps when it is full
+
+    // TC_SPLAT_MAPS: ground, grass, mountain and water weights of every chunk (RGBA8, one layer per chunk)
+    std::shared_ptr<Texture> m_splatMaps;
+    std::vector<int> m_freeSplatLayers;
+    int allocateSplatLayer(); // grows m_splatMaps when it is full
+
+    // Create the GL objects for a built chunk. Main thread only.
+    std::unique_ptr<Chunk> uploadChunk(ChunkBuildData &data);
+
+    // Chunks gameplay asked the height of that have no full chunk (yet), see getPreciseHeightAt.
+    // Most recently used first, at most TerrainConfig::heightOnlyChunks.
+    struct HeightOnlyChunk
+    {
+        ChunkCoord coord;
+        std::vector<float> heightGrid; // same layout as Chunk::heightGrid
+        HeightPyramid heightPyramid;
+    };
+    std::list<HeightOnlyChunk> m_heightOnlyLru;
+    std::unordered_map<ChunkCoord, std::list<HeightOnlyChunk>::iterator> m_heightOnlyIndex;
+
+    // Height only chunk of coord, built (or read from the disk cache) on this thread if it is not there yet
+    const HeightOnlyChunk &getHeightOnlyChunk(const ChunkCoord &coord);
+
+    // Height grid for a height query: the resident chunk's, or a height only chunk's (the chunk is requested if it is in the ring).
+    // pyramid is set to the grid's HeightPyramid when given.
+    const std::vector<float> &getHeightGrid(const ChunkCoord &coord, const HeightPyramid **pyramid = nullptr);
+
+    // getPreciseHeightsBatch scratch, kept so a batch does not allocate: chunk -> group table, the chunk
+    // of each group, group of each point, where each group starts in m_heightQueryOrder, point indices by group
+    std::vector<int> m_heightQueryTable;
+    std::vector<ChunkCoord> m_heightQueryChunks;
+    std::vector<int> m_heightQueryGroup;
+    std::vector<uint32_t> m_heightQueryStart;
+    std::vector<uint32_t> m_heightQueryOrder;
+
+    // Copy the heights of a height only chunk into request, if there is one
+    void promoteHeightOnlyChunk(ChunkBuildRequest &request);
+
+    // Upload at most TerrainConfig::chunkUploadsPerFrame chunks finished by the worker pool, fewer when
+    // TerrainConfig::uploadBudgetMs runs out first
+    void processFinishedChunks();
+
+    // Load a chunk. If it doesnt exist yet it is requested from the worker pool.
     void loadChunk(const ChunkCoord &coord);
 
+    // O(1) lookup of resident chunks
+    Chunk *findChunk(const ChunkCoord &coord) const;
+
+    // Resident chunks by coord, and in least recently used order (front = most recent)
+    std::unordered_map<ChunkCoord, Chunk *> m_chunkIndex;
+    std::list<Chunk *> m_lru;
+    size_t m_residentBytes = 0;
+    size_t m_memoryBudget = 0; // from the config, or setMemoryBudget
+    ChunkStoreStats m_stats;
+
+    // Take ownership of a new chunk and index it
+    void addChunk(std::unique_ptr<Chunk> chunk);
+
+    // Mark a chunk as just used
+    void touchChunk(Chunk *chunk);
+
+    // Evict least recently used inactive chunks while more than byteBudget bytes are resident
+    // or fewer than freeSlots mega buffer slots are free
+    void evictChunks(size_t byteBudget, size_t freeSlots);
+
     // Get which chunk (its coordinates) a world coordinate belongs to
     ChunkCoord worldToChunk(const glm::vec3 &worldPos) const
     {
         ChunkCoord coord;
-        coord.x = static_cast<int>(std::floor(worldPos.x / TC_CHUNK_SIZE));
-        coord.z = static_cast<int>(std::floor(worldPos.z / TC_CHUNK_SIZE));
+        coord.x = static_cast<int>(std::floor(worldPos.x / m_config->chunkSize));
+        coord.z = static_cast<int>(std::floor(worldPos.z / m_config->chunkSize));
         return coord;
     }
+
+    // Declared last so the workers are joined before anything they use is destroyed
+    std::unique_ptr<ChunkWorkerPool> m_workerPool;
 };
@@ -1,49 +1,141 @@
 #pragma once
-// #### Chunkmanager configuration parameters ####
-#define TC_CHUNK_SIZE 100		  // Size of each chunk in grid units (e.g., 32x32)
-#define TC_RENDER_DISTANCE 100.0f  // Distance in world units to render chunks
-#define TC_UPDATE_THRESHOLD 10.0f // Minimum camera movement to trigger chunk update
-#define TC_GC_THRESHOLD 100		  // Number of chunks before triggering garbage collection
-#define TC_CELLS_PER_AXIS (TC_CHUNK_SIZE / TC_VERTEX_STEP)  // Number of cells (triangles) along one side of a chunk  (bad name)
-#define TC_VERTICES_PER_AXIS (TC_CELLS_PER_AXIS + 1) // Number of vertices along one side of a chunk
-#define TC_CELLS_PER_CHUNK (TC_CELLS_PER_AXIS * TC_CELLS_PER_AXIS) // Total number of cells (triangles) in a chunk
-
-// #### Terrain generation parameters ####
-#define TC_WIDTH 256
-#define TC_HEIGHT 256
-// How stretched the terrain is horizontally
-#define TC_SCALE 20.0f
-// Maximum height of the terrain
-#define TC_HEIGHT_SCALE 30.0f
-// Number of noise layers
-#define TC_OCTAVES 6
-// How much each octave contributes
-#define TC_PERSISTENCE 0.5f
-// Frequency increase per octave
-#define TC_LACUNARITY 3.0f
-// Spacing between vertices (1 = every point, 2 = every other point, etc.)
-#define TC_VERTEX_STEP 5
-
-// Ridge noise parameters
-#define TC_RIDGE_SAMPLE_FACTOR 0.005f
-#define TC_RIDGE_NOISE_LACUNARITY 2.0f
-#define TC_RIDGE_NOISE_GAIN 0.4f
-#define TC_RIDGE_NOISE_OFFSET 1.0f
-#define TC_RIDGE_NOISE_OCTAVES 5
-#define TC_RIDGE_DETAIL_FACTOR 0.08f
-
-// Hill noise parameters
-#define TC_HILL_SAMPLE_FACTOR 0.001f // lower number for biger/smoother hills
-#define TC_HILL_NOISE_LACUNARITY 3.0f
-#define TC_HILL_NOISE_GAIN 1.4f
-#define TC_HILL_NOISE_OCTAVES 4
-
-// Sea sample parameters
-#define TC_SEA_SAMPLE_FACTOR_X 0.0008f
-#define TC_SEA_SAMPLE_FACTOR_Z 0.0008f
-#define TC_SEA_SAMPLE_LACUNARITY 2.0f
-#define TC_SEA_SAMPLE_GAIN 0.5f
-#define TC_SEA_SAMPLE_OCTAVES 3
-// other sea parameters
-#define TC_SEA_LEVEL 0.13f
-#define TC_SEA_LEVEL_OFFSET 0.05f
\ No newline at end of file
+
+#include <cstddef>
+
+// #### Build time switches (vertex formats, shaders and array sizes depend on these) ####
+#define TC_WORKER_THREADS 0		  // Chunk generation threads (0 = hardware threads - 1)
+#define TC_PACKED_VERTICES 1	  // 1 = 8 byte TerrainVertexPacked chunk vertices (TerrainPacked.vert), 0 = 40 byte TerrainVertex
+#define TC_PACKED_HEIGHT_MIN -0.5f // Range of the unscaled perlin height stored in TerrainVertexPacked::height
+#define TC_PACKED_HEIGHT_MAX 2.0f
+#define TC_GPU_DISPLACEMENT 0	  // 1 = chunks draw one shared grid displaced by a per chunk R32F height map (TerrainDisplaced.vert), no per chunk meshes
+#define TC_MEGA_BUFFER 1		  // 1 = all chunk vertices in one ChunkMegaBuffer, the visible chunks are drawn in a single multi draw (needs TC_PACKED_VERTICES)
+#define TC_MEGA_BUFFER_SLOTS 1024 // Chunks the mega buffer holds (16 bytes of uniform block each, 1024 is the smallest limit GL guarantees). Also in TerrainPackedMulti.vert
+#define TC_SPLAT_MAPS 1		  // 1 = chunks blend their ground textures by RGBA weights baked with the chunk (one layer of a texture array each, TerrainSplat.frag), needs TC_PACKED_VERTICES
+#define TC_DISK_CACHE 1			  // 1 = keep generated chunks in region files under TC_CACHE_DIR, read back instead of generated again
+#define TC_CACHE_DIR "chunkcache"
+#define TC_CACHE_REGION_SIZE 16	  // Chunks per side of one cache region file
+#define TC_LOD_LEVELS 4			  // Chunk mesh detail levels, level n only uses every 2^n:th grid vertex (1x, 2x, 4x, 8x)
+#define TC_TREE_OBSTACLE_RADIUS 1.0f	  // Collision radius of a tree trunk
+#define TC_OBSTACLE_GRID_CELLS 8	  // Cells per side of each chunk's static obstacle grid (collectNearbyObstacles only looks at the cells it overlaps)
+#define TC_TREE_GPU_CULLING 1		  // Frustum cull the trees in a compute shader and draw them indirectly (needs GL 4.3, falls back to drawing all)
+
+enum class TerrainQuality
+{
+    LOW,
+    MEDIUM,
+    HIGH,
+    ULTRA
+};
+
+/**
+ * @brief Everything about the terrain that can change without a rebuild.
+ *
+ * The defaults are the MEDIUM preset. TerrainChunkManager::setConfig switches at runtime, the noise
+ * parameters are read by the chunk worker threads and stay fixed for the lifetime of a TerrainGenerator.
+ */
+struct TerrainConfig
+{
+    // #### Chunkmanager configuration parameters ####
+    int chunkSize = 100;                         // Size of each chunk in world units, a multiple of vertexStep
+    int vertexStep = 5;                          // Spacing between chunk grid vertices (1 = every unit, 2 = every other unit, etc.)
+    float renderDistance = 100.0f;               // Distance in world units to load and render chunks
+    float updateThreshold = 10.0f;               // Minimum camera movement to trigger chunk update
+    size_t chunkMemoryBudget = 4 * 1024 * 1024;  // Bytes (CPU + GPU) resident chunks may use before the least recently used inactive ones are evicted
+    int chunkUploadsPerFrame = 2;                // Max finished chunks uploaded to the GPU per frame
+    float uploadBudgetMs = 2.0f;                 // Main thread time per frame for uploading finished chunks, at least one is uploaded
+    float generationBudgetMs = 1.0f;             // Main thread time per frame for requesting queued chunks (edges, GPU dispatches), at least one is requested
+    int maxChunksInFlight = 0;                   // Chunks requested but not uploaded at a time, the rest wait in priority order (0 = twice the worker threads, plus the GPU jobs)
+    float streamingDirectionWeight = 0.5f;       // Queued chunks straight ahead (view or movement direction) count as this much closer, 0 = distance only
+    float prefetchSeconds = 1.5f;                // The ring around where the camera will be this far ahead (at its current velocity) is loaded before it is needed
+    float sprintPrefetchSeconds = 3.0f;          // Same while sprinting
+    int heightOnlyChunks = 256;                  // Chunks outside the render ring kept as just a height grid for getPreciseHeightAt (enemy spawns), least recently used dropped first
+    float lodDistance = 45.0f;                   // Distance from the camera to a chunk where level 1 starts, every next level starts at twice the distance (keep it under renderDistance, about half)
+    float lodHysteresis = 15.0f;                 // How far past a level boundary a chunk has to be before it switches (no flickering back and forth)
+    float lodSkirtDepth = 20.0f;                 // How far the skirts around each chunk hang down, hides cracks between chunks of different levels
+    float treeImpostorDistance = 50.0f;          // Trees further away than this fade into baked camera facing quads (ImpostorAtlas), 0 = always full meshes
+    float treeImpostorFade = 15.0f;              // Width of the band the mesh and the impostor cross fade over
+    bool gpuGeneration = false;                  // Chunk heights and vertices from a compute shader (GpuTerrainGenerator, GL 4.3 and TC_MEGA_BUFFER), only the heights are read back
+
+    // #### Terrain generation parameters ####
+    int width = 256;            // Size of the old single mesh height map (generateTerrainMesh)
+    int height = 256;
+    float heightScale = 30.0f;  // Maximum height of the single mesh terrain
+
+    // Ridge noise parameters
+    float ridgeSampleFactor = 0.005f;
+    float ridgeNoiseLacunarity = 2.0f;
+    float ridgeNoiseGain = 0.4f;
+    float ridgeNoiseOffset = 1.0f;
+    int ridgeNoiseOctaves = 5;
+    float ridgeDetailFactor = 0.08f;
+
+    // Hill noise parameters
+    float hillSampleFactor = 0.001f; // lower number for biger/smoother hills
+    float hillNoiseLacunarity = 3.0f;
+    float hillNoiseGain = 1.4f;
+    int hillNoiseOctaves = 4;
+
+    // Sea sample parameters
+    float seaSampleFactorX = 0.0008f;
+    float seaSampleFactorZ = 0.0008f;
+    float seaSampleLacunarity = 2.0f;
+    float seaSampleGain = 0.5f;
+    int seaSampleOctaves = 3;
+    // other sea parameters
+    float seaLevel = 0.13f;
+    float seaLevelOffset = 0.05f;
+
+    // Low frequency noise cache (TerrainNoiseCache): the leading octaves of the hill, lake and water noise
+    // are sampled on coarse lattices and interpolated, the ridge noises (mountains and their domain) stay exact.
+    // Off by default so a plain TerrainConfig gives the exact heights, the presets turn it on.
+    bool noiseCache = false;
+    float noiseCacheMinWavelength = 100.0f;       // Only octaves with at least this wavelength (world units) are cached
+    float noiseCacheSamplesPerWavelength = 12.0f; // Lattice points per wavelength of a layer's fastest cached octave, more = smaller error
+
+    int cellsPerAxis() const { return chunkSize / vertexStep; } // Number of cells (quads) along one side of a chunk
+    int verticesPerAxis() const { return cellsPerAxis() + 1; }  // Number of vertices along one side of a chunk
+
+    // Chunk size and vertex step decide the chunk grid, everything built from it has to be rebuilt when they change
+    bool sameChunkLayout(const TerrainConfig &other) const
+    {
+        return chunkSize == other.chunkSize && vertexStep == other.vertexStep;
+    }
+
+    // Trade vertex density, chunk size and view distance for speed. Noise parameters are left at their defaults.
+    static TerrainConfig preset(TerrainQuality quality)
+    {
+        TerrainConfig config;
+        config.noiseCache = true; // hills and lakes a fraction of a unit off, for much cheaper chunks
+        switch (quality)
+        {
+        case TerrainQuality::LOW:
+            config.vertexStep = 10;
+            config.renderDistance = 75.0f;
+            config.chunkMemoryBudget = 2 * 1024 * 1024;
+            config.lodDistance = 35.0f;
+            config.treeImpostorDistance = 30.0f;
+            break;
+        case TerrainQuality::MEDIUM:
+            break;
+        case TerrainQuality::HIGH:
+            config.chunkSize = 128;
+            config.vertexStep = 4;
+            config.renderDistance = 200.0f;
+            config.chunkMemoryBudget = 16 * 1024 * 1024;
+            config.chunkUploadsPerFrame = 4;
+            config.lodDistance = 90.0f;
+            config.treeImpostorDistance = 80.0f;
+            break;
+        case TerrainQuality::ULTRA:
+            config.chunkSize = 128;
+            config.vertexStep = 2;
+            config.renderDistance = 300.0f;
+            config.chunkMemoryBudget = 64 * 1024 * 1024;
+            config.chunkUploadsPerFrame = 4;
+            config.lodDistance = 135.0f;
+            config.treeImpostorDistance = 120.0f;
+            break;
+        }
+        return config;
+    }
+};
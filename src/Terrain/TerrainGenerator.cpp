@@ -1,53 +1,225 @@
 #include "TerrainGenerator.h"
 
-#define STB_PERLIN_IMPLEMENTATION
+#include "TerrainNoise.h"
 #include "vendor/stb_image/stb_perlin.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
-TerrainGenerator::TerrainGenerator(/*const TerrainConfig &config*/)
-// : m_config(config)
+TerrainGenerator::TerrainGenerator(const TerrainConfig &config)
+    : m_config(config)
 {
     // Initialize height map
-    // m_heightMap.resize(m_config.width);
-    m_heightMap.resize(TC_WIDTH);
-    for (int i = 0; i < TC_WIDTH; i++)
+    m_heightMap.resize(m_config.width);
+    for (int i = 0; i < m_config.width; i++)
     {
-        m_heightMap[i].resize(TC_HEIGHT);
+        m_heightMap[i].resize(m_config.height);
     }
+
+    // Use FBM for gentle hills/variation (secondary) - increased for more ondulation
+    m_hillLayer.scaleX = m_hillLayer.scaleZ = m_config.hillSampleFactor;
+    m_hillLayer.lacunarity = m_config.hillNoiseLacunarity;
+    m_hillLayer.gain = m_config.hillNoiseGain;
+    m_hillLayer.octaves = m_config.hillNoiseOctaves;
+
+    // Lake depression noise - sparse, large areas
+    m_lakeLayer.scaleX = m_config.seaSampleFactorX;
+    m_lakeLayer.scaleZ = m_config.seaSampleFactorZ;
+    m_lakeLayer.lacunarity = m_config.seaSampleLacunarity;
+    m_lakeLayer.gain = m_config.seaSampleGain;
+    m_lakeLayer.octaves = m_config.seaSampleOctaves;
+
+    // Use ridge noise to define the mountain "domain" - not circular! Very low frequency for large structures
+    m_domainLayer.ridge = true;
+    m_domainLayer.scaleX = m_domainLayer.scaleZ = 0.002f;
+    m_domainLayer.planeXY = true;
+    m_domainLayer.w = 100.0f;
+    m_domainLayer.lacunarity = 15.0f;
+    m_domainLayer.gain = 0.5f;
+    m_domainLayer.offset = 1.0f;
+    m_domainLayer.octaves = 3;
+
+    // Use noise to create large bodies of water only (no small puddles). Even lower frequency for larger bodies
+    m_waterLayer.scaleX = m_waterLayer.scaleZ = 0.0015f;
+    m_waterLayer.planeXY = true;
+    m_waterLayer.w = 50.0f;
+    m_waterLayer.lacunarity = 2.0f;
+    m_waterLayer.gain = 0.5f;
+    m_waterLayer.octaves = 4; // more octaves for smoother areas
+
+    setupNoiseCache();
 }
 
 TerrainGenerator::~TerrainGenerator()
 {
 }
 
-float TerrainGenerator::getPerlinHeight(float x, float z)
-{    
+void TerrainGenerator::setupNoiseCache()
+{
+    if (!m_config.noiseCache)
+        return;
 
-    // Use ridge noise for sharp mountain features (primary)
-    float ridgeNoise = stb_perlin_ridge_noise3(x * TC_RIDGE_SAMPLE_FACTOR, 0.0f, z * TC_RIDGE_SAMPLE_FACTOR,
-                                               TC_RIDGE_NOISE_LACUNARITY, // lacunarity
-                                               TC_RIDGE_NOISE_GAIN,       // gain
-                                               TC_RIDGE_NOISE_OFFSET,     // offset
-                                               TC_RIDGE_NOISE_OCTAVES);   // octaves
+    m_noiseCache = std::make_unique<TerrainNoiseCache>();
+    for (NoiseLayer *layer : {&m_hillLayer, &m_lakeLayer, &m_domainLayer, &m_waterLayer})
+    {
+        // Leading octaves with a long enough wavelength. Ridge layers stay exact: an octave is weighted
+        // by the one before it, so only the first could be cached, and its crease does not interpolate well.
+        if (layer->ridge)
+            continue;
+        int maxCached = layer->octaves;
+        float frequency = std::max(layer->scaleX, layer->scaleZ);
+        float highestFrequency = 0.0f;
+        int cached = 0;
+        while (cached < maxCached && 1.0f / frequency >= m_config.noiseCacheMinWavelength)
+        {
+            highestFrequency = frequency;
+            frequency *= layer->lacunarity;
+            cached++;
+        }
+        if (cached == 0)
+            continue;
+
+        // The lattice follows the fastest cached octave, so every layer gets its own resolution
+        NoiseLayer exact = *layer;
+        layer->cachedOctaves = cached;
+        layer->cacheLayer = m_noiseCache->addLayer(
+            [exact, cached](const float *xs, const float *zs, float *out, size_t n)
+            { evaluateLayerBatch(exact, cached, xs, zs, out, n); },
+            1.0f / (highestFrequency * m_config.noiseCacheSamplesPerWavelength));
+    }
+}
 
-    // Use FBM for gentle hills/variation (secondary) - increased for more ondulation
-    float hillNoise = stb_perlin_fbm_noise3(x * TC_HILL_SAMPLE_FACTOR, 0.0f, z * TC_HILL_SAMPLE_FACTOR,
-                                            TC_HILL_NOISE_LACUNARITY, // lacunarity
-                                            TC_HILL_NOISE_GAIN,       // gain - increased for more variation
-                                            TC_HILL_NOISE_OCTAVES);   // octaves - more for ondulation
+void TerrainGenerator::evaluateLayerBatch(const NoiseLayer &layer, int octaves, const float *xs, const float *zs, float *out, size_t n)
+{
+    constexpr size_t BLOCK = 64;
+    float nx[BLOCK], ny[BLOCK], nz[BLOCK];
 
+    for (size_t begin = 0; begin < n; begin += BLOCK)
+    {
+        const size_t count = std::min(BLOCK, n - begin);
+        for (size_t i = 0; i < count; i++)
+            layer.toNoise(xs[begin + i], zs[begin + i], nx[i], ny[i], nz[i]);
+
+        if (layer.ridge)
+            TerrainNoise::ridgeNoise3Batch(nx, ny, nz, layer.lacunarity, layer.gain, layer.offset, octaves, out + begin, count);
+        else
+            TerrainNoise::fbmNoise3Batch(nx, ny, nz, layer.lacunarity, layer.gain, octaves, out + begin, count);
+    }
+}
+
+// Frequency and amplitude of octave `octave`, accumulated like stb_perlin does
+static void octaveScale(float lacunarity, float gain, bool ridge, int octave, float &frequency, float &amplitude)
+{
+    frequency = 1.0f;
+    amplitude = ridge ? 0.5f : 1.0f;
+    for (int i = 0; i < octave; i++)
+    {
+        frequency *= lacunarity;
+        amplitude *= gain;
+    }
+}
+
+float TerrainGenerator::sampleLayer(const NoiseLayer &layer, float x, float z) const
+{
+    float nx, ny, nz;
+    layer.toNoise(x, z, nx, ny, nz);
+
+    if (layer.cacheLayer < 0)
+    {
+        if (layer.ridge)
+            return stb_perlin_ridge_noise3(nx, ny, nz, layer.lacunarity, layer.gain, layer.offset, layer.octaves);
+        return stb_perlin_fbm_noise3(nx, ny, nz, layer.lacunarity, layer.gain, layer.octaves);
+    }
+
+    // Cached octaves, then the remaining ones the same way stb_perlin sums them
+    float sum = m_noiseCache->sample(layer.cacheLayer, x, z);
+    float prev = sum * 2.0f; // ridge: the cached first octave is 0.5 * r0
+    float frequency, amplitude;
+    octaveScale(layer.lacunarity, layer.gain, layer.ridge, layer.cachedOctaves, frequency, amplitude);
+    for (int i = layer.cachedOctaves; i < layer.octaves; i++)
+    {
+        float noise = stb_perlin_noise3_seed(nx * frequency, ny * frequency, nz * frequency, 0, 0, 0, i);
+        if (layer.ridge)
+        {
+            float r = layer.offset - std::fabs(noise);
+            r = r * r;
+            sum += r * amplitude * prev;
+            prev = r;
+        }
+        else
+        {
+            sum += noise * amplitude;
+        }
+        frequency *= layer.lacunarity;
+        amplitude *= layer.gain;
+    }
+    return sum;
+}
+
+void TerrainGenerator::sampleLayerBatch(const NoiseLayer &layer, const float *xs, const float *zs, float *out, size_t n) const
+{
+    constexpr size_t BLOCK = 64;
+    assert(n <= BLOCK);
+
+    if (layer.cacheLayer < 0)
+    {
+        evaluateLayerBatch(layer, layer.octaves, xs, zs, out, n);
+        return;
+    }
+
+    m_noiseCache->sampleBatch(layer.cacheLayer, xs, zs, out, n);
+    if (layer.cachedOctaves == layer.octaves)
+        return;
+
+    float nx[BLOCK], ny[BLOCK], nz[BLOCK], px[BLOCK], py[BLOCK], pz[BLOCK], noise[BLOCK], prev[BLOCK];
+    for (size_t i = 0; i < n; i++)
+    {
+        layer.toNoise(xs[i], zs[i], nx[i], ny[i], nz[i]);
+        prev[i] = out[i] * 2.0f;
+    }
+
+    float frequency, amplitude;
+    octaveScale(layer.lacunarity, layer.gain, layer.ridge, layer.cachedOctaves, frequency, amplitude);
+    for (int octave = layer.cachedOctaves; octave < layer.octaves; octave++)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            px[i] = nx[i] * frequency;
+            py[i] = ny[i] * frequency;
+            pz[i] = nz[i] * frequency;
+        }
+        TerrainNoise::noise3Batch(px, py, pz, (unsigned char)octave, noise, n);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            if (layer.ridge)
+            {
+                float r = layer.offset - std::fabs(noise[i]);
+                r = r * r;
+                out[i] += r * amplitude * prev[i];
+                prev[i] = r;
+            }
+            else
+            {
+                out[i] += noise[i] * amplitude;
+            }
+        }
+        frequency *= layer.lacunarity;
+        amplitude *= layer.gain;
+    }
+}
+
+// The noise layers are combined by the helpers below. Both getPerlinHeight and getPerlinHeightBatch
+// go through them so the scalar and batched paths produce exactly the same heights.
+
+// Height from the always present layers (hills, ridge detail and lakes). Noise values are raw [-1, 1].
+static float combineBaseLayers(const TerrainConfig &config, float ridgeNoise, float hillNoise, float lakeNoise)
+{
     // Normalize ridge noise (it can be negative)
     ridgeNoise = (ridgeNoise + 1.0f) * 0.5f;
     hillNoise = (hillNoise + 1.0f) * 0.5f;
 
-    // Lake depression noise - sparse, large areas
-    float lakeNoise = stb_perlin_fbm_noise3(x * TC_SEA_SAMPLE_FACTOR_X, 0.0f, z * TC_SEA_SAMPLE_FACTOR_Z,
-                                            TC_SEA_SAMPLE_LACUNARITY,
-                                            TC_SEA_SAMPLE_GAIN,
-                                            TC_SEA_SAMPLE_OCTAVES);
-
     lakeNoise = (lakeNoise + 1.0f) * 0.5f; // normalise to 0-1
 
     // Create lake depressions (only in specific areas - higher threshold = fewer, larger lakes)
@@ -60,23 +232,20 @@ float TerrainGenerator::getPerlinHeight(float x, float z)
 
     // Base terrain centered above sea level to prevent random puddles
     // Only intentional lake depressions should go below sea level
-    float baseHeight = hillNoise * TC_SEA_LEVEL + TC_SEA_LEVEL_OFFSET + 0.02f;
+    float baseHeight = hillNoise * config.seaLevel + config.seaLevelOffset + 0.02f;
 
     // Add ridge details for variety across the map
-    float ridgeDetail = ridgeNoise * TC_RIDGE_DETAIL_FACTOR;
-    float total = baseHeight + ridgeDetail - lakeDepression;
+    float ridgeDetail = ridgeNoise * config.ridgeDetailFactor;
+    return baseHeight + ridgeDetail - lakeDepression;
+}
 
+// How much (x, z) is inside the mountain area. Mountains are only added where this is > 0.32
+static float mountainAreaFactor(const TerrainConfig &config, float x, float z, float mountainDomain)
+{
     // Center in bottom-left quadrant but make it MUCH wider
-    float mountainCenterX = TC_WIDTH * 0.05f; //0.15f;
-    float mountainCenterZ = TC_HEIGHT * 0.05f; //0.15f;
-
-    // Use ridge noise to define the mountain "domain" - not circular!
-    float domainX = x * 0.002f; // Very low frequency for large structures
-    float domainZ = z * 0.002f;
+    float mountainCenterX = config.width * 0.05f; //0.15f;
+    float mountainCenterZ = config.height * 0.05f; //0.15f;
 
-    // Create an irregular mountain domain using ridge noise
-    float mountainDomain = stb_perlin_ridge_noise3(domainX, domainZ, 100.0f,
-                                                   15.0f, 0.5f, 1.0f, 3);
     mountainDomain = (mountainDomain + 1.0f) * 0.5f;
 
     // Add position bias toward our target area
@@ -88,7 +257,74 @@ float TerrainGenerator::getPerlinHeight(float x, float z)
     float mountainInfluence = 1.0f - std::min(distFromCenter / 140.0f, 1.0f); // 250 unit radius!
 
     // Combine domain noise with position bias for irregular boundary
-    float inMountainArea = mountainDomain * 0.4f + mountainInfluence * 0.6f;
+    return mountainDomain * 0.4f + mountainInfluence * 0.6f;
+}
+
+static float applyMountainLayers(float total, float inMountainArea,
+                                 float ridgeLarge, float ridgeMedium, float ridgeFine,
+                                 float slopeMod, float edgeNoise)
+{
+    // Normalize
+    ridgeLarge = (ridgeLarge + 1.0f) * 0.5f;
+    ridgeMedium = (ridgeMedium + 1.0f) * 0.5f;
+    ridgeFine = (ridgeFine + 1.0f) * 0.5f;
+
+    // Combine at different scales
+    float combinedHeight = ridgeLarge * 0.5f + ridgeMedium * 0.3f + ridgeFine * 0.2f;
+
+    slopeMod = (slopeMod + 1.0f) * 0.5f;
+
+    // Some areas have steep cliffs (high multiplier), others gradual slopes (low multiplier)
+    float slopeVariation = 0.5f + slopeMod * 1.5f; // Range: 0.5 to 2.0
+
+    // Apply slope variation
+    combinedHeight = pow(combinedHeight, slopeVariation);
+
+    // SHARP cutoff for mountain strength - prevents gradual height increase on plains
+    float mountainStrength = (inMountainArea - 0.3f) / 0.7f; // Remap 0.3-1.0 to 0.0-1.0
+    mountainStrength = std::max(0.0f, mountainStrength);
+
+    // Apply a sharp transition using exponential function
+    mountainStrength = pow(mountainStrength, 0.5f); // Less sharp at base for some foothills
+
+    // Edge variation but keep it subtle
+    edgeNoise = (edgeNoise + 1.0f) * 0.5f;
+    mountainStrength = mountainStrength * (0.85f + edgeNoise * 0.15f); // Less variation at edges
+
+    // Final mountain height - MUCH TALLER
+    float mountainHeight = combinedHeight * mountainStrength;
+
+    // Boost height significantly and ensure tall peaks
+    mountainHeight = mountainHeight * 1.2f + mountainStrength * 0.2f; // Higher multiplier
+
+    // Only apply if we have significant mountain strength
+    if (mountainStrength > 0.1f)
+    {
+        total = std::max(total, mountainHeight);
+    }
+    return total;
+}
+
+float TerrainGenerator::getPerlinHeight(float x, float z) const
+{    
+
+    // Use ridge noise for sharp mountain features (primary)
+    float ridgeNoise = stb_perlin_ridge_noise3(x * m_config.ridgeSampleFactor, 0.0f, z * m_config.ridgeSampleFactor,
+                                               m_config.ridgeNoiseLacunarity, // lacunarity
+                                               m_config.ridgeNoiseGain,       // gain
+                                               m_config.ridgeNoiseOffset,     // offset
+                                               m_config.ridgeNoiseOctaves);   // octaves
+
+    // Hills and lakes, low frequency (partly from m_noiseCache)
+    float hillNoise = sampleLayer(m_hillLayer, x, z);
+    float lakeNoise = sampleLayer(m_lakeLayer, x, z);
+
+    float total = combineBaseLayers(m_config, ridgeNoise, hillNoise, lakeNoise);
+
+    // Create an irregular mountain domain using ridge noise
+    float mountainDomain = sampleLayer(m_domainLayer, x, z);
+
+    float inMountainArea = mountainAreaFactor(m_config, x, z, mountainDomain);
 
     if (inMountainArea > 0.32f) // Raised threshold to prevent ground mimicking mountain shape
     {
@@ -108,58 +344,119 @@ float TerrainGenerator::getPerlinHeight(float x, float z)
         float ridgeFine = stb_perlin_ridge_noise3(detailX * 2.0f, detailZ * 2.0f, 300.0f,
                                                   2.0f, 0.5f, 1.0f, 3);
 
-        // Normalize
-        ridgeLarge = (ridgeLarge + 1.0f) * 0.5f;
-        ridgeMedium = (ridgeMedium + 1.0f) * 0.5f;
-        ridgeFine = (ridgeFine + 1.0f) * 0.5f;
-
-        // Combine at different scales
-        float combinedHeight = ridgeLarge * 0.5f + ridgeMedium * 0.3f + ridgeFine * 0.2f;
-
         // Create varied slopes by modulating height with another noise layer
         float slopeMod = stb_perlin_fbm_noise3(x * 0.008f, z * 0.008f, 400.0f,
                                                2.0f, 0.5f, 3);
-        slopeMod = (slopeMod + 1.0f) * 0.5f;
 
-        // Some areas have steep cliffs (high multiplier), others gradual slopes (low multiplier)
-        float slopeVariation = 0.5f + slopeMod * 1.5f; // Range: 0.5 to 2.0
+        // Edge variation but keep it subtle
+        float edgeNoise = stb_perlin_noise3(x * 0.01f, z * 0.01f, 500.0f, 0, 0, 0);
+
+        total = applyMountainLayers(total, inMountainArea, ridgeLarge, ridgeMedium, ridgeFine, slopeMod, edgeNoise);
+    }
 
-        // Apply slope variation
-        combinedHeight = pow(combinedHeight, slopeVariation);
+    return total;
+}
 
-        // SHARP cutoff for mountain strength - prevents gradual height increase on plains
-        float mountainStrength = (inMountainArea - 0.3f) / 0.7f; // Remap 0.3-1.0 to 0.0-1.0
-        mountainStrength = std::max(0.0f, mountainStrength);
+void TerrainGenerator::getPerlinHeightBatch(const float *xs, const float *zs, float *out, size_t n) const
+{
+    // Same layers as getPerlinHeight, but each one is evaluated for a whole block of points
+    // with TerrainNoise. Mountain layers are only evaluated for the points that need them.
+    constexpr size_t BLOCK = 64;
+    float sx[BLOCK], sy[BLOCK], sz[BLOCK];
+    float ridge[BLOCK], hill[BLOCK], lake[BLOCK], domain[BLOCK], area[BLOCK];
+    float ridgeLarge[BLOCK], ridgeMedium[BLOCK], ridgeFine[BLOCK], slopeMod[BLOCK], edge[BLOCK];
+    size_t mountainIdx[BLOCK];
+
+    auto fill = [](float *dst, float v, size_t count)
+    {
+        std::fill(dst, dst + count, v);
+    };
 
-        // Apply a sharp transition using exponential function
-        mountainStrength = pow(mountainStrength, 0.5f); // Less sharp at base for some foothills
+    for (size_t begin = 0; begin < n; begin += BLOCK)
+    {
+        const size_t count = std::min(BLOCK, n - begin);
+        const float *x = xs + begin;
+        const float *z = zs + begin;
 
-        // Edge variation but keep it subtle
-        float edgeNoise = stb_perlin_noise3(x * 0.01f, z * 0.01f, 500.0f, 0, 0, 0);
-        edgeNoise = (edgeNoise + 1.0f) * 0.5f;
-        mountainStrength = mountainStrength * (0.85f + edgeNoise * 0.15f); // Less variation at edges
+        fill(sy, 0.0f, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            sx[i] = x[i] * m_config.ridgeSampleFactor;
+            sz[i] = z[i] * m_config.ridgeSampleFactor;
+        }
+        TerrainNoise::ridgeNoise3Batch(sx, sy, sz, m_config.ridgeNoiseLacunarity, m_config.ridgeNoiseGain,
+                                       m_config.ridgeNoiseOffset, m_config.ridgeNoiseOctaves, ridge, count);
 
-        // Final mountain height - MUCH TALLER
-        float mountainHeight = combinedHeight * mountainStrength;
+        sampleLayerBatch(m_hillLayer, x, z, hill, count);
+        sampleLayerBatch(m_lakeLayer, x, z, lake, count);
+        sampleLayerBatch(m_domainLayer, x, z, domain, count);
 
-        // Boost height significantly and ensure tall peaks
-        mountainHeight = mountainHeight * 1.2f + mountainStrength * 0.2f; // Higher multiplier
+        // Compact the points that are inside the mountain area
+        size_t m = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            out[begin + i] = combineBaseLayers(m_config, ridge[i], hill[i], lake[i]);
+            area[i] = mountainAreaFactor(m_config, x[i], z[i], domain[i]);
+            if (area[i] > 0.32f)
+                mountainIdx[m++] = i;
+        }
+        if (m == 0)
+            continue;
 
-        // Only apply if we have significant mountain strength
-        if (mountainStrength > 0.1f)
+        for (size_t k = 0; k < m; k++)
         {
-            total = std::max(total, mountainHeight);
+            sx[k] = (x[mountainIdx[k]] * 0.015f) * 0.6f;
+            sy[k] = (z[mountainIdx[k]] * 0.015f) * 0.6f;
         }
-    }
+        fill(sz, 100.0f, m);
+        TerrainNoise::ridgeNoise3Batch(sx, sy, sz, 2.0f, 0.5f, 1.0f, 5, ridgeLarge, m);
 
-    return total;
+        for (size_t k = 0; k < m; k++)
+        {
+            sx[k] = x[mountainIdx[k]] * 0.015f;
+            sy[k] = z[mountainIdx[k]] * 0.015f;
+        }
+        fill(sz, 200.0f, m);
+        TerrainNoise::ridgeNoise3Batch(sx, sy, sz, 2.0f, 0.5f, 1.0f, 4, ridgeMedium, m);
+
+        for (size_t k = 0; k < m; k++)
+        {
+            sx[k] = (x[mountainIdx[k]] * 0.015f) * 2.0f;
+            sy[k] = (z[mountainIdx[k]] * 0.015f) * 2.0f;
+        }
+        fill(sz, 300.0f, m);
+        TerrainNoise::ridgeNoise3Batch(sx, sy, sz, 2.0f, 0.5f, 1.0f, 3, ridgeFine, m);
+
+        for (size_t k = 0; k < m; k++)
+        {
+            sx[k] = x[mountainIdx[k]] * 0.008f;
+            sy[k] = z[mountainIdx[k]] * 0.008f;
+        }
+        fill(sz, 400.0f, m);
+        TerrainNoise::fbmNoise3Batch(sx, sy, sz, 2.0f, 0.5f, 3, slopeMod, m);
+
+        for (size_t k = 0; k < m; k++)
+        {
+            sx[k] = x[mountainIdx[k]] * 0.01f;
+            sy[k] = z[mountainIdx[k]] * 0.01f;
+        }
+        fill(sz, 500.0f, m);
+        TerrainNoise::noise3Batch(sx, sy, sz, 0, edge, m);
+
+        for (size_t k = 0; k < m; k++)
+        {
+            size_t i = mountainIdx[k];
+            out[begin + i] = applyMountainLayers(out[begin + i], area[i], ridgeLarge[k], ridgeMedium[k],
+                                                 ridgeFine[k], slopeMod[k], edge[k]);
+        }
+    }
 }
 
 void TerrainGenerator::generateHeightMap()
 {
-    for (int z = 0; z < TC_HEIGHT; z++)
+    for (int z = 0; z < m_config.height; z++)
     {
-        for (int x = 0; x < TC_WIDTH; x++)
+        for (int x = 0; x < m_config.width; x++)
         {
             float height = getPerlinHeight((float)x, (float)z);
             m_heightMap[x][z] = height;
@@ -171,14 +468,14 @@ glm::vec3 TerrainGenerator::calculateNormal(int x, int z)
 {
     // Use central difference to calculate normal
     float heightL = (x > 0) ? m_heightMap[x - 1][z] : m_heightMap[x][z];
-    float heightR = (x < TC_WIDTH - 1) ? m_heightMap[x + 1][z] : m_heightMap[x][z];
+    float heightR = (x < m_config.width - 1) ? m_heightMap[x + 1][z] : m_heightMap[x][z];
     float heightD = (z > 0) ? m_heightMap[x][z - 1] : m_heightMap[x][z];
-    float heightU = (z < TC_HEIGHT - 1) ? m_heightMap[x][z + 1] : m_heightMap[x][z];
+    float heightU = (z < m_config.height - 1) ? m_heightMap[x][z + 1] : m_heightMap[x][z];
 
     glm::vec3 normal;
-    normal.x = (heightL - heightR) * TC_HEIGHT_SCALE;
+    normal.x = (heightL - heightR) * m_config.heightScale;
     normal.y = 2.0f; // Scale factor for smoothness
-    normal.z = (heightD - heightU) * TC_HEIGHT_SCALE;
+    normal.z = (heightD - heightU) * m_config.heightScale;
 
     return glm::normalize(normal);
 }
@@ -192,20 +489,20 @@ std::shared_ptr<Mesh> TerrainGenerator::generateTerrainMesh()
     std::vector<unsigned int> indices;
 
     // Center the terrain around origin
-    float offsetX = TC_WIDTH * 0.5f;
-    float offsetZ = TC_HEIGHT * 0.5f;
+    float offsetX = m_config.width * 0.5f;
+    float offsetZ = m_config.height * 0.5f;
 
-    int step = TC_VERTEX_STEP;
+    int step = m_config.vertexStep;
 
     // Sea level in world units
-    const float seaLevel = 0.13f * TC_HEIGHT_SCALE;
+    const float seaLevel = 0.13f * m_config.heightScale;
 
     // For flat shading, we need to generate separate vertices for each triangle
     // rather than sharing vertices between triangles
     // Use vertexStep to skip vertices and reduce polygon count
-    for (int z = 0; z < TC_HEIGHT - step; z += step)
+    for (int z = 0; z < m_config.height - step; z += step)
     {
-        for (int x = 0; x < TC_WIDTH - step; x += step)
+        for (int x = 0; x < m_config.width - step; x += step)
         {
             // Get the four corner heights
             float h_tl = m_heightMap[x][z];
@@ -220,10 +517,10 @@ std::shared_ptr<Mesh> TerrainGenerator::generateTerrainMesh()
             float w_br = getWaterMask((float)(x + step), (float)(z + step));
 
             // Calculate positions - always use terrain height for terrain mesh
-            glm::vec3 pos_tl((float)x - offsetX, h_tl * TC_HEIGHT_SCALE, (float)z - offsetZ);
-            glm::vec3 pos_tr((float)(x + step) - offsetX, h_tr * TC_HEIGHT_SCALE, (float)z - offsetZ);
-            glm::vec3 pos_bl((float)x - offsetX, h_bl * TC_HEIGHT_SCALE, (float)(z + step) - offsetZ);
-            glm::vec3 pos_br((float)(x + step) - offsetX, h_br * TC_HEIGHT_SCALE, (float)(z + step) - offsetZ);
+            glm::vec3 pos_tl((float)x - offsetX, h_tl * m_config.heightScale, (float)z - offsetZ);
+            glm::vec3 pos_tr((float)(x + step) - offsetX, h_tr * m_config.heightScale, (float)z - offsetZ);
+            glm::vec3 pos_bl((float)x - offsetX, h_bl * m_config.heightScale, (float)(z + step) - offsetZ);
+            glm::vec3 pos_br((float)(x + step) - offsetX, h_br * m_config.heightScale, (float)(z + step) - offsetZ);
 
             // First triangle (top-left, bottom-left, top-right)
             {
@@ -308,9 +605,9 @@ std::shared_ptr<Mesh> TerrainGenerator::generateTerrainMesh()
     }
 
     // Generate continuous water layer across entire map at sea level
-    for (int z = 0; z < TC_HEIGHT - step; z += step)
+    for (int z = 0; z < m_config.height - step; z += step)
     {
-        for (int x = 0; x < TC_WIDTH - step; x += step)
+        for (int x = 0; x < m_config.width - step; x += step)
         {
             // Create flat water quad at sea level (always, for entire map)
             glm::vec3 pos_tl((float)x - offsetX, seaLevel, (float)z - offsetZ);
@@ -410,19 +707,19 @@ std::shared_ptr<Mesh> TerrainGenerator::generateTerrainMesh()
 float TerrainGenerator::getHeightAt(float x, float z) const
 {
     // Convert world coordinates to grid coordinates
-    float offsetX = TC_WIDTH * 0.5f;
-    float offsetZ = TC_HEIGHT * 0.5f;
+    float offsetX = m_config.width * 0.5f;
+    float offsetZ = m_config.height * 0.5f;
 
     int gridX = (int)(x + offsetX);
     int gridZ = (int)(z + offsetZ);
 
-    if (gridX < 0 || gridX >= TC_WIDTH || gridZ < 0 || gridZ >= TC_HEIGHT)
+    if (gridX < 0 || gridX >= m_config.width || gridZ < 0 || gridZ >= m_config.height)
         return 0.0f;
 
-    return m_heightMap[gridX][gridZ] * TC_HEIGHT_SCALE;
+    return m_heightMap[gridX][gridZ] * m_config.heightScale;
 }
 
-float TerrainGenerator::getWaterMask(float x, float z)
+float TerrainGenerator::getWaterMask(float x, float z) const
 {
     // Get the terrain height
     float height = getPerlinHeight(x, z);
@@ -435,14 +732,8 @@ float TerrainGenerator::getWaterMask(float x, float z)
         return 0.0f;
 
     // Use noise to create large bodies of water only (no small puddles)
-    float sampleX = x * 0.0015f; // Even lower frequency for larger bodies
-    float sampleZ = z * 0.0015f;
-
-    float waterNoise = stb_perlin_fbm_noise3(sampleX, sampleZ, 50.0f,
-                                             2.0f, // lacunarity
-                                             0.5f, // gain
-                                             4);   // more octaves for smoother areas
-    waterNoise = (waterNoise + 1.0f) * 0.5f;       // Normalize to 0-1
+    float waterNoise = sampleLayer(m_waterLayer, x, z);
+    waterNoise = (waterNoise + 1.0f) * 0.5f; // Normalize to 0-1
 
     // Much higher threshold - only large continuous areas get water
     const float waterAreaThreshold = 0.55f;
@@ -458,18 +749,3 @@ float TerrainGenerator::getWaterMask(float x, float z)
     // Water exists here - return full strength for water plane
     return 1.0f;
 }
-
-float TerrainGenerator::foo_treePerlin(float x, float z)
-{
-    float sampleX = x * 0.03f;
-    float sampleZ = z * 0.02f;
-
-    // random ass parameters (ändra till nåt vettigt nån dag)
-    float tree_perlin = stb_perlin_fbm_noise3(sampleX * 0.8f, sampleZ * 0.8f, 0.0f,
-                                              6.0f,  // lacunarity
-                                              0.75f, // gain - increased for more variation
-                                              8);    // octaves - more for ondulation
-
-    float normalised_tp = (tree_perlin + 1.0f) * 0.5f; // Normalize to 0-1
-    return normalised_tp;
-}
\ No newline at end of file
@@ -8,21 +8,10 @@
 #include "MeshRenderable.h"
 #include "Model.h"
 #include "TerrainConfig.h"
+#include "TerrainNoiseCache.h"
 
 #include <vector>
-/*
-struct TerrainConfig
-{
-    int width = 256;
-    int height = 256;
-    float scale = 20.0f;        // How stretched the terrain is horizontally
-    float heightScale = 30.0f;  // Maximum height of the terrain
-    int octaves = 6;            // Number of noise layers
-    float persistence = 0.5f;   // How much each octave contributes
-    float lacunarity = 2.0f;    // Frequency increase per octave
-    int vertexStep = 3;         // Spacing between vertices (1 = every point, 2 = every other point, etc.)
-};
-*/
+#include <cstdint>
 
 struct TerrainVertex
 {
@@ -33,10 +22,23 @@ struct TerrainVertex
     float waterMask; // 0.0 = no water, 1.0 = full water
 };
 
+// Compact chunk vertex, 8 bytes instead of 40. The position is local to the chunk (the chunk origin
+// is the model matrix), UVs are derived from the position and normals from screen space
+// derivatives, see TerrainPacked.vert.
+struct TerrainVertexPacked
+{
+    uint16_t x, z;     // chunk local position in world units
+    uint16_t height;   // unscaled perlin height normalized over [TC_PACKED_HEIGHT_MIN, TC_PACKED_HEIGHT_MAX]
+    uint8_t waterMask; // 0 = no water, 255 = full water
+    uint8_t skirt;     // 255 for the skirt copies of the edge vertices, lowered by TerrainConfig::lodSkirtDepth in the shader
+};
+static_assert(sizeof(TerrainVertexPacked) == 8, "TerrainVertexPacked should be 8 bytes");
+
 class TerrainGenerator
 {
 public:
-    TerrainGenerator(/*const TerrainConfig& config*/);
+    // Only the noise parameters (and the old single mesh ones) of config are used
+    TerrainGenerator(const TerrainConfig &config = TerrainConfig());
     ~TerrainGenerator();
 
     // Generate terrain mesh with Perlin noise
@@ -46,16 +48,68 @@ public:
     float getHeightAt(float x, float z) const;
     
     // Generate Perlin noise value (public for chunk generation)
-    float getPerlinHeight(float x, float z);
+    // Pure function of (x, z), safe to call from the chunk worker threads. With TerrainConfig::noiseCache
+    // the low frequency layers are interpolated from m_noiseCache, so it is close to but not exactly the
+    // noise itself (noisecachebench measures how close).
+    float getPerlinHeight(float x, float z) const;
+
+    // Same as calling getPerlinHeight for each (xs[i], zs[i]), bit for bit, but the noise is
+    // evaluated in SIMD lanes. Use this when many heights are needed at once (chunk generation).
+    void getPerlinHeightBatch(const float *xs, const float *zs, float *out, size_t n) const;
     
     // Check if location should have water (based on height and area)
-    float getWaterMask(float x, float z);
+    float getWaterMask(float x, float z) const;
+
+    const TerrainConfig &getConfig() const { return m_config; }
 
-    float foo_treePerlin(float x, float z);
+    // Null without TerrainConfig::noiseCache
+    const TerrainNoiseCache *getNoiseCache() const { return m_noiseCache.get(); }
     
 private:    
 
-    // TerrainConfig m_config;
+    TerrainConfig m_config; // never changes, the chunk workers read it
+
+    // One of the stb_perlin fBm or ridge noises the heights are made of. World (x, z) is sampled at noise
+    // (x * scaleX, 0, z * scaleZ), or at (x * scaleX, z * scaleZ, w) with planeXY.
+    struct NoiseLayer
+    {
+        bool ridge = false;
+        float scaleX = 1.0f;
+        float scaleZ = 1.0f;
+        bool planeXY = false;
+        float w = 0.0f;
+        float lacunarity = 2.0f;
+        float gain = 0.5f;
+        float offset = 1.0f; // ridge only
+        int octaves = 1;
+
+        // The first cachedOctaves octaves come from m_noiseCache layer cacheLayer, the rest are evaluated
+        int cachedOctaves = 0;
+        int cacheLayer = -1;
+
+        void toNoise(float x, float z, float &nx, float &ny, float &nz) const
+        {
+            nx = x * scaleX;
+            ny = planeXY ? z * scaleZ : 0.0f;
+            nz = planeXY ? w : z * scaleZ;
+        }
+    };
+    NoiseLayer m_hillLayer;
+    NoiseLayer m_lakeLayer;
+    NoiseLayer m_domainLayer; // where the mountains are
+    NoiseLayer m_waterLayer;  // getWaterMask
+    std::unique_ptr<TerrainNoiseCache> m_noiseCache;
+
+    // Put the long wavelength octaves of each layer in m_noiseCache
+    void setupNoiseCache();
+
+    // Value of a layer at world (x, z), cached octaves interpolated. The batch version does the same
+    // for n <= 64 points, bit for bit.
+    float sampleLayer(const NoiseLayer &layer, float x, float z) const;
+    void sampleLayerBatch(const NoiseLayer &layer, const float *xs, const float *zs, float *out, size_t n) const;
+
+    // The first octaves octaves of a layer evaluated exactly, any n
+    static void evaluateLayerBatch(const NoiseLayer &layer, int octaves, const float *xs, const float *zs, float *out, size_t n);
     std::vector<std::vector<float>> m_heightMap;
 
     // Generate height map using Perlin noise
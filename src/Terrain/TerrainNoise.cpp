@@ -0,0 +1,210 @@
+#include "TerrainNoise.h"
+#include "TerrainNoiseKernel.h"
+
+// The one place the stb_perlin implementation is compiled, the kernels need its tables
+#define STB_PERLIN_IMPLEMENTATION
+#include "vendor/stb_image/stb_perlin.h"
+
+#include <algorithm>
+
+#ifdef TERRAIN_NOISE_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace TerrainNoise
+{
+    const PerlinTables &getPerlinTables()
+    {
+        // Copy of stb__perlin_grad's basis
+        static const int basis[12][3] = {
+            {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
+            {1, 0, 1}, {-1, 0, 1}, {1, 0, -1}, {-1, 0, -1},
+            {0, 1, 1}, {0, -1, 1}, {0, 1, -1}, {0, -1, -1},
+        };
+
+        static const PerlinTables tables = []
+        {
+            PerlinTables t;
+            for (int i = 0; i < 512; i++)
+            {
+                t.randtab[i] = stb__perlin_randtab[i];
+                const int *g = basis[stb__perlin_randtab_grad_idx[i]];
+                t.grad[i] = (g[0] + 1) | (g[1] + 1) << 8 | (g[2] + 1) << 16;
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    namespace
+    {
+#ifdef TERRAIN_NOISE_X86
+        // SSE2 is always there on x86-64. No gather instruction, so lookups go through memory.
+        struct Sse2Ops
+        {
+            using F = __m128;
+            using I = __m128i;
+            static constexpr size_t W = 4;
+
+            static F load(const float *p) { return _mm_loadu_ps(p); }
+            static void store(float *p, F v) { _mm_storeu_ps(p, v); }
+            static F set1(float v) { return _mm_set1_ps(v); }
+            static F add(F a, F b) { return _mm_add_ps(a, b); }
+            static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+            static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+            static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+            static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+
+            // stb__perlin_fastfloor: truncate, then step down if that rounded up
+            static I fastfloor(F a)
+            {
+                I ai = _mm_cvttps_epi32(a);
+                I rounded_up = _mm_castps_si128(_mm_cmplt_ps(a, _mm_cvtepi32_ps(ai)));
+                return _mm_add_epi32(ai, rounded_up); // true lanes are -1
+            }
+
+            static I addi(I a, int b) { return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+            static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+            static I mask255(I a) { return _mm_and_si128(a, _mm_set1_epi32(255)); }
+
+            static I gather(const int *table, I idx)
+            {
+                alignas(16) int i[4];
+                _mm_store_si128((I *)i, idx);
+                return _mm_setr_epi32(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+            }
+            // One component (-1, 0 or 1) of a PerlinTables::grad entry
+            static F unpackGrad(I g, int shift)
+            {
+                I c = _mm_and_si128(_mm_srli_epi32(g, shift), _mm_set1_epi32(255));
+                return _mm_cvtepi32_ps(_mm_sub_epi32(c, _mm_set1_epi32(1)));
+            }
+        };
+
+        bool cpuHasAVX2()
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) // OS must save the YMM registers
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        enum class SimdLevel
+        {
+            Scalar,
+            SSE2,
+            AVX2
+        };
+
+        SimdLevel detectSimdLevel()
+        {
+#ifdef TERRAIN_NOISE_X86
+            if (avx2KernelAvailable() && cpuHasAVX2())
+                return SimdLevel::AVX2;
+            return SimdLevel::SSE2;
+#else
+            return SimdLevel::Scalar;
+#endif
+        }
+
+        SimdLevel simdLevel()
+        {
+            static const SimdLevel level = detectSimdLevel();
+            return level;
+        }
+    }
+
+    void noise3Batch(const float *x, const float *y, const float *z, unsigned char seed, float *out, size_t n)
+    {
+        switch (simdLevel())
+        {
+#ifdef TERRAIN_NOISE_X86
+        case SimdLevel::AVX2:
+            noise3BatchAVX2(x, y, z, seed, out, n);
+            return;
+        case SimdLevel::SSE2:
+            Kernel::noise3Batch<Sse2Ops>(x, y, z, seed, out, n);
+            return;
+#endif
+        default:
+            for (size_t i = 0; i < n; i++)
+                out[i] = stb_perlin_noise3_internal(x[i], y[i], z[i], 0, 0, 0, seed);
+        }
+    }
+
+    void ridgeNoise3Batch(const float *x, const float *y, const float *z,
+                          float lacunarity, float gain, float offset, int octaves,
+                          float *out, size_t n)
+    {
+        switch (simdLevel())
+        {
+#ifdef TERRAIN_NOISE_X86
+        case SimdLevel::AVX2:
+            ridgeNoise3BatchAVX2(x, y, z, lacunarity, gain, offset, octaves, out, n);
+            return;
+        case SimdLevel::SSE2:
+            Kernel::ridgeNoise3Batch<Sse2Ops>(x, y, z, lacunarity, gain, offset, octaves, out, n);
+            return;
+#endif
+        default:
+            for (size_t i = 0; i < n; i++)
+                out[i] = stb_perlin_ridge_noise3(x[i], y[i], z[i], lacunarity, gain, offset, octaves);
+        }
+    }
+
+    void fbmNoise3Batch(const float *x, const float *y, const float *z,
+                        float lacunarity, float gain, int octaves,
+                        float *out, size_t n)
+    {
+        switch (simdLevel())
+        {
+#ifdef TERRAIN_NOISE_X86
+        case SimdLevel::AVX2:
+            fbmNoise3BatchAVX2(x, y, z, lacunarity, gain, octaves, out, n);
+            return;
+        case SimdLevel::SSE2:
+            Kernel::fbmNoise3Batch<Sse2Ops>(x, y, z, lacunarity, gain, octaves, out, n);
+            return;
+#endif
+        default:
+            for (size_t i = 0; i < n; i++)
+                out[i] = stb_perlin_fbm_noise3(x[i], y[i], z[i], lacunarity, gain, octaves);
+        }
+    }
+
+    void copyPerlinTables(int randtab[512], int grad[512])
+    {
+        const PerlinTables &tables = getPerlinTables();
+        std::copy(tables.randtab, tables.randtab + 512, randtab);
+        std::copy(tables.grad, tables.grad + 512, grad);
+    }
+
+    const char *getSimdLevelName()
+    {
+        switch (simdLevel())
+        {
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+        }
+    }
+}
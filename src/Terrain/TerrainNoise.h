@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Batched versions of the stb_perlin functions used by the terrain (wrap = 0 everywhere).
+// n points are evaluated per call, in SSE2 or AVX2 lanes depending on what the CPU supports
+// (picked once at runtime). Results are bit-identical to calling stb_perlin_* point by point.
+// x, y and z are arrays of n values (pass the same constant array for a fixed coordinate).
+namespace TerrainNoise
+{
+    void noise3Batch(const float *x, const float *y, const float *z, unsigned char seed, float *out, size_t n);
+
+    void ridgeNoise3Batch(const float *x, const float *y, const float *z,
+                          float lacunarity, float gain, float offset, int octaves,
+                          float *out, size_t n);
+
+    void fbmNoise3Batch(const float *x, const float *y, const float *z,
+                        float lacunarity, float gain, int octaves,
+                        float *out, size_t n);
+
+    // The stb_perlin permutation table and its gradients (components + 1 packed in the low three bytes),
+    // for ports of the noise that can not include stb_perlin.h (TerrainHeights.comp)
+    void copyPerlinTables(int randtab[512], int grad[512]);
+
+    // "AVX2", "SSE2" or "scalar"
+    const char *getSimdLevelName();
+}
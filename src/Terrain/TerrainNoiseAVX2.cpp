@@ -0,0 +1,77 @@
+// AVX2 variant of the TerrainNoise kernels. This file is built with AVX2 enabled (see CMakeLists.txt)
+// and is only entered after TerrainNoise.cpp has checked the CPU, so keep the standard library out of it.
+#include "TerrainNoiseKernel.h"
+
+#if defined(TERRAIN_NOISE_X86) && defined(__AVX2__)
+#include <immintrin.h>
+
+namespace TerrainNoise
+{
+    namespace
+    {
+        struct Avx2Ops
+        {
+            using F = __m256;
+            using I = __m256i;
+            static constexpr size_t W = 8;
+
+            static F load(const float *p) { return _mm256_loadu_ps(p); }
+            static void store(float *p, F v) { _mm256_storeu_ps(p, v); }
+            static F set1(float v) { return _mm256_set1_ps(v); }
+            static F add(F a, F b) { return _mm256_add_ps(a, b); }
+            static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+            static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+            static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+
+            static I fastfloor(F a)
+            {
+                I ai = _mm256_cvttps_epi32(a);
+                I rounded_up = _mm256_castps_si256(_mm256_cmp_ps(a, _mm256_cvtepi32_ps(ai), _CMP_LT_OQ));
+                return _mm256_add_epi32(ai, rounded_up);
+            }
+
+            static I addi(I a, int b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+            static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+            static I mask255(I a) { return _mm256_and_si256(a, _mm256_set1_epi32(255)); }
+
+            static I gather(const int *table, I idx) { return _mm256_i32gather_epi32(table, idx, 4); }
+
+            static F unpackGrad(I g, int shift)
+            {
+                I c = _mm256_and_si256(_mm256_srli_epi32(g, shift), _mm256_set1_epi32(255));
+                return _mm256_cvtepi32_ps(_mm256_sub_epi32(c, _mm256_set1_epi32(1)));
+            }
+        };
+    }
+
+    bool avx2KernelAvailable() { return true; }
+
+    void noise3BatchAVX2(const float *x, const float *y, const float *z, unsigned char seed, float *out, size_t n)
+    {
+        Kernel::noise3Batch<Avx2Ops>(x, y, z, seed, out, n);
+    }
+
+    void ridgeNoise3BatchAVX2(const float *x, const float *y, const float *z, float lacunarity, float gain, float offset, int octaves, float *out, size_t n)
+    {
+        Kernel::ridgeNoise3Batch<Avx2Ops>(x, y, z, lacunarity, gain, offset, octaves, out, n);
+    }
+
+    void fbmNoise3BatchAVX2(const float *x, const float *y, const float *z, float lacunarity, float gain, int octaves, float *out, size_t n)
+    {
+        Kernel::fbmNoise3Batch<Avx2Ops>(x, y, z, lacunarity, gain, octaves, out, n);
+    }
+}
+
+#elif defined(TERRAIN_NOISE_X86)
+
+// Built without AVX2 (compiler flag missing), TerrainNoise.cpp falls back to SSE2
+namespace TerrainNoise
+{
+    bool avx2KernelAvailable() { return false; }
+    void noise3BatchAVX2(const float *, const float *, const float *, unsigned char, float *, size_t) {}
+    void ridgeNoise3BatchAVX2(const float *, const float *, const float *, float, float, float, int, float *, size_t) {}
+    void fbmNoise3BatchAVX2(const float *, const float *, const float *, float, float, int, float *, size_t) {}
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include "TerrainNoiseCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+
+int TerrainNoiseCache::addLayer(LayerFunction function, float spacing)
+{
+    assert(spacing > 0.0f);
+
+    auto layer = std::make_unique<Layer>();
+    layer->function = std::move(function);
+    layer->spacing = spacing;
+    layer->invSpacing = 1.0f / spacing;
+    m_layers.push_back(std::move(layer));
+    return (int)m_layers.size() - 1;
+}
+
+size_t TerrainNoiseCache::getTileCount(int layer) const
+{
+    std::shared_lock lock(m_layers[layer]->mutex);
+    return m_layers[layer]->tiles.size();
+}
+
+std::shared_ptr<const TerrainNoiseCache::Tile> TerrainNoiseCache::getTile(const Layer &layer, const ChunkCoord &tileCoord) const
+{
+    {
+        std::shared_lock lock(layer.mutex);
+        auto it = layer.tiles.find(tileCoord);
+        if (it != layer.tiles.end())
+            return it->second;
+    }
+
+    // Built without the lock, two threads may build the same tile. Both get the same values.
+    std::shared_ptr<const Tile> tile = buildTile(layer, tileCoord);
+
+    std::unique_lock lock(layer.mutex);
+    auto [it, inserted] = layer.tiles.emplace(tileCoord, tile);
+    if (inserted)
+    {
+        layer.order.push_back(tileCoord);
+        if (layer.order.size() > MAX_TILES_PER_LAYER)
+        {
+            // Readers keep their shared_ptr, the tile is freed once they are done with it
+            layer.tiles.erase(layer.order.front());
+            layer.order.pop_front();
+        }
+    }
+    return it->second;
+}
+
+std::shared_ptr<const TerrainNoiseCache::Tile> TerrainNoiseCache::buildTile(const Layer &layer, const ChunkCoord &tileCoord) const
+{
+    constexpr int N = Tile::SIZE;
+    const int firstX = tileCoord.x * TILE_CELLS - 1;
+    const int firstZ = tileCoord.z * TILE_CELLS - 1;
+
+    std::vector<float> xs(N * N), zs(N * N);
+    for (int j = 0; j < N; j++)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            xs[j * N + i] = (float)(firstX + i) * layer.spacing;
+            zs[j * N + i] = (float)(firstZ + j) * layer.spacing;
+        }
+    }
+
+    auto tile = std::make_shared<Tile>();
+    layer.function(xs.data(), zs.data(), tile->values, N * N);
+    return tile;
+}
+
+// std::floor is a library call without SSE4.1, this is most of the lookup otherwise
+static inline int fastFloor(float v)
+{
+    int i = (int)v;
+    return v < (float)i ? i - 1 : i;
+}
+
+TerrainNoiseCache::Lookup TerrainNoiseCache::locate(const Layer &layer, float x, float z)
+{
+    static_assert((TILE_CELLS & (TILE_CELLS - 1)) == 0, "shifts below need a power of two");
+    constexpr int TILE_SHIFT = TILE_CELLS == 16 ? 4 : TILE_CELLS == 32 ? 5 : TILE_CELLS == 8 ? 3 : -1;
+    static_assert(TILE_SHIFT >= 0);
+
+    float fx = x * layer.invSpacing;
+    float fz = z * layer.invSpacing;
+    int gx = fastFloor(fx);
+    int gz = fastFloor(fz);
+
+    // Arithmetic shift is floor division, so negative coordinates get tiles too
+    Lookup lookup;
+    lookup.tile.x = gx >> TILE_SHIFT;
+    lookup.tile.z = gz >> TILE_SHIFT;
+    lookup.localX = gx & (TILE_CELLS - 1);
+    lookup.localZ = gz & (TILE_CELLS - 1);
+    lookup.tx = fx - (float)gx;
+    lookup.tz = fz - (float)gz;
+    return lookup;
+}
+
+// Catmull-Rom weights of the four lattice points around a position t in [0, 1) between the middle two
+static inline void catmullRomWeights(float t, float w[4])
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    w[0] = 0.5f * (2.0f * t2 - t3 - t);
+    w[1] = 0.5f * (3.0f * t3 - 5.0f * t2 + 2.0f);
+    w[2] = 0.5f * (4.0f * t2 - 3.0f * t3 + t);
+    w[3] = 0.5f * (t3 - t2);
+}
+
+float TerrainNoiseCache::interpolate(const Tile &tile, const Lookup &lookup)
+{
+    float wx[4], wz[4];
+    catmullRomWeights(lookup.tx, wx);
+    catmullRomWeights(lookup.tz, wz);
+
+    // The cell's lattice point is at index local + 1, the 4x4 neighbourhood starts one before it
+    // Rows blended first, four columns side by side, which the compiler turns into one SSE register
+    const float *row = tile.values + lookup.localZ * Tile::SIZE + lookup.localX;
+    float columns[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int j = 0; j < 4; j++, row += Tile::SIZE)
+    {
+        for (int i = 0; i < 4; i++)
+            columns[i] += wz[j] * row[i];
+    }
+    return (columns[0] * wx[0] + columns[1] * wx[1]) + (columns[2] * wx[2] + columns[3] * wx[3]);
+}
+
+float TerrainNoiseCache::sample(int layer, float x, float z) const
+{
+    const Layer &l = *m_layers[layer];
+    Lookup lookup = locate(l, x, z);
+    return interpolate(*getTile(l, lookup.tile), lookup);
+}
+
+void TerrainNoiseCache::sampleBatch(int layer, const float *xs, const float *zs, float *out, size_t n) const
+{
+    const Layer &l = *m_layers[layer];
+
+    // Batches are mostly one chunk, which is inside one or two tiles. Only lock when the tile changes.
+    std::shared_ptr<const Tile> tile;
+    ChunkCoord tileCoord = {0, 0};
+
+    constexpr size_t BLOCK = 64;
+    Lookup lookups[BLOCK];
+    for (size_t begin = 0; begin < n; begin += BLOCK)
+    {
+        const size_t count = std::min(BLOCK, n - begin);
+
+        // Separate loop so the cell lookups vectorize
+        for (size_t i = 0; i < count; i++)
+            lookups[i] = locate(l, xs[begin + i], zs[begin + i]);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const Lookup &lookup = lookups[i];
+            if (!tile || !(lookup.tile == tileCoord))
+            {
+                tile = getTile(l, lookup.tile);
+                tileCoord = lookup.tile;
+            }
+            out[begin + i] = interpolate(*tile, lookup);
+        }
+    }
+}
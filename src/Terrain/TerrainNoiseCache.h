@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ChunkCoord.h"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Low frequency noise layers sampled on coarse lattices and interpolated in between.
+ *
+ * Every layer has its own world aligned lattice, the spacing is picked by the caller from the
+ * layer's highest frequency, so a layer that changes slowly gets a sparse lattice and a busier
+ * one a denser lattice. The layer is evaluated exactly at the lattice points and Catmull-Rom
+ * interpolated everywhere else, the error shrinks with the spacing (see noisecachebench).
+ *
+ * Lattice values are kept in tiles of TILE_CELLS x TILE_CELLS cells, built the first time a point
+ * inside them is sampled and shared by all threads (the chunk workers). A sampled value only
+ * depends on the position, so chunks that share a border still agree on it.
+ */
+class TerrainNoiseCache
+{
+public:
+    // Exact values of a layer at n points. Called for a whole tile at once, from any thread.
+    using LayerFunction = std::function<void(const float *xs, const float *zs, float *out, size_t n)>;
+
+    static constexpr int TILE_CELLS = 16;
+    static constexpr size_t MAX_TILES_PER_LAYER = 1024; // oldest tiles are dropped past this
+
+    TerrainNoiseCache() = default;
+    TerrainNoiseCache(const TerrainNoiseCache &) = delete;
+    TerrainNoiseCache &operator=(const TerrainNoiseCache &) = delete;
+
+    // Add a layer with lattice points spacing world units apart, returns its index.
+    // Not thread safe, add every layer before sampling.
+    int addLayer(LayerFunction function, float spacing);
+
+    size_t getLayerCount() const { return m_layers.size(); }
+    float getSpacing(int layer) const { return m_layers[layer]->spacing; }
+    size_t getTileCount(int layer) const;
+
+    // Interpolated value of layer at world (x, z)
+    float sample(int layer, float x, float z) const;
+
+    // Same as sample for each (xs[i], zs[i]), bit for bit
+    void sampleBatch(int layer, const float *xs, const float *zs, float *out, size_t n) const;
+
+private:
+    // Lattice values of cells [tile * TILE_CELLS, (tile + 1) * TILE_CELLS) and the extra row and
+    // column on each side the interpolation reads, row major
+    struct Tile
+    {
+        static constexpr int SIZE = TILE_CELLS + 3;
+        float values[SIZE * SIZE];
+    };
+
+    struct Layer
+    {
+        LayerFunction function;
+        float spacing;
+        float invSpacing;
+
+        mutable std::shared_mutex mutex;
+        mutable std::unordered_map<ChunkCoord, std::shared_ptr<const Tile>> tiles;
+        mutable std::deque<ChunkCoord> order; // insertion order, for dropping the oldest
+    };
+    std::vector<std::unique_ptr<Layer>> m_layers;
+
+    std::shared_ptr<const Tile> getTile(const Layer &layer, const ChunkCoord &tileCoord) const;
+    std::shared_ptr<const Tile> buildTile(const Layer &layer, const ChunkCoord &tileCoord) const;
+
+    // Lattice cell of (x, z), the tile it is in and the position inside the cell
+    struct Lookup
+    {
+        ChunkCoord tile;
+        int localX, localZ; // cell inside the tile
+        float tx, tz;       // [0, 1) inside the cell
+    };
+    static Lookup locate(const Layer &layer, float x, float z);
+    static float interpolate(const Tile &tile, const Lookup &lookup);
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+// Internal to TerrainNoise.cpp / TerrainNoiseAVX2.cpp, include TerrainNoise.h instead.
+//
+// Lane-generic port of stb_perlin_noise3_internal / ridge / fbm. Ops supplies the vector types
+// (F = floats, I = ints), the lane count W and the primitive operations. Every expression is
+// evaluated in the same order as stb_perlin.h and without FMA, that is what keeps it bit-exact.
+// No standard library in here, the AVX2 translation unit is compiled with -mavx2.
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TERRAIN_NOISE_X86 1
+#endif
+
+namespace TerrainNoise
+{
+    // stb_perlin tables widened to 32 bits so they can be gathered. grad[i] packs the three
+    // components of basis[stb__perlin_randtab_grad_idx[i]] as bytes holding component + 1.
+    struct PerlinTables
+    {
+        int randtab[512];
+        int grad[512];
+    };
+
+    const PerlinTables &getPerlinTables();
+
+#ifdef TERRAIN_NOISE_X86
+    // Defined in TerrainNoiseAVX2.cpp. Only call when avx2KernelAvailable() and the CPU has AVX2.
+    bool avx2KernelAvailable();
+    void noise3BatchAVX2(const float *x, const float *y, const float *z, unsigned char seed, float *out, size_t n);
+    void ridgeNoise3BatchAVX2(const float *x, const float *y, const float *z, float lacunarity, float gain, float offset, int octaves, float *out, size_t n);
+    void fbmNoise3BatchAVX2(const float *x, const float *y, const float *z, float lacunarity, float gain, int octaves, float *out, size_t n);
+#endif
+
+    namespace Kernel
+    {
+        template <class Ops>
+        inline typename Ops::F ease(typename Ops::F a)
+        {
+            // (((a*6-15)*a + 10) * a * a * a)
+            typename Ops::F r = Ops::sub(Ops::mul(a, Ops::set1(6.0f)), Ops::set1(15.0f));
+            r = Ops::add(Ops::mul(r, a), Ops::set1(10.0f));
+            return Ops::mul(Ops::mul(Ops::mul(r, a), a), a);
+        }
+
+        template <class Ops>
+        inline typename Ops::F lerp(typename Ops::F a, typename Ops::F b, typename Ops::F t)
+        {
+            return Ops::add(a, Ops::mul(Ops::sub(b, a), t));
+        }
+
+        template <class Ops>
+        inline typename Ops::F grad(const PerlinTables &t, typename Ops::I idx,
+                                    typename Ops::F x, typename Ops::F y, typename Ops::F z)
+        {
+            typename Ops::I g = Ops::gather(t.grad, idx);
+            typename Ops::F gx = Ops::unpackGrad(g, 0);
+            typename Ops::F gy = Ops::unpackGrad(g, 8);
+            typename Ops::F gz = Ops::unpackGrad(g, 16);
+            return Ops::add(Ops::add(Ops::mul(gx, x), Ops::mul(gy, y)), Ops::mul(gz, z));
+        }
+
+        template <class Ops>
+        inline typename Ops::F noise3(const PerlinTables &t, typename Ops::F x, typename Ops::F y, typename Ops::F z, int seed)
+        {
+            using F = typename Ops::F;
+            using I = typename Ops::I;
+
+            I px = Ops::fastfloor(x);
+            I py = Ops::fastfloor(y);
+            I pz = Ops::fastfloor(z);
+            I x0 = Ops::mask255(px), x1 = Ops::mask255(Ops::addi(px, 1));
+            I y0 = Ops::mask255(py), y1 = Ops::mask255(Ops::addi(py, 1));
+            I z0 = Ops::mask255(pz), z1 = Ops::mask255(Ops::addi(pz, 1));
+
+            x = Ops::sub(x, Ops::toFloat(px));
+            y = Ops::sub(y, Ops::toFloat(py));
+            z = Ops::sub(z, Ops::toFloat(pz));
+            F u = ease<Ops>(x);
+            F v = ease<Ops>(y);
+            F w = ease<Ops>(z);
+
+            I r0 = Ops::gather(t.randtab, Ops::addi(x0, seed));
+            I r1 = Ops::gather(t.randtab, Ops::addi(x1, seed));
+
+            I r00 = Ops::gather(t.randtab, Ops::addi(r0, y0));
+            I r01 = Ops::gather(t.randtab, Ops::addi(r0, y1));
+            I r10 = Ops::gather(t.randtab, Ops::addi(r1, y0));
+            I r11 = Ops::gather(t.randtab, Ops::addi(r1, y1));
+
+            F one = Ops::set1(1.0f);
+            F xm = Ops::sub(x, one), ym = Ops::sub(y, one), zm = Ops::sub(z, one);
+
+            F n000 = grad<Ops>(t, Ops::addi(r00, z0), x, y, z);
+            F n001 = grad<Ops>(t, Ops::addi(r00, z1), x, y, zm);
+            F n010 = grad<Ops>(t, Ops::addi(r01, z0), x, ym, z);
+            F n011 = grad<Ops>(t, Ops::addi(r01, z1), x, ym, zm);
+            F n100 = grad<Ops>(t, Ops::addi(r10, z0), xm, y, z);
+            F n101 = grad<Ops>(t, Ops::addi(r10, z1), xm, y, zm);
+            F n110 = grad<Ops>(t, Ops::addi(r11, z0), xm, ym, z);
+            F n111 = grad<Ops>(t, Ops::addi(r11, z1), xm, ym, zm);
+
+            F n00 = lerp<Ops>(n000, n001, w);
+            F n01 = lerp<Ops>(n010, n011, w);
+            F n10 = lerp<Ops>(n100, n101, w);
+            F n11 = lerp<Ops>(n110, n111, w);
+
+            F n0 = lerp<Ops>(n00, n01, v);
+            F n1 = lerp<Ops>(n10, n11, v);
+
+            return lerp<Ops>(n0, n1, u);
+        }
+
+        // Runs fn(x, y, z) -> F over n points, W at a time. The tail is padded with zeros.
+        template <class Ops, class Fn>
+        inline void forEachBlock(const float *x, const float *y, const float *z, float *out, size_t n, Fn fn)
+        {
+            constexpr size_t W = Ops::W;
+            size_t i = 0;
+            for (; i + W <= n; i += W)
+                Ops::store(out + i, fn(Ops::load(x + i), Ops::load(y + i), Ops::load(z + i)));
+
+            if (i < n)
+            {
+                float tx[W] = {}, ty[W] = {}, tz[W] = {}, to[W];
+                for (size_t k = 0; k < n - i; k++)
+                {
+                    tx[k] = x[i + k];
+                    ty[k] = y[i + k];
+                    tz[k] = z[i + k];
+                }
+                Ops::store(to, fn(Ops::load(tx), Ops::load(ty), Ops::load(tz)));
+                for (size_t k = 0; k < n - i; k++)
+                    out[i + k] = to[k];
+            }
+        }
+
+        template <class Ops>
+        void noise3Batch(const float *x, const float *y, const float *z, unsigned char seed, float *out, size_t n)
+        {
+            using F = typename Ops::F;
+            const PerlinTables &t = getPerlinTables();
+            forEachBlock<Ops>(x, y, z, out, n, [&](F vx, F vy, F vz)
+                              { return noise3<Ops>(t, vx, vy, vz, seed); });
+        }
+
+        template <class Ops>
+        void ridgeNoise3Batch(const float *x, const float *y, const float *z,
+                              float lacunarity, float gain, float offset, int octaves, float *out, size_t n)
+        {
+            using F = typename Ops::F;
+            const PerlinTables &t = getPerlinTables();
+            forEachBlock<Ops>(x, y, z, out, n, [&](F vx, F vy, F vz)
+                              {
+                float frequency = 1.0f;
+                float amplitude = 0.5f;
+                F prev = Ops::set1(1.0f);
+                F sum = Ops::set1(0.0f);
+                F vOffset = Ops::set1(offset);
+
+                for (int i = 0; i < octaves; i++)
+                {
+                    F f = Ops::set1(frequency);
+                    F r = noise3<Ops>(t, Ops::mul(vx, f), Ops::mul(vy, f), Ops::mul(vz, f), (unsigned char)i);
+                    r = Ops::sub(vOffset, Ops::abs(r));
+                    r = Ops::mul(r, r);
+                    sum = Ops::add(sum, Ops::mul(Ops::mul(r, Ops::set1(amplitude)), prev));
+                    prev = r;
+                    frequency *= lacunarity;
+                    amplitude *= gain;
+                }
+                return sum; });
+        }
+
+        template <class Ops>
+        void fbmNoise3Batch(const float *x, const float *y, const float *z,
+                            float lacunarity, float gain, int octaves, float *out, size_t n)
+        {
+            using F = typename Ops::F;
+            const PerlinTables &t = getPerlinTables();
+            forEachBlock<Ops>(x, y, z, out, n, [&](F vx, F vy, F vz)
+                              {
+                float frequency = 1.0f;
+                float amplitude = 1.0f;
+                F sum = Ops::set1(0.0f);
+
+                for (int i = 0; i < octaves; i++)
+                {
+                    F f = Ops::set1(frequency);
+                    F r = noise3<Ops>(t, Ops::mul(vx, f), Ops::mul(vy, f), Ops::mul(vz, f), (unsigned char)i);
+                    sum = Ops::add(sum, Ops::mul(r, Ops::set1(amplitude)));
+                    frequency *= lacunarity;
+                    amplitude *= gain;
+                }
+                return sum; });
+        }
+    }
+}
@@ -0,0 +1,238 @@
+#include "TerrainRaycast.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+void HeightPyramid::build(const std::vector<float> &heightGrid, int cellsPerAxis, float heightScale)
+{
+    const int N = cellsPerAxis + 1;
+    assert(heightGrid.size() == (size_t)N * N);
+    m_cells = cellsPerAxis;
+    m_heightScale = heightScale;
+    m_levels.clear();
+
+    // Level 0 straight from the grid, a node of 2x2 cells spans 3x3 vertices (2x2 at the far edges of an odd grid)
+    Level level;
+    level.size = (cellsPerAxis + 1) / 2;
+    level.minMax.resize(level.size * level.size);
+    for (int z = 0; z < level.size; z++)
+    {
+        for (int x = 0; x < level.size; x++)
+        {
+            float lo = std::numeric_limits<float>::max();
+            float hi = std::numeric_limits<float>::lowest();
+            for (int gz = 2 * z; gz <= std::min(2 * z + 2, cellsPerAxis); gz++)
+            {
+                for (int gx = 2 * x; gx <= std::min(2 * x + 2, cellsPerAxis); gx++)
+                {
+                    lo = std::min(lo, heightGrid[gz * N + gx]);
+                    hi = std::max(hi, heightGrid[gz * N + gx]);
+                }
+            }
+            level.minMax[z * level.size + x] = glm::vec2(lo, hi) * heightScale;
+        }
+    }
+    m_levels.push_back(std::move(level));
+
+    // Every next level from the one below, until one node covers the chunk
+    while (m_levels.back().size > 1)
+    {
+        const Level &below = m_levels.back();
+        Level next;
+        next.size = (below.size + 1) / 2;
+        next.minMax.resize(next.size * next.size);
+        for (int z = 0; z < next.size; z++)
+        {
+            for (int x = 0; x < next.size; x++)
+            {
+                glm::vec2 range(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+                for (int cz = 2 * z; cz < std::min(2 * z + 2, below.size); cz++)
+                {
+                    for (int cx = 2 * x; cx < std::min(2 * x + 2, below.size); cx++)
+                    {
+                        const glm::vec2 &child = below.minMax[cz * below.size + cx];
+                        range.x = std::min(range.x, child.x);
+                        range.y = std::max(range.y, child.y);
+                    }
+                }
+                next.minMax[z * next.size + x] = range;
+            }
+        }
+        m_levels.push_back(std::move(next));
+    }
+}
+
+size_t HeightPyramid::memoryBytes() const
+{
+    size_t bytes = sizeof(HeightPyramid);
+    for (const Level &level : m_levels)
+        bytes += level.minMax.capacity() * sizeof(glm::vec2);
+    return bytes;
+}
+
+bool HeightPyramid::intersectCell(const std::vector<float> &heightGrid, float cellSize, int cx, int cz, const glm::vec3 &origin,
+                                  const glm::vec3 &direction, float t0, float t1, float &tHit) const
+{
+    const int N = m_cells + 1;
+    const float h00 = heightGrid[cz * N + cx] * m_heightScale;
+    const float h10 = heightGrid[cz * N + cx + 1] * m_heightScale;
+    const float h01 = heightGrid[(cz + 1) * N + cx] * m_heightScale;
+    const float h11 = heightGrid[(cz + 1) * N + cx + 1] * m_heightScale;
+
+    // Position inside the cell along the ray, f = f0 + fd * t
+    const float fx0 = (origin.x - cx * cellSize) / cellSize;
+    const float fz0 = (origin.z - cz * cellSize) / cellSize;
+    const float fxd = direction.x / cellSize;
+    const float fzd = direction.z / cellSize;
+
+    // Height of the ray above a triangle's plane h = c + a * fx + b * fz, linear in t
+    auto above = [&](float c, float a, float b, float t)
+    { return origin.y + direction.y * t - (c + a * (fx0 + fxd * t) + b * (fz0 + fzd * t)); };
+
+    // Split where the ray crosses the diagonal fx + fz = 1, so each piece is over a single triangle
+    float split[3] = {t0, t1, t1};
+    int pieces = 1;
+    const float diagonalRate = fxd + fzd;
+    if (diagonalRate != 0.0f)
+    {
+        float tDiagonal = (1.0f - fx0 - fz0) / diagonalRate;
+        if (tDiagonal > t0 && tDiagonal < t1)
+        {
+            split[1] = tDiagonal;
+            pieces = 2;
+        }
+    }
+
+    for (int i = 0; i < pieces; i++)
+    {
+        float ta = split[i];
+        float tb = split[i + 1];
+        float tm = 0.5f * (ta + tb);
+
+        // TL-BL-TR below the diagonal, TR-BL-BR above it (same as sampleHeightGrid)
+        float c, a, b;
+        if (fx0 + fxd * tm + fz0 + fzd * tm < 1.0f)
+        {
+            c = h00;
+            a = h10 - h00;
+            b = h01 - h00;
+        }
+        else
+        {
+            c = h10 + h01 - h11;
+            a = h11 - h01;
+            b = h11 - h10;
+        }
+
+        float ga = above(c, a, b, ta);
+        if (ga <= 0.0f)
+        {
+            tHit = ta; // already below the surface where the piece starts
+            return true;
+        }
+        float gb = above(c, a, b, tb);
+        if (gb <= 0.0f)
+        {
+            tHit = ta + (tb - ta) * ga / (ga - gb);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HeightPyramid::intersect(const std::vector<float> &heightGrid, float cellSize, const glm::vec3 &origin, const glm::vec3 &direction,
+                              float tMin, float tMax, float &tHit, int &nodeVisits) const
+{
+    if (m_levels.empty())
+        return false;
+
+    // Clip [t0, t1] to the XZ box, false if the ray misses it. Boxes are grown a little so a ray along the
+    // shared edge of two nodes can not slip between them.
+    const float grow = cellSize * 1e-4f;
+    auto clip = [&](float minX, float maxX, float minZ, float maxZ, float &t0, float &t1)
+    {
+        const float lo[2] = {minX - grow, minZ - grow};
+        const float hi[2] = {maxX + grow, maxZ + grow};
+        const float o[2] = {origin.x, origin.z};
+        const float d[2] = {direction.x, direction.z};
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (d[axis] == 0.0f)
+            {
+                if (o[axis] < lo[axis] || o[axis] > hi[axis])
+                    return false;
+                continue;
+            }
+            float ta = (lo[axis] - o[axis]) / d[axis];
+            float tb = (hi[axis] - o[axis]) / d[axis];
+            if (ta > tb)
+                std::swap(ta, tb);
+            t0 = std::max(t0, ta);
+            t1 = std::min(t1, tb);
+        }
+        return t0 <= t1;
+    };
+
+    // Nodes still to visit, level -1 are single cells. At most 4 children are pushed per level.
+    struct Node
+    {
+        int level, x, z;
+        float t0, t1;
+    };
+    Node stack[64];
+    int top = 0;
+
+    const int topLevel = (int)m_levels.size() - 1;
+    const float chunkExtent = m_cells * cellSize;
+    float t0 = tMin, t1 = tMax;
+    if (!clip(0.0f, chunkExtent, 0.0f, chunkExtent, t0, t1))
+        return false;
+    stack[top++] = {topLevel, 0, 0, t0, t1};
+
+    while (top > 0)
+    {
+        const Node node = stack[--top];
+        nodeVisits++;
+
+        if (node.level < 0)
+        {
+            if (intersectCell(heightGrid, cellSize, node.x, node.z, origin, direction, node.t0, node.t1, tHit))
+                return true;
+            continue;
+        }
+
+        // The ray is straight, so its lowest point over the node is at one of the ends
+        const Level &level = m_levels[node.level];
+        const glm::vec2 &range = level.minMax[node.z * level.size + node.x];
+        float lowest = std::min(origin.y + direction.y * node.t0, origin.y + direction.y * node.t1);
+        if (lowest > range.y)
+            continue;
+
+        // Children the ray passes through, front to back
+        const int childLevel = node.level - 1;
+        const int childSize = childLevel >= 0 ? m_levels[childLevel].size : m_cells;
+        const int childCells = childLevel >= 0 ? 2 << childLevel : 1;
+        Node children[4];
+        int count = 0;
+        for (int cz = 2 * node.z; cz < std::min(2 * node.z + 2, childSize); cz++)
+        {
+            for (int cx = 2 * node.x; cx < std::min(2 * node.x + 2, childSize); cx++)
+            {
+                float c0 = node.t0, c1 = node.t1;
+                if (clip(cx * childCells * cellSize, std::min((cx + 1) * childCells, m_cells) * cellSize,
+                         cz * childCells * cellSize, std::min((cz + 1) * childCells, m_cells) * cellSize, c0, c1))
+                {
+                    children[count++] = {childLevel, cx, cz, c0, c1};
+                }
+            }
+        }
+        std::sort(children, children + count, [](const Node &a, const Node &b)
+                  { return a.t0 < b.t0; });
+
+        assert(top + count <= 64);
+        for (int i = count - 1; i >= 0; i--)
+            stack[top++] = children[i];
+    }
+    return false;
+}
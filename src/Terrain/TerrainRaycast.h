@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// A ray against the terrain surface, direction does not have to be normalized (distances are in its units)
+struct TerrainRay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float maxDistance;
+};
+
+struct TerrainHit
+{
+    bool hit = false;
+    float distance = 0.0f; // along the ray, in units of its direction
+    glm::vec3 position = glm::vec3(0.0f);
+    int nodeVisits = 0; // pyramid nodes and cells looked at, for profiling
+};
+
+/**
+ * @brief Min/max height pyramid of one chunk, for ray casts that skip everything the ray passes above.
+ *
+ * Level 0 holds the min and max height of every 2x2 cells, each next level of every 2x2 nodes of the one
+ * below, up to a single node for the whole chunk. Cells are not stored, the leaves test the two
+ * triangles of a cell (same diagonal as the chunk mesh) straight from the height grid.
+ *
+ * intersect walks the pyramid front to back: a node the ray passes above is skipped as a whole, the
+ * children of any other node are visited in the order the ray enters them, so the first hit is the closest.
+ */
+class HeightPyramid
+{
+public:
+    // From a chunk height grid (unscaled heights, (cells + 1)^2 row major). Heights are multiplied by heightScale.
+    void build(const std::vector<float> &heightGrid, int cellsPerAxis, float heightScale);
+
+    bool empty() const { return m_levels.empty(); }
+    size_t memoryBytes() const;
+
+    // First hit of origin + t * direction, t in [tMin, tMax], with the surface of heightGrid (the grid build was
+    // called with). Origin is relative to the chunk's corner, cellSize is the chunk's vertex step.
+    bool intersect(const std::vector<float> &heightGrid, float cellSize, const glm::vec3 &origin, const glm::vec3 &direction,
+                   float tMin, float tMax, float &tHit, int &nodeVisits) const;
+
+private:
+    struct Level
+    {
+        int size;                    // nodes per side
+        std::vector<glm::vec2> minMax; // row major
+    };
+    std::vector<Level> m_levels;
+    int m_cells = 0;
+    float m_heightScale = 1.0f;
+
+    bool intersectCell(const std::vector<float> &heightGrid, float cellSize, int cx, int cz, const glm::vec3 &origin,
+                       const glm::vec3 &direction, float t0, float t1, float &tHit) const;
+};
@@ -0,0 +1,330 @@
+#include "VegetationScatter.h"
+#include "TerrainNoise.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Forest density noise: two octaves, features a couple of hundred units across
+    constexpr float FOREST_FREQUENCY = 1.0f / 180.0f;
+    constexpr float FOREST_SEED_Y = 17.5f; // slice of the 3D noise, away from the terrain's
+    constexpr int FOREST_OCTAVES = 2;
+    constexpr float FOREST_EDGE_LOW = -0.10f; // noise values ramped to density 0 and 1
+    constexpr float FOREST_EDGE_HIGH = 0.30f;
+
+    constexpr int CANDIDATES = 30; // darts thrown around every active point (Bridson)
+    constexpr uint64_t TILE_SEED = 0x5eed7ee5ull;
+
+    // splitmix64, the same numbers on every platform and standard library
+    struct Random
+    {
+        uint64_t state;
+
+        uint64_t next()
+        {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        // [0, 1)
+        float uniform() { return (float)(next() >> 40) * (1.0f / 16777216.0f); }
+    };
+
+    float wrapDelta(float d)
+    {
+        constexpr float HALF = VegetationScatter::TILE_SIZE * 0.5f;
+        if (d > HALF)
+            return d - VegetationScatter::TILE_SIZE;
+        if (d < -HALF)
+            return d + VegetationScatter::TILE_SIZE;
+        return d;
+    }
+
+    float densityFromNoise(float noise)
+    {
+        float t = std::clamp((noise - FOREST_EDGE_LOW) / (FOREST_EDGE_HIGH - FOREST_EDGE_LOW), 0.0f, 1.0f);
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    // Shift of the ranks of tile copy (tx, tz), [0, 1)
+    float tileRankOffset(int tx, int tz)
+    {
+        uint32_t h = (uint32_t)tx * 0x8da6b343u ^ (uint32_t)tz * 0xd8163841u;
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        return (float)(h >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+VegetationScatter::VegetationScatter()
+{
+    generateTile();
+}
+
+void VegetationScatter::generateTile()
+{
+    // Background grid with one point per cell at most (cell diagonal = MIN_SPACING)
+    const int cells = (int)(TILE_SIZE / (MIN_SPACING / std::sqrt(2.0f)));
+    const float cellSize = TILE_SIZE / cells;
+    std::vector<int> grid(cells * cells, -1);
+
+    Random random{TILE_SEED};
+    std::vector<glm::vec2> points;
+    std::vector<int> active;
+
+    auto cellIndex = [&](const glm::vec2 &p)
+    {
+        int cx = std::min((int)(p.x / cellSize), cells - 1);
+        int cz = std::min((int)(p.y / cellSize), cells - 1);
+        return cz * cells + cx;
+    };
+    auto addPoint = [&](const glm::vec2 &p)
+    {
+        grid[cellIndex(p)] = (int)points.size();
+        active.push_back((int)points.size());
+        points.push_back(p);
+    };
+    // Far enough from every point, measured around the tile edges
+    auto fits = [&](const glm::vec2 &p)
+    {
+        int cx = std::min((int)(p.x / cellSize), cells - 1);
+        int cz = std::min((int)(p.y / cellSize), cells - 1);
+        for (int dz = -2; dz <= 2; dz++)
+        {
+            for (int dx = -2; dx <= 2; dx++)
+            {
+                int other = grid[((cz + dz + cells) % cells) * cells + (cx + dx + cells) % cells];
+                if (other < 0)
+                    continue;
+                float ox = wrapDelta(points[other].x - p.x);
+                float oz = wrapDelta(points[other].y - p.y);
+                if (ox * ox + oz * oz < MIN_SPACING * MIN_SPACING)
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    addPoint(glm::vec2(random.uniform() * TILE_SIZE, random.uniform() * TILE_SIZE));
+    while (!active.empty())
+    {
+        size_t pick = random.next() % active.size();
+        glm::vec2 center = points[active[pick]];
+
+        bool placed = false;
+        for (int i = 0; i < CANDIDATES && !placed; i++)
+        {
+            // Uniform in the annulus MIN_SPACING to 2 * MIN_SPACING
+            float angle = random.uniform() * 6.28318531f;
+            float radius = MIN_SPACING * std::sqrt(1.0f + 3.0f * random.uniform());
+            glm::vec2 p = center + radius * glm::vec2(std::cos(angle), std::sin(angle));
+            p.x = std::fmod(p.x + TILE_SIZE, TILE_SIZE);
+            p.y = std::fmod(p.y + TILE_SIZE, TILE_SIZE);
+            if (p.x >= TILE_SIZE || p.y >= TILE_SIZE) // fmod of a value just below zero
+                continue;
+            if (fits(p))
+            {
+                addPoint(p);
+                placed = true;
+            }
+        }
+        if (!placed)
+        {
+            active[pick] = active.back();
+            active.pop_back();
+        }
+    }
+
+    // Type by share, rank, rotation and scale per point
+    float totalShare = 0.0f;
+    for (const VegetationType &type : VEGETATION_TYPES)
+        totalShare += type.share;
+
+    m_points.clear();
+    m_points.reserve(points.size());
+    for (const glm::vec2 &p : points)
+    {
+        TilePoint point;
+        point.x = p.x;
+        point.z = p.y;
+        point.rank = random.uniform();
+
+        float pickShare = random.uniform() * totalShare;
+        point.type = VEGETATION_TYPE_COUNT - 1;
+        for (int t = 0; t < VEGETATION_TYPE_COUNT; t++)
+        {
+            pickShare -= VEGETATION_TYPES[t].share;
+            if (pickShare < 0.0f)
+            {
+                point.type = (uint8_t)t;
+                break;
+            }
+        }
+        point.rotation = (uint8_t)(random.next() >> 56);
+        point.scale = (uint8_t)(random.next() >> 56);
+        m_points.push_back(point);
+    }
+
+    // Counting sort by bucket, like the chunk obstacle grids
+    constexpr float BUCKET_SIZE = TILE_SIZE / BUCKETS;
+    auto bucketOf = [&](const TilePoint &p)
+    {
+        int bx = std::min((int)(p.x / BUCKET_SIZE), BUCKETS - 1);
+        int bz = std::min((int)(p.z / BUCKET_SIZE), BUCKETS - 1);
+        return bz * BUCKETS + bx;
+    };
+    m_bucketStart.assign(BUCKETS * BUCKETS + 1, 0);
+    for (const TilePoint &p : m_points)
+        m_bucketStart[bucketOf(p) + 1]++;
+    for (int i = 0; i < BUCKETS * BUCKETS; i++)
+        m_bucketStart[i + 1] += m_bucketStart[i];
+
+    std::vector<TilePoint> sorted(m_points.size());
+    std::vector<uint32_t> next(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (const TilePoint &p : m_points)
+        sorted[next[bucketOf(p)]++] = p;
+    m_points = std::move(sorted);
+}
+
+float VegetationScatter::forestDensity(float x, float z)
+{
+    float fx = x * FOREST_FREQUENCY, fy = FOREST_SEED_Y, fz = z * FOREST_FREQUENCY;
+    float noise;
+    TerrainNoise::fbmNoise3Batch(&fx, &fy, &fz, 2.0f, 0.5f, FOREST_OCTAVES, &noise, 1);
+    return densityFromNoise(noise);
+}
+
+void VegetationScatter::scatter(float minX, float minZ, float size, std::vector<VegetationInstance> &out) const
+{
+    const float maxX = minX + size;
+    const float maxZ = minZ + size;
+
+    // Density on the world lattice around the area, bilinear in between
+    const int latticeX0 = (int)std::floor(minX / DENSITY_SPACING);
+    const int latticeZ0 = (int)std::floor(minZ / DENSITY_SPACING);
+    const int latticeW = (int)std::floor(maxX / DENSITY_SPACING) - latticeX0 + 2;
+    const int latticeH = (int)std::floor(maxZ / DENSITY_SPACING) - latticeZ0 + 2;
+    const size_t latticeCount = (size_t)latticeW * latticeH;
+
+    std::vector<float> xs(latticeCount), ys(latticeCount, FOREST_SEED_Y), zs(latticeCount), density(latticeCount);
+    for (int j = 0; j < latticeH; j++)
+    {
+        for (int i = 0; i < latticeW; i++)
+        {
+            xs[j * latticeW + i] = (latticeX0 + i) * DENSITY_SPACING * FOREST_FREQUENCY;
+            zs[j * latticeW + i] = (latticeZ0 + j) * DENSITY_SPACING * FOREST_FREQUENCY;
+        }
+    }
+    TerrainNoise::fbmNoise3Batch(xs.data(), ys.data(), zs.data(), 2.0f, 0.5f, FOREST_OCTAVES, density.data(), latticeCount);
+    for (float &d : density)
+        d = densityFromNoise(d);
+
+    // Sampled once per bucket, the density hardly changes over a bucket
+    const float invSpacing = 1.0f / DENSITY_SPACING;
+    auto densityAt = [&](float x, float z)
+    {
+        float lx = x * invSpacing - latticeX0;
+        float lz = z * invSpacing - latticeZ0;
+        int i = std::clamp((int)lx, 0, latticeW - 2);
+        int j = std::clamp((int)lz, 0, latticeH - 2);
+        float fx = lx - i, fz = lz - j;
+        const float *row = density.data() + j * latticeW + i;
+        float top = row[0] + (row[1] - row[0]) * fx;
+        float bottom = row[latticeW] + (row[latticeW + 1] - row[latticeW]) * fx;
+        return top + (bottom - top) * fz;
+    };
+
+    size_t count = out.size();
+
+    // Every bucket (of every tile copy) the area overlaps. Only the points of buckets on its edge need a bounds check.
+    constexpr float BUCKET_SIZE = TILE_SIZE / BUCKETS;
+    const int bucketX0 = (int)std::floor(minX / BUCKET_SIZE), bucketX1 = (int)std::ceil(maxX / BUCKET_SIZE);
+    const int bucketZ0 = (int)std::floor(minZ / BUCKET_SIZE), bucketZ1 = (int)std::ceil(maxZ / BUCKET_SIZE);
+    for (int wz = bucketZ0; wz < bucketZ1; wz++)
+    {
+        const int tz = wz >= 0 ? wz / BUCKETS : -((-wz + BUCKETS - 1) / BUCKETS);
+        const int bz = wz - tz * BUCKETS;
+        const float originZ = tz * TILE_SIZE;
+        const bool edgeZ = wz * BUCKET_SIZE < minZ || (wz + 1) * BUCKET_SIZE > maxZ;
+
+        for (int wx = bucketX0; wx < bucketX1; wx++)
+        {
+            const int tx = wx >= 0 ? wx / BUCKETS : -((-wx + BUCKETS - 1) / BUCKETS);
+            const int bx = wx - tx * BUCKETS;
+            const float originX = tx * TILE_SIZE;
+            const bool edge = edgeZ || wx * BUCKET_SIZE < minX || (wx + 1) * BUCKET_SIZE > maxX;
+            const float rankOffset = tileRankOffset(tx, tz);
+
+            // Fraction of every type kept in this bucket
+            float forest = densityAt((wx + 0.5f) * BUCKET_SIZE, (wz + 0.5f) * BUCKET_SIZE);
+            float keep[VEGETATION_TYPE_COUNT];
+            for (int t = 0; t < VEGETATION_TYPE_COUNT; t++)
+                keep[t] = VEGETATION_TYPES[t].openDensity + (VEGETATION_TYPES[t].forestDensity - VEGETATION_TYPES[t].openDensity) * forest;
+
+            // Every point is written and only counted if it is kept, the keep test is a coin flip for the branch predictor
+            const int bucket = bz * BUCKETS + bx;
+            const uint32_t begin = m_bucketStart[bucket], end = m_bucketStart[bucket + 1];
+            out.resize(count + (end - begin));
+            VegetationInstance *instances = out.data();
+            const uint8_t rotationOffset = (uint8_t)(rankOffset * 256.0f);
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const TilePoint &p = m_points[i];
+                float x = originX + p.x;
+                float z = originZ + p.z;
+                float rank = p.rank + rankOffset;
+                rank -= rank >= 1.0f ? 1.0f : 0.0f;
+                bool kept = rank < keep[p.type];
+                if (edge)
+                    kept = kept && x >= minX && x < maxX && z >= minZ && z < maxZ;
+
+                VegetationInstance &instance = instances[count];
+                instance.position = glm::vec3(x, 0.0f, z);
+                instance.type = p.type;
+                instance.rotation = (uint8_t)(p.rotation + rotationOffset);
+                instance.scale = p.scale;
+                instance.padding = 0;
+                count += kept;
+            }
+        }
+    }
+    out.resize(count);
+}
+
+uint64_t VegetationScatter::getHash() const
+{
+    // FNV-1a, like TerrainChunkManager::computeTerrainHash
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void *data, size_t size)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    for (const TilePoint &p : m_points)
+    {
+        float values[] = {p.x, p.z, p.rank};
+        uint8_t bytes[] = {p.type, p.rotation, p.scale};
+        mix(values, sizeof(values));
+        mix(bytes, sizeof(bytes));
+    }
+    for (const VegetationType &type : VEGETATION_TYPES)
+    {
+        float values[] = {type.share, type.forestDensity, type.openDensity, type.minHeight, type.maxHeight};
+        mix(values, sizeof(values));
+    }
+    for (int i = 0; i < 64; i++)
+    {
+        float density = forestDensity((float)(i * 131 - 4000), (float)(i * 257 - 8000));
+        mix(&density, sizeof(density));
+    }
+    return hash;
+}
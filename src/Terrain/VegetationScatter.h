@@ -0,0 +1,95 @@
+#pragma once
+
+#include "TerrainConfig.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// One kind of vegetation the terrain is scattered with, each is drawn by its own instanced renderer
+struct VegetationType
+{
+    const char *name;
+    const char *model;    // relative to MODELS_DIR
+    float height;         // world units the model is scaled to (before the per instance scale)
+    float share;          // fraction of the Poisson points that are this type
+    float forestDensity;  // fraction of its points kept where the forest density is 1
+    float openDensity;    // and where it is 0 (clearings, meadows)
+    float minHeight;      // unscaled terrain height band it grows in, sea level is 0.131
+    float maxHeight;
+    float obstacleRadius; // collision circle for the player, 0 = walk through
+};
+
+inline constexpr VegetationType VEGETATION_TYPES[] = {
+    {"gran", "gran/gran.obj", 4.4f, 0.40f, 0.90f, 0.03f, 0.132f, 0.70f, TC_TREE_OBSTACLE_RADIUS},
+    {"pinetree", "low-poly-pinetree/low-poly-pinetree.obj", 6.0f, 0.25f, 0.70f, 0.0f, 0.30f, 0.85f, TC_TREE_OBSTACLE_RADIUS},
+    {"pinetree2", "low-poly-pinetree2/pineTree.obj", 7.0f, 0.30f, 0.80f, 0.02f, 0.132f, 0.60f, TC_TREE_OBSTACLE_RADIUS},
+    {"box", "wooden-box-low-poly/source/box_low.fbx", 1.0f, 0.05f, 0.0f, 0.06f, 0.132f, 0.45f, 0.7f},
+};
+inline constexpr int VEGETATION_TYPE_COUNT = (int)std::size(VEGETATION_TYPES);
+
+// One placed plant (or box), 16 bytes. Kept like this in the chunks and the disk cache.
+struct VegetationInstance
+{
+    glm::vec3 position;
+    uint8_t type;     // index into VEGETATION_TYPES
+    uint8_t rotation; // around y, 256 steps
+    uint8_t scale;    // 0.8 to 1.2 times the type's height
+    uint8_t padding;
+
+    float rotationDegrees() const { return rotation * (360.0f / 256.0f); }
+    float scaleFactor() const { return 0.8f + scale * (0.4f / 255.0f); }
+};
+
+/**
+ * @brief Vegetation positions from a precomputed Poisson disk tile instead of noise per grid point.
+ *
+ * One TILE_SIZE x TILE_SIZE point set with at least MIN_SPACING between points (Bridson's dart
+ * throwing, distances wrapped around the tile so copies of it line up without gaps or clumps) is
+ * generated once and repeated over the world. Every point has a type, a random rank and a rotation.
+ * A chunk takes the points of the tile buckets it overlaps and keeps the ones whose rank is below
+ * the local density, a two octave noise on a coarse world lattice. No octave sums per point,
+ * just a table walk and a bilinear lookup.
+ *
+ * The rank is shifted per tile copy, so neighbouring copies thin out differently and the tile does
+ * not show. Everything only depends on the world position, chunks of any size agree on their borders.
+ */
+class VegetationScatter
+{
+public:
+    static constexpr float TILE_SIZE = 64.0f;
+    static constexpr float MIN_SPACING = 3.0f;
+    static constexpr float DENSITY_SPACING = 32.0f; // world units between the density lattice points
+    static constexpr int BUCKETS = 8;               // per tile side, the points are grouped by bucket
+
+    VegetationScatter();
+
+    // Instances in [minX, minX + size) x [minZ, minZ + size), appended to out with y = 0 (the caller
+    // puts them on the terrain and drops the ones outside their height band). Thread safe.
+    void scatter(float minX, float minZ, float size, std::vector<VegetationInstance> &out) const;
+
+    // Forest density at world (x, z), 0 to 1. Exact, not from the lattice.
+    static float forestDensity(float x, float z);
+
+    // Of the tile, the type table and the density noise, for the disk cache parameter hash
+    uint64_t getHash() const;
+
+    size_t getTilePointCount() const { return m_points.size(); }
+
+private:
+    struct TilePoint
+    {
+        float x, z;       // in [0, TILE_SIZE)
+        float rank;       // [0, 1), kept where rank < density
+        uint8_t type;
+        uint8_t rotation;
+        uint8_t scale;
+    };
+    std::vector<TilePoint> m_points;      // sorted by bucket
+    std::vector<uint32_t> m_bucketStart;  // points of bucket (bx, bz) are m_points[m_bucketStart[i]] to m_points[m_bucketStart[i + 1]], i = bz * BUCKETS + bx
+
+    void generateTile();
+};
@@ -0,0 +1,99 @@
+#include "WaterRenderer.h"
+#include "VertexBufferLayout.h"
+
+#include <cmath>
+
+WaterRenderer::WaterRenderer(float seaLevel, std::vector<std::shared_ptr<Texture>> textures)
+    : m_textures(std::move(textures))
+{
+    // One ring of cells more than GRID_CELLS, so the grid still covers the render distance
+    // when the snapped offset lags up to a cell behind the camera
+    constexpr int half = GRID_CELLS / 2 + 1;
+    constexpr int side = 2 * half + 1; // vertices per side
+
+    // Local positions in cells, the shader scales them by u_cellSize
+    std::vector<glm::vec2> vertices;
+    vertices.reserve(side * side);
+    for (int z = -half; z <= half; z++)
+    {
+        for (int x = -half; x <= half; x++)
+            vertices.push_back(glm::vec2((float)x, (float)z));
+    }
+
+    // Subdivided (not a single quad) so it matches the terrain meshes it intersects
+    std::vector<unsigned short> indices;
+    indices.reserve((side - 1) * (side - 1) * 6);
+    for (int z = 0; z < side - 1; z++)
+    {
+        for (int x = 0; x < side - 1; x++)
+        {
+            unsigned short topLeft = z * side + x;
+            unsigned short topRight = topLeft + 1;
+            unsigned short bottomLeft = (z + 1) * side + x;
+            unsigned short bottomRight = bottomLeft + 1;
+
+            indices.insert(indices.end(), {topLeft, bottomLeft, topRight});
+            indices.insert(indices.end(), {topRight, bottomLeft, bottomRight});
+        }
+    }
+
+    m_vertexArray = std::make_unique<VertexArray>();
+    m_vertexBuffer = std::make_unique<VertexBuffer>(vertices.data(), vertices.size() * sizeof(glm::vec2), m_vertexArray.get());
+    VertexBufferLayout layout;
+    layout.push<float>(2); // local x, z in cells
+    m_vertexArray->addBuffer(m_vertexBuffer.get(), layout);
+    m_indexBuffer = std::make_unique<IndexBuffer>(indices); // VAO is still bound, so it keeps this IBO
+
+    m_shader = std::make_shared<Shader>();
+    m_shader->addShader("Water.vert", ShaderType::VERTEX);
+    m_shader->addShader("Water.frag", ShaderType::FRAGMENT);
+    m_shader->createProgram();
+    m_shader->bind();
+    m_shader->setUniform("u_seaLevel", seaLevel);
+}
+
+void WaterRenderer::setFogUniforms(const glm::vec3 &fogColor, float fogStart, float fogEnd)
+{
+    m_shader->bind();
+    m_shader->setUniform("u_fogColor", fogColor);
+    m_shader->setUniform("u_fogStart", fogStart);
+    m_shader->setUniform("u_fogEnd", fogEnd);
+}
+
+void WaterRenderer::render(const glm::mat4 &view, const glm::mat4 &projection, const PhongLightConfig *light,
+                           const glm::vec3 &cameraPosition, float renderDistance)
+{
+    RenderingContext *rContext = RenderingContext::Current();
+    if (m_shader->getID() != rContext->m_boundShader)
+        m_shader->bind();
+
+    for (const auto &texture : m_textures)
+    {
+        if (rContext->m_boundTextures[texture->getSlot()] != texture->getID())
+            texture->bindNew(texture->getID() % REQUIRED_NUM_TEXTURE_UNITS);
+        m_shader->setUniform(texture->m_targetUniform, texture->getSlot());
+    }
+
+    // Follow the camera in whole cells
+    float cellSize = 2.0f * renderDistance / GRID_CELLS;
+    glm::vec2 offset(std::floor(cameraPosition.x / cellSize) * cellSize,
+                     std::floor(cameraPosition.z / cellSize) * cellSize);
+    m_shader->setUniform("u_offset", offset);
+    m_shader->setUniform("u_cellSize", cellSize);
+
+    m_shader->setUniform("u_view", view);
+    m_shader->setUniform("u_projection", projection);
+    m_shader->setUniform("u_camPos", glm::vec3(glm::inverse(view)[3]));
+    if (light != nullptr)
+    {
+        m_shader->setUniform("u_light_position", light->lightPosition);
+        m_shader->setUniform("u_light_ambient", light->ambientLight);
+        m_shader->setUniform("u_light_diffuse", light->diffuseLight);
+        m_shader->setUniform("u_light_specular", light->specularLight);
+    }
+
+    // Binding the VAO also binds its IBO
+    if (rContext->m_boundVAO != m_vertexArray->getID())
+        m_vertexArray->bind();
+    GLCALL(glDrawElements(GL_TRIANGLES, m_indexBuffer->getCount(), m_indexBuffer->getType(), nullptr));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Common.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "MeshRenderable.h" // PhongLightConfig (Lighting.h needs MeshRenderable)
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The water plane at sea level around the camera.
+ *
+ * One grid created in the constructor and never touched again. Every frame it is moved to the
+ * camera with an offset uniform snapped to whole grid cells (so the vertices dont swim) and
+ * scaled to the render distance. Drawn with its own shader (Water.vert / Water.frag), only the
+ * water textures are bound.
+ */
+class WaterRenderer
+{
+public:
+    // textures: the blue and white water textures (u_texture3, u_texture4 like TerrainBlend.frag)
+    WaterRenderer(float seaLevel, std::vector<std::shared_ptr<Texture>> textures);
+
+    void setFogUniforms(const glm::vec3 &fogColor, float fogStart, float fogEnd);
+
+    // Draw the water covering at least renderDistance around cameraPosition
+    void render(const glm::mat4 &view, const glm::mat4 &projection, const PhongLightConfig *light,
+                const glm::vec3 &cameraPosition, float renderDistance);
+
+private:
+    static constexpr int GRID_CELLS = 10; // cells across the render distance diameter
+
+    std::unique_ptr<VertexArray> m_vertexArray;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<IndexBuffer> m_indexBuffer;
+    std::shared_ptr<Shader> m_shader;
+    std::vector<std::shared_ptr<Texture>> m_textures;
+};
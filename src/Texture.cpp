@@ -80,6 +80,88 @@ std::shared_ptr<Texture> Texture::CreateCubemap(const std::vector<std::filesyste
     return tex;
 }
 
+std::shared_ptr<Texture> Texture::CreateFloatTextureArray(int width, int height, int layers, const std::string &targetUniform)
+{
+    std::shared_ptr<Texture> tex = std::make_shared<Texture>(TextureBindTarget::TEXTURE_2D_ARRAY);
+    tex->m_targetUniform = targetUniform;
+    tex->m_filePath = "[FLOAT TEXTURE ARRAY]";
+    tex->m_width = width;
+    tex->m_height = height;
+    tex->m_BPP = 4;
+    tex->m_layers = layers;
+
+    GLCALL(glGenTextures(1, &tex->m_rendererID));
+    tex->bind();
+    GLCALL(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, width, height, layers, 0, GL_RED, GL_FLOAT, nullptr));
+
+    // No mipmaps, so the filter has to be nearest/linear or the texture is incomplete
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+    return tex;
+}
+
+std::shared_ptr<Texture> Texture::CreateColorTextureArray(int width, int height, int layers, const std::string &targetUniform)
+{
+    std::shared_ptr<Texture> tex = std::make_shared<Texture>(TextureBindTarget::TEXTURE_2D_ARRAY);
+    tex->m_targetUniform = targetUniform;
+    tex->m_filePath = "[COLOR TEXTURE ARRAY]";
+    tex->m_width = width;
+    tex->m_height = height;
+    tex->m_BPP = 4;
+    tex->m_layers = layers;
+
+    GLCALL(glGenTextures(1, &tex->m_rendererID));
+    tex->bind();
+    GLCALL(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+    return tex;
+}
+
+std::shared_ptr<Texture> Texture::CreateRenderTexture2D(int width, int height, const std::string &targetUniform)
+{
+    std::shared_ptr<Texture> tex = std::make_shared<Texture>(TextureBindTarget::TEXTURE_2D);
+    tex->m_targetUniform = targetUniform;
+    tex->m_filePath = "[RENDER TEXTURE]";
+    tex->m_width = width;
+    tex->m_height = height;
+    tex->m_BPP = 4;
+
+    GLCALL(glGenTextures(1, &tex->m_rendererID));
+    tex->bind();
+    GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+
+    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+    return tex;
+}
+
+void Texture::uploadLayer(int layer, const float *data)
+{
+    assert(m_target == TEXTURE_2D_ARRAY && layer >= 0 && layer < m_layers);
+
+    bind();
+    GLCALL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, m_width, m_height, 1, GL_RED, GL_FLOAT, data));
+}
+
+void Texture::uploadLayer(int layer, const uint8_t *data)
+{
+    assert(m_target == TEXTURE_2D_ARRAY && layer >= 0 && layer < m_layers);
+
+    bind();
+    GLCALL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, m_width, m_height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data));
+}
+
 Texture::~Texture()
 {
     // std::string type = (m_target == TEXTURE_2D) ? "2D Texture" : "Cubemap Texture";
@@ -5,7 +5,8 @@
 enum TextureBindTarget
 {
     TEXTURE_2D = GL_TEXTURE_2D,
-    CUBEMAP = GL_TEXTURE_CUBE_MAP
+    CUBEMAP = GL_TEXTURE_CUBE_MAP,
+    TEXTURE_2D_ARRAY = GL_TEXTURE_2D_ARRAY
 };
 
 
@@ -18,6 +19,7 @@ private:
     std::string m_filePath;    
     TextureBindTarget m_target;
     int m_width, m_height, m_BPP;
+    int m_layers = 1;
 
 public:
     /**      
@@ -38,6 +40,34 @@ public:
     static std::shared_ptr<Texture> CreateTexture2D(const std::filesystem::path &path, const std::string &targetUniform);
     static std::shared_ptr<Texture> CreateCubemap(const std::vector<std::filesystem::path> &facePaths, const std::string &targetUniform);
 
+    /**
+     * @brief Create an empty single channel float (R32F) texture array, e.g. terrain heightmaps with one layer per chunk.
+     * Sampled with nearest filtering and no mipmaps, meant for texelFetch.
+     */
+    static std::shared_ptr<Texture> CreateFloatTextureArray(int width, int height, int layers, const std::string &targetUniform);
+
+    /**
+     * @brief Create an empty RGBA8 texture array, e.g. terrain splat weights with one layer per chunk.
+     * Linear filtering, no mipmaps, clamped to the edge.
+     */
+    static std::shared_ptr<Texture> CreateColorTextureArray(int width, int height, int layers, const std::string &targetUniform);
+
+    /**
+     * @brief Create an empty RGBA8 texture to render into (framebuffer color attachment).
+     * Linear filtering, no mipmaps, clamped to the edge.
+     */
+    static std::shared_ptr<Texture> CreateRenderTexture2D(int width, int height, const std::string &targetUniform);
+
+    /**
+     * @brief Upload one layer of a texture created by CreateFloatTextureArray. data holds width * height floats.
+     */
+    void uploadLayer(int layer, const float *data);
+
+    /**
+     * @brief Upload one layer of a texture created by CreateColorTextureArray. data holds width * height RGBA texels.
+     */
+    void uploadLayer(int layer, const uint8_t *data);
+
     GLuint getID() const { return m_rendererID; }
     GLuint getSlot() const { return m_slot; }
 
@@ -55,4 +85,5 @@ public:
 
     inline int getWidth() const { return m_width; }
     inline int getHeight() const { return m_height; }
+    inline int getLayerCount() const { return m_layers; }
 };
\ No newline at end of file
@@ -16,8 +16,21 @@ void ThirdPersonCamera::update(Camera &cam, const PlayerData &p_data, float dt)
         cos(yawRad));
 
     glm::vec3 camPos = p_data.m_position - forward * m_distance + glm::vec3(0, m_height, 0);
+    glm::vec3 target = p_data.m_position + glm::vec3(0, 1.8f, 0);
 
     handlePanning(dt);
+
+    // Dont look through a ridge between the player and the camera
+    if (m_occlusionFunc.has_value())
+    {
+        float visible = (*m_occlusionFunc)(target, camPos);
+        if (visible < 1.0f)
+        {
+            float length = glm::length(camPos - target);
+            float keep = length > 0.0f ? glm::max(visible - m_occlusionPadding / length, 0.0f) : 0.0f;
+            camPos = target + (camPos - target) * keep;
+        }
+    }
     
     cam.m_Position = camPos;
 
@@ -27,7 +40,7 @@ void ThirdPersonCamera::update(Camera &cam, const PlayerData &p_data, float dt)
         float computedMinHeight = (*m_minHeightFunc)(cam.m_Position.x, cam.m_Position.z); 
         cam.m_Position.y = glm::max(cam.m_Position.y, computedMinHeight);
     }
-    cam.m_Target = p_data.m_position + glm::vec3(0, 1.8f, 0);
+    cam.m_Target = target;
 }
 
 void ThirdPersonCamera::handlePanning(float dt)
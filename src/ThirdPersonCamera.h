@@ -14,6 +14,7 @@ public:
     float m_maxHeight = 15.0f;
 
     float pitch = -15.0f; 
+    float m_occlusionPadding = 0.5f; // how far in front of an occluder the camera stops
 
     void update(Camera &cam, const PlayerData &p_data, float dt);
 
@@ -22,7 +23,15 @@ public:
         m_minHeightFunc = std::move(func);
     }
 
+    // Called with (from, to), returns how far along to - from (0 to 1) the first obstacle is, 1 if nothing is in the way.
+    // The camera is pulled in front of whatever is between the player and it.
+    void setOcclusionFunction(std::function<float(const glm::vec3 &, const glm::vec3 &)> func)
+    {
+        m_occlusionFunc = std::move(func);
+    }
+
 private:
     std::optional<std::function<float(float, float)>> m_minHeightFunc;
+    std::optional<std::function<float(const glm::vec3 &, const glm::vec3 &)>> m_occlusionFunc;
     void handlePanning(float dt);
 };
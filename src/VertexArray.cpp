@@ -36,6 +36,8 @@ void VertexArray::bind() const
     GLCALL(glBindVertexArray(m_RendererID));
     RenderingContext *rContext = RenderingContext::Current();
     rContext->m_boundVAO = m_RendererID;
+    // The element buffer binding is part of the VAO state, so we dont know what is bound anymore
+    rContext->m_boundIBO = 0;
 }
 
 void VertexArray::unbind() const
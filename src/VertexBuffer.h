@@ -22,8 +22,8 @@ public:
 
     ~VertexBuffer();
 
-    // behöver vi nånsin hämta id här, iochmed att datan ligger i VAOn?
-    // unsigned int getID() const { return m_RendererID; }
+    // Mostly the VAO's business, but compute shaders write vertices through the id (GpuTerrainGenerator)
+    unsigned int getID() const { return m_RendererID; }
     unsigned int getSize() const { return m_Size; }
 
     // behöver inte renderingcontext här eftersom vi inte trackar VBOs (datan är väl bunden via VAOn?)
@@ -20,6 +20,10 @@ struct VertexBufferElement
             return 4;
         case GL_UNSIGNED_BYTE:
             return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return 2;
         default:
             DEBUG_PRINT("Unknown type: " << type);
             return 0;
@@ -41,7 +45,21 @@ public:
     template <typename T>
     inline void push(unsigned int count)
     {
-        static_assert(sizeof(T) == 0, "Push<T> not implemented for this type. Use float, unsigned int, or unsigned char.");
+        static_assert(sizeof(T) == 0, "Push<T> not implemented for this type. Use float, unsigned int, unsigned char, short or unsigned short.");
+    }
+
+    // Integer attribute that the shader reads as a float in [0, 1] (unsigned) or [-1, 1] (signed)
+    template <typename T>
+    inline void pushNormalized(unsigned int count)
+    {
+        static_assert(sizeof(T) == 0, "pushNormalized<T> not implemented for this type. Use unsigned char, short or unsigned short.");
+    }
+
+    // 16-bit float attribute. The data is GLhalf (raw bits), read as float in the shader
+    inline void pushHalf(unsigned int count)
+    {
+        m_Elements.push_back({GL_HALF_FLOAT, count, GL_FALSE});
+        m_stride += VertexBufferElement::getSizeOfType(GL_HALF_FLOAT) * count;
     }
     
     inline const std::vector<VertexBufferElement> &getElements() const { return m_Elements; }
@@ -68,4 +86,40 @@ inline void VertexBufferLayout::push<unsigned char>(unsigned int count)
 {
     m_Elements.push_back({GL_UNSIGNED_BYTE, count, GL_TRUE});
     m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_BYTE) * count;
+}
+
+// short types are passed to the shader as their integer value converted to float (e.g. 100 -> 100.0)
+template <>
+inline void VertexBufferLayout::push<short>(unsigned int count)
+{
+    m_Elements.push_back({GL_SHORT, count, GL_FALSE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_SHORT) * count;
+}
+
+template <>
+inline void VertexBufferLayout::push<unsigned short>(unsigned int count)
+{
+    m_Elements.push_back({GL_UNSIGNED_SHORT, count, GL_FALSE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_SHORT) * count;
+}
+
+template <>
+inline void VertexBufferLayout::pushNormalized<unsigned char>(unsigned int count)
+{
+    m_Elements.push_back({GL_UNSIGNED_BYTE, count, GL_TRUE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_BYTE) * count;
+}
+
+template <>
+inline void VertexBufferLayout::pushNormalized<short>(unsigned int count)
+{
+    m_Elements.push_back({GL_SHORT, count, GL_TRUE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_SHORT) * count;
+}
+
+template <>
+inline void VertexBufferLayout::pushNormalized<unsigned short>(unsigned int count)
+{
+    m_Elements.push_back({GL_UNSIGNED_SHORT, count, GL_TRUE});
+    m_stride += VertexBufferElement::getSizeOfType(GL_UNSIGNED_SHORT) * count;
 }
\ No newline at end of file
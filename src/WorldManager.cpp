@@ -66,7 +66,8 @@ bool WorldManager::initializeCamera()
 bool WorldManager::initializeTerrain()
 {
     // Create terrain generator
-    m_terrainGen = std::make_unique<TerrainGenerator>();
+    TerrainConfig terrainConfig = TerrainConfig::preset(m_terrainQuality);
+    m_terrainGen = std::make_unique<TerrainGenerator>(terrainConfig);
 
     // Create and compile terrain shader
     auto terrainShader = std::make_shared<Shader>();
@@ -85,7 +86,8 @@ bool WorldManager::initializeTerrain()
         groundTex, grassTex, mountainTex, blueWaterTex, whiteWaterTex};
 
     // Create chunk manager
-    m_chunkManager = std::make_unique<TerrainChunkManager>(m_terrainGen.get(), terrainTextures);
+    m_chunkManager = std::make_unique<TerrainChunkManager>(m_terrainGen.get(), terrainTextures, terrainConfig);
+    m_renderDistance = terrainConfig.renderDistance;
     m_chunkManager->setShader(terrainShader);
 
     // Setup fog
@@ -96,6 +98,11 @@ bool WorldManager::initializeTerrain()
                                           {
                                               return m_chunkManager->getPreciseHeightAt(x, z) + 2.0f; // TODO: why return 2.0f offset?
                                           });
+    m_camController->setOcclusionFunction([this](const glm::vec3 &from, const glm::vec3 &to)
+                                          {
+                                              TerrainHit hit = m_chunkManager->raycast({from, to - from, 1.0f});
+                                              return hit.hit ? hit.distance : 1.0f;
+                                          });
 
     return true;
 }
@@ -148,6 +155,10 @@ bool WorldManager::initializeEnemySpawners()
     std::unique_ptr<EnemySpawner> cowSpawner = std::make_unique<EnemySpawner>(cowEnemyData, cowSpawnerConfig);
     cowSpawner->setMinHeightFunction([this](float x, float z)
                                      { return m_chunkManager->getPreciseHeightAt(x, z); });
+    cowSpawner->setHeightBatchFunction([this](const float *xs, const float *zs, float *out, size_t n)
+                                       { m_chunkManager->getPreciseHeightsBatch(xs, zs, out, n); });
+    cowSpawner->setObstacleFunction([this](const glm::vec3 &pos, float range, std::vector<StaticObstacle> &out)
+                                       { m_chunkManager->collectNearbyObstacles(pos, range, out); });
     // Add animation frames
     cowSpawner->m_animatedInstanceRenderer->addAnimationFrame(AnimatedInstanceRenderer::createAnimatedInstanceFrame(MODELS_DIR / "cow" / "cow.obj", AnimationState::IDLE, 1.0f));
     cowSpawner->m_animatedInstanceRenderer->addAnimationFrame(AnimatedInstanceRenderer::createAnimatedInstanceFrame(MODELS_DIR / "cow" / "cow_walk1.obj", AnimationState::WALKING, 0.5f));
@@ -180,6 +191,10 @@ bool WorldManager::initializeEnemySpawners()
     std::unique_ptr<EnemySpawner> abbeSpawner = std::make_unique<EnemySpawner>(abbeEnemyData, abbeSpawnerConfig);
     abbeSpawner->setMinHeightFunction([this](float x, float z)
                                       { return m_chunkManager->getPreciseHeightAt(x, z); });
+    abbeSpawner->setHeightBatchFunction([this](const float *xs, const float *zs, float *out, size_t n)
+                                        { m_chunkManager->getPreciseHeightsBatch(xs, zs, out, n); });
+    abbeSpawner->setObstacleFunction([this](const glm::vec3 &pos, float range, std::vector<StaticObstacle> &out)
+                                       { m_chunkManager->collectNearbyObstacles(pos, range, out); });
 
     // override texture for Abbe enemy
     std::shared_ptr<Texture> abbeEnemyTexture = Texture::CreateTexture2D(MODELS_DIR / "abbe" / "abbe_enemy.JPEG", "u_texture_diffuse");
@@ -212,6 +227,10 @@ bool WorldManager::initializeEnemySpawners()
     std::unique_ptr<EnemySpawner> mangeSpawner = std::make_unique<EnemySpawner>(mangeEnemyData, mangeSpawnerConfig);
     mangeSpawner->setMinHeightFunction([this](float x, float z)
                                        { return m_chunkManager->getPreciseHeightAt(x, z); });
+    mangeSpawner->setHeightBatchFunction([this](const float *xs, const float *zs, float *out, size_t n)
+                                         { m_chunkManager->getPreciseHeightsBatch(xs, zs, out, n); });
+    mangeSpawner->setObstacleFunction([this](const glm::vec3 &pos, float range, std::vector<StaticObstacle> &out)
+                                       { m_chunkManager->collectNearbyObstacles(pos, range, out); });
     // Add animation frames
     mangeSpawner->m_animatedInstanceRenderer->addAnimationFrame(AnimatedInstanceRenderer::createAnimatedInstanceFrame(MODELS_DIR / "MangeMob" / "MangeMob.obj", AnimationState::IDLE, 0.5f));
     mangeSpawner->m_animatedInstanceRenderer->addAnimationFrame(AnimatedInstanceRenderer::createAnimatedInstanceFrame(MODELS_DIR / "MangeMob" / "MangeWalk1.obj", AnimationState::WALKING, 0.5f));
@@ -323,7 +342,12 @@ void WorldManager::update(float dt, InputManager *input)
     // Update terrain chunks based on camera position
     if (m_chunkManager)
     {
-        m_chunkManager->updateChunks(m_scene->m_activeCamera.m_Position);
+        const Camera &camera = m_scene->m_activeCamera;
+        TerrainChunkManager::StreamingHint hint;
+        hint.velocity = m_player->m_playerData.m_velocity;
+        hint.viewDirection = camera.m_Target - camera.m_Position;
+        hint.sprinting = m_player->m_playerData.m_isSprinting;
+        m_chunkManager->updateChunks(camera.m_Position, hint);
     }
 }
 
@@ -361,13 +385,11 @@ void WorldManager::render()
     // Render terrain chunks
     if (m_chunkManager)
     {
-        for (const auto &chunk : m_chunkManager->m_chunks)
-        {
-            chunk->render(
-                m_scene->m_activeCamera.getViewMatrix(),
-                m_scene->m_activeCamera.getProjectionMatrix(),
-                &m_scene->m_lightSource.config);
-        }
+        // Only the chunks inside the camera frustum
+        m_chunkManager->renderChunks(
+            m_scene->m_activeCamera.getViewMatrix(),
+            m_scene->m_activeCamera.getProjectionMatrix(),
+            &m_scene->m_lightSource.config);
 
         // Render global water
         m_chunkManager->renderWater(
@@ -397,6 +419,18 @@ void WorldManager::setRenderDistance(float distance)
     updateFogSettings();
 }
 
+void WorldManager::setTerrainQuality(TerrainQuality quality)
+{
+    m_terrainQuality = quality;
+    if (!m_chunkManager)
+        return; // picked up by initializeTerrain
+
+    // Chunks of a new layout are built in the background, the fog follows the new distance right away
+    TerrainConfig config = TerrainConfig::preset(quality);
+    m_chunkManager->setConfig(config);
+    setRenderDistance(config.renderDistance);
+}
+
 void WorldManager::updateFogSettings()
 {
     assert(m_chunkManager && "Chunk manager must be initialized before updating fog settings");
@@ -62,6 +62,9 @@ public:
     // Configuration
     void setRenderDistance(float distance);
     float getRenderDistance() const { return m_renderDistance; }
+    // Switch the terrain preset, also sets the render distance to the preset's
+    void setTerrainQuality(TerrainQuality quality);
+    TerrainQuality getTerrainQuality() const { return m_terrainQuality; }
     void setFogColor(const glm::vec3& color) { m_fogColor = color; }
     glm::vec3 getFogColor() const { return m_fogColor; }
     
@@ -78,6 +81,7 @@ private:
     
     // Configuration
     float m_renderDistance = 100.0f;
+    TerrainQuality m_terrainQuality = TerrainQuality::MEDIUM;
     glm::vec3 m_fogColor = glm::vec3(0.51f, 0.90f, 0.95f);
     float m_fogStart = 0.40f;
     float m_fogEnd = 0.90f;
@@ -39,6 +39,7 @@ struct EnemyData
 	float m_zigzagFrequency = 3.0f;								// How fast the zigzag oscillates
 	float m_detectionRange = std::numeric_limits<float>::max(); // Range at which enemy detects player (default: infinite)
 	float m_closeRange = 2.0f;									// Range at which enemy stops moving toward player (attack range)
+	float m_collisionRadius = 1.0f;								// Radius used to push the enemy out of trees
 
 	// Internal timer for movement patterns
 	float m_movementTimer = 0.0f;
@@ -12,10 +12,6 @@ void EnemySpawner::updateAll(float dt, Player &player)
 		spawnNew(playerPosition);
 	}
 
-	// Prepare map of transforms for instanced rendering
-	std::unordered_map<AnimationState, std::vector<glm::mat4>> instanceTransformsByState;
-	instanceTransformsByState.reserve(m_enemyDataList.size());
-
 	for (int i = 0; i < m_enemyDataList.size(); i++)
 	{
 		EnemyData &enemy_data = m_enemyDataList[i];
@@ -81,6 +77,16 @@ void EnemySpawner::updateAll(float dt, Player &player)
 			float speed = currentSpeed * dt;
 			enemy_data.m_position += moveDirection * speed;
 
+			// Walk around trees instead of through them
+			if (m_obstacleFunc.has_value())
+			{
+				m_nearbyObstacles.clear();
+				(*m_obstacleFunc)(enemy_data.m_position, enemy_data.m_collisionRadius + 2.0f, m_nearbyObstacles);
+				glm::vec2 correctedXZ = resolveObstacleCollisions(glm::vec2(enemy_data.m_position.x, enemy_data.m_position.z), enemy_data.m_collisionRadius, m_nearbyObstacles);
+				enemy_data.m_position.x = correctedXZ.x;
+				enemy_data.m_position.z = correctedXZ.y;
+			}
+
 			// Update yaw to face the movement direction
 			enemy_data.m_yaw = glm::degrees(atan2(moveDirection.x, moveDirection.z));
 		}
@@ -100,11 +106,36 @@ void EnemySpawner::updateAll(float dt, Player &player)
 				}
 			}
 		}
+	}
 
-		// Stick to terrain height
-		if (m_heightFunc.has_value())
+	// Stick to terrain height, all enemies in one query
+	if (m_heightBatchFunc.has_value())
+	{
+		const size_t count = m_enemyDataList.size();
+		m_heightXs.resize(count);
+		m_heightZs.resize(count);
+		m_heights.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			m_heightXs[i] = m_enemyDataList[i].m_position.x;
+			m_heightZs[i] = m_enemyDataList[i].m_position.z;
+		}
+		(*m_heightBatchFunc)(m_heightXs.data(), m_heightZs.data(), m_heights.data(), count);
+		for (size_t i = 0; i < count; i++)
+			m_enemyDataList[i].m_position.y = m_heights[i];
+	}
+	else if (m_heightFunc.has_value())
+	{
+		for (EnemyData &enemy_data : m_enemyDataList)
 			enemy_data.m_position.y = (*m_heightFunc)(enemy_data.m_position.x, enemy_data.m_position.z);
+	}
 
+	// Prepare map of transforms for instanced rendering
+	std::unordered_map<AnimationState, std::vector<glm::mat4>> instanceTransformsByState;
+	instanceTransformsByState.reserve(m_enemyDataList.size());
+
+	for (const EnemyData &enemy_data : m_enemyDataList)
+	{
 		// Build transform matrix for this enemy instance
 		glm::mat4 transform(1.0f);
 
@@ -5,6 +5,7 @@
 #include "Player.h"
 #include "../InstancedRenderer.h"
 #include "../AnimatedInstanceRenderer.h"
+#include "../Terrain/StaticObstacle.h"
 
 #include <optional>
 #include <glm/glm.hpp>
@@ -48,6 +49,19 @@ public:
 		m_heightFunc = std::move(func);
 	}
 
+	// Called once per updateAll with the XZ of every enemy, fills out with their heights (xs, zs, out, n),
+	// e.g. TerrainChunkManager::getPreciseHeightsBatch. Used instead of the min height function when set.
+	void setHeightBatchFunction(std::function<void(const float *, const float *, float *, size_t)> func)
+	{
+		m_heightBatchFunc = std::move(func);
+	}
+
+	// Called with (position, range, out) to append the static obstacles near an enemy, e.g. TerrainChunkManager::collectNearbyObstacles
+	void setObstacleFunction(std::function<void(const glm::vec3 &, float, std::vector<StaticObstacle> &)> func)
+	{
+		m_obstacleFunc = std::move(func);
+	}
+
 	unsigned int enemyCount() const { return static_cast<unsigned int>(m_enemyDataList.size()); }
 
 	void updateAll(float dt, Player &player);
@@ -99,5 +113,9 @@ private:
 
 	// std::unique_ptr<InstancedRenderer> m_instanceRenderer;
 	std::optional<std::function<float(float, float)>> m_heightFunc;
+	std::optional<std::function<void(const float *, const float *, float *, size_t)>> m_heightBatchFunc;
+	std::vector<float> m_heightXs, m_heightZs, m_heights; // reused for every batch height query
+	std::optional<std::function<void(const glm::vec3 &, float, std::vector<StaticObstacle> &)>> m_obstacleFunc;
+	std::vector<StaticObstacle> m_nearbyObstacles; // reused for every enemy
 	std::optional<EntitySounds> m_sounds = std::nullopt;
 };
\ No newline at end of file
@@ -15,33 +15,6 @@ void Player::render(glm::mat4 view, glm::mat4 proj, PhongLightConfig *light)
     m_playerRenderer->render(view, proj, light);
 }
 
-static glm::vec2 resolveXZCollisions(
-    const glm::vec2 &current,
-    const glm::vec2 &proposed,
-    float playerRadius,
-    float jumpover,
-    const std::vector<StaticObstacle> &obstacles)
-{
-    glm::vec2 result = proposed;
-
-    for (const auto &o : obstacles)
-    {
-        if (jumpover > 2.0f)
-            continue;
-        glm::vec2 diff = result - o.posXZ;
-        float dist = glm::length(diff);
-        float minDist = playerRadius + o.radius;
-
-        if (dist < minDist && dist > 0.0001f)
-        {
-            glm::vec2 normal = diff / dist;
-            result = o.posXZ + normal * minDist;
-        }
-    }
-
-    return result;
-}
-
 void Player::update(float dt, InputManager *input, TerrainChunkManager *terrain)
 {
     int forwardMove, rightMove;
@@ -81,16 +54,19 @@ void Player::update(float dt, InputManager *input, TerrainChunkManager *terrain)
 
     glm::vec3 proposed = m_playerData.m_position + movement;
 
-    std::vector<StaticObstacle> nearbyObstacles;
-    terrain->collectNearbyObstacles(m_playerData.m_position, 5.0f, nearbyObstacles);
+    m_nearbyObstacles.clear();
+    terrain->collectNearbyObstacles(m_playerData.m_position, 5.0f, m_nearbyObstacles);
+
+    // --- resolve XZ collision (unless jumping over) ---
+    glm::vec2 correctedXZ(proposed.x, proposed.z);
+    float jumpover = m_playerData.m_position.y - terrainY;
+    if (jumpover <= 2.0f)
+        correctedXZ = resolveObstacleCollisions(correctedXZ, 1.0f, m_nearbyObstacles);
 
-    // --- resolve XZ collision ---
-    glm::vec2 correctedXZ = resolveXZCollisions(
-        glm::vec2(m_playerData.m_position.x, m_playerData.m_position.z),
-        glm::vec2(proposed.x, proposed.z),
-        1.0f,
-        m_playerData.m_position.y - terrainY,
-        nearbyObstacles);
+    // Where we are heading, the terrain streams the chunks ahead of it
+    if (dt > 0.0f)
+        m_playerData.m_velocity = glm::vec3(correctedXZ.x - m_playerData.m_position.x, 0.0f, correctedXZ.y - m_playerData.m_position.z) / dt;
+    m_playerData.m_isSprinting = shiftDown && (forwardMove != 0 || rightMove != 0);
 
     m_playerData.m_position.x = correctedXZ.x;
     m_playerData.m_position.z = correctedXZ.y;
@@ -3,6 +3,7 @@
 #include "AnimatedInstanceRenderer.h"
 #include "Score.h"
 #include "Audio.h"
+#include "Terrain/StaticObstacle.h"
 
 #include <glm/glm.hpp>
 #include <vector>
@@ -19,6 +20,8 @@ struct PlayerData
 
     bool m_isGrounded = true;
     float m_verticalVelocity = 0.0f;
+    glm::vec3 m_velocity = glm::vec3(0.0f); // horizontal movement of the last update per second, after collisions
+    bool m_isSprinting = false;
 
     float m_jumpVelocity = 10.0f;
     float m_gravity = 20.0f;
@@ -133,4 +136,5 @@ public:
 private:
     ScoreKeeper m_scoreKeeper;
     std::optional<EntitySounds> m_sounds;
+    std::vector<StaticObstacle> m_nearbyObstacles; // reused every update
 };
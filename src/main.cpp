@@ -220,6 +220,12 @@ int main(int, char **)
                 !uiManager.isPaused())
             {
                 DEBUG_PRINT("Chunks: " << worldManager->getChunkManager()->m_chunks.size()
+                                       << " (visible " << worldManager->getChunkManager()->getVisibleChunkCount()
+                                       << ", culled " << worldManager->getChunkManager()->getCulledChunkCount()
+                                       << ", " << worldManager->getChunkManager()->getChunkStoreStats().residentBytes / 1024 << " KiB)"
+                                       << " | Streaming: " << worldManager->getChunkManager()->getStreamingStats().queuedChunks << " queued, "
+                                       << worldManager->getChunkManager()->getStreamingStats().inFlightChunks << " in flight, "
+                                       << std::fixed << std::setprecision(1) << worldManager->getChunkManager()->getStreamingStats().averageLatencyMs << " ms latency"
                                        << " | FPS: " << std::fixed << std::setprecision(1)
                                        << (1.0f / dt) << ", Score: " << worldManager->getPlayer()->getScore());
             }
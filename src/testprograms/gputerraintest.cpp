@@ -0,0 +1,136 @@
+// Validation for GpuTerrainGenerator: chunk heights from TerrainHeights.comp against the CPU noise
+// (TerrainGenerator::getPerlinHeightBatch without the noise cache, the reference), and the packed
+// vertices the shader writes against the same heights packed on the CPU. Runs anywhere with GL 4.3,
+// Mesa llvmpipe included (LIBGL_ALWAYS_SOFTWARE=1).
+//
+//   gputerraintest [chunks per side] [tolerance in world units]
+//
+// Exits with 1 if any height is further off than the tolerance.
+
+#include "Common.h"
+#include "Terrain/GpuTerrainGenerator.h"
+#include "Terrain/TerrainGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    const int chunksPerSide = argc > 1 ? std::atoi(argv[1]) : 6;
+    const float tolerance = argc > 2 ? (float)std::atof(argv[2]) : 0.01f;
+
+    if (oogaboogaInit("GPU terrain test"))
+        return -1;
+    if (!GpuTerrainGenerator::isSupported())
+    {
+        std::printf("OpenGL 4.3 is not available, nothing to test\n");
+        oogaboogaExit();
+        return 0;
+    }
+
+    int failed = 0;
+    {
+        TerrainConfig noiseConfig;
+        noiseConfig.noiseCache = false;
+        TerrainGenerator cpu(noiseConfig);
+        GpuTerrainGenerator gpu(noiseConfig);
+
+        auto config = std::make_shared<const TerrainConfig>(noiseConfig);
+        const int N = config->verticesPerAxis();
+        const int verticesPerChunk = N * N + 4 * N;
+
+        // Scratch vertex slots, one per job
+        GLuint vertexBuffer;
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, GpuTerrainGenerator::MAX_JOBS * verticesPerChunk * sizeof(TerrainVertexPacked), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        double maxError = 0.0, sumError = 0.0;
+        size_t samples = 0, overTolerance = 0, badVertices = 0;
+        double gpuMs = 0.0;
+        std::vector<float> xs(N * N), zs(N * N), reference(N * N);
+        std::vector<TerrainVertexPacked> vertices(verticesPerChunk);
+
+        // Centered on the origin, where the mountains are
+        for (int cz = 0; cz < chunksPerSide; cz++)
+        {
+            for (int cx = 0; cx < chunksPerSide; cx++)
+            {
+                ChunkCoord coord = {cx - chunksPerSide / 2, cz - chunksPerSide / 2};
+
+                auto start = std::chrono::steady_clock::now();
+                gpu.submit(coord, config, 0, vertexBuffer, 0);
+                std::vector<GpuTerrainGenerator::Result> results;
+                while (results.empty())
+                    gpu.collectFinished(results, true);
+                gpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                const std::vector<float> &heights = results[0].heightGrid;
+
+                for (int gz = 0; gz < N; gz++)
+                {
+                    for (int gx = 0; gx < N; gx++)
+                    {
+                        xs[gz * N + gx] = (float)(coord.x * config->chunkSize + gx * config->vertexStep);
+                        zs[gz * N + gx] = (float)(coord.z * config->chunkSize + gz * config->vertexStep);
+                    }
+                }
+                cpu.getPerlinHeightBatch(xs.data(), zs.data(), reference.data(), reference.size());
+
+                // Heights are unscaled, the chunks multiply them by 100
+                for (int i = 0; i < N * N; i++)
+                {
+                    double error = std::fabs((double)heights[i] - reference[i]) * 100.0;
+                    maxError = std::max(maxError, error);
+                    sumError += error;
+                    samples++;
+                    if (error > tolerance)
+                        overTolerance++;
+                }
+
+                // Vertices: grid position, skirt flag and the GPU height packed like buildChunkVertices does
+                glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+                glGetBufferSubData(GL_ARRAY_BUFFER, 0, verticesPerChunk * sizeof(TerrainVertexPacked), vertices.data());
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                auto check = [&](int index, int gx, int gz, bool skirt)
+                {
+                    float normalized = std::clamp((heights[gz * N + gx] - TC_PACKED_HEIGHT_MIN) / (TC_PACKED_HEIGHT_MAX - TC_PACKED_HEIGHT_MIN), 0.0f, 1.0f);
+                    long packedHeight = std::lround(normalized * 65535.0f);
+                    const TerrainVertexPacked &v = vertices[index];
+                    if (v.x != gx * config->vertexStep || v.z != gz * config->vertexStep || v.skirt != (skirt ? 255 : 0) ||
+                        v.waterMask != 0 || std::labs((long)v.height - packedHeight) > 1)
+                        badVertices++;
+                };
+                for (int gz = 0; gz < N; gz++)
+                {
+                    for (int gx = 0; gx < N; gx++)
+                        check(gz * N + gx, gx, gz, false);
+                }
+                for (int i = 0; i < N; i++)
+                {
+                    check(N * N + i, i, 0, true);
+                    check(N * N + N + i, i, N - 1, true);
+                    check(N * N + 2 * N + i, 0, i, true);
+                    check(N * N + 3 * N + i, N - 1, i, true);
+                }
+            }
+        }
+        glDeleteBuffers(1, &vertexBuffer);
+
+        std::printf("%s\n", (const char *)glGetString(GL_RENDERER));
+        std::printf("%d x %d chunks of %d x %d vertices, %.2f ms per chunk on the GPU (submit to read back)\n",
+                    chunksPerSide, chunksPerSide, N, N, gpuMs / (chunksPerSide * chunksPerSide));
+        std::printf("height error max %.5f mean %.6f world units, %zu of %zu over %.4f\n",
+                    maxError, sumError / samples, overTolerance, samples, tolerance);
+        std::printf("%zu vertices differ from the CPU packing\n", badVertices);
+        failed = overTolerance > 0 || badVertices > 0;
+    }
+
+    oogaboogaExit();
+    std::printf(failed ? "FAILED\n" : "OK\n");
+    return failed;
+}
@@ -0,0 +1,90 @@
+// Benchmark for TerrainNoiseCache: chunk heights from the cached low frequency layers against the
+// exact noise. Reports the time per pass, the speedup and the height error in world units.
+// No window needed, only the CPU side of the terrain generator is used.
+//
+//   noisecachebench [chunks per side] [passes]
+
+#include "Terrain/TerrainGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Heights of one chunk grid per batch, like TerrainChunkManager::buildHeightField
+static double generate(const TerrainGenerator &generator, int chunksPerSide, const TerrainConfig &config, std::vector<float> &heights)
+{
+    const int N = config.verticesPerAxis();
+    std::vector<float> xs(N * N), zs(N * N);
+    heights.resize((size_t)chunksPerSide * chunksPerSide * N * N);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int cz = 0; cz < chunksPerSide; cz++)
+    {
+        for (int cx = 0; cx < chunksPerSide; cx++)
+        {
+            // Centered on the origin, where the mountains are
+            int offsetX = (cx - chunksPerSide / 2) * config.chunkSize;
+            int offsetZ = (cz - chunksPerSide / 2) * config.chunkSize;
+            for (int gz = 0; gz < N; gz++)
+            {
+                for (int gx = 0; gx < N; gx++)
+                {
+                    xs[gz * N + gx] = (float)(offsetX + gx * config.vertexStep);
+                    zs[gz * N + gx] = (float)(offsetZ + gz * config.vertexStep);
+                }
+            }
+            float *out = heights.data() + ((size_t)cz * chunksPerSide + cx) * N * N;
+            generator.getPerlinHeightBatch(xs.data(), zs.data(), out, N * N);
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    const int chunksPerSide = argc > 1 ? std::atoi(argv[1]) : 20;
+    const int passes = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    TerrainConfig exactConfig;
+    exactConfig.noiseCache = false;
+    TerrainConfig cachedConfig;
+    cachedConfig.noiseCache = true;
+
+    TerrainGenerator exact(exactConfig);
+    TerrainGenerator cached(cachedConfig);
+
+    const TerrainNoiseCache *cache = cached.getNoiseCache();
+    std::printf("%zu cached layers, lattice spacing:", cache->getLayerCount());
+    for (size_t i = 0; i < cache->getLayerCount(); i++)
+        std::printf(" %.1f", cache->getSpacing((int)i));
+    std::printf(" world units\n");
+    std::printf("%d x %d chunks of %d x %d vertices\n", chunksPerSide, chunksPerSide,
+                cachedConfig.verticesPerAxis(), cachedConfig.verticesPerAxis());
+
+    std::vector<float> exactHeights, cachedHeights;
+    double exactBest = 1e30, cachedBest = 1e30;
+    double cachedCold = generate(cached, chunksPerSide, cachedConfig, cachedHeights); // builds the tiles
+    for (int pass = 0; pass < passes; pass++)
+    {
+        exactBest = std::min(exactBest, generate(exact, chunksPerSide, exactConfig, exactHeights));
+        cachedBest = std::min(cachedBest, generate(cached, chunksPerSide, cachedConfig, cachedHeights));
+    }
+
+    // Heights are unscaled, the chunks multiply them by 100
+    double maxError = 0.0, sumError = 0.0;
+    for (size_t i = 0; i < exactHeights.size(); i++)
+    {
+        double error = std::fabs((double)cachedHeights[i] - exactHeights[i]) * 100.0;
+        maxError = std::max(maxError, error);
+        sumError += error;
+    }
+
+    std::printf("exact:  %8.2f ms\n", exactBest);
+    std::printf("cached: %8.2f ms (%.2f ms with tile builds)\n", cachedBest, cachedCold);
+    std::printf("speedup %.2fx, height error max %.4f mean %.5f world units\n",
+                exactBest / cachedBest, maxError, sumError / exactHeights.size());
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Benchmark for VegetationScatter: candidate vegetation of a chunk from the Poisson disk tile against
+// the placement it replaced (8 octave fbm noise at every grid point, kept below 0.3). Reports the time
+// per chunk and the candidates per chunk for the chunk layouts of the presets. Heights and the height
+// band check are left out of both, they cost the same. No window needed.
+//
+//   scatterbench [chunks per side]
+
+#include "Terrain/VegetationScatter.h"
+#include "Terrain/TerrainConfig.h"
+#include "vendor/stb_image/stb_perlin.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// The old TerrainChunkManager::placeTrees without the heights
+static size_t placeOld(const TerrainConfig &config, int cx, int cz, std::vector<glm::vec3> &out)
+{
+    const int cells = config.cellsPerAxis();
+    for (int gz = 0; gz < cells; gz++)
+    {
+        for (int gx = 0; gx < cells; gx++)
+        {
+            float worldX = (float)(cx * config.chunkSize + gx * config.vertexStep);
+            float worldZ = (float)(cz * config.chunkSize + gz * config.vertexStep);
+            float noise = stb_perlin_fbm_noise3(worldX * 0.03f * 0.8f, worldZ * 0.02f * 0.8f, 0.0f, 6.0f, 0.75f, 8);
+            if ((noise + 1.0f) * 0.5f <= 0.3f)
+                out.push_back(glm::vec3(worldX, 0.0f, worldZ));
+        }
+    }
+    return out.size();
+}
+
+int main(int argc, char **argv)
+{
+    const int chunksPerSide = argc > 1 ? std::atoi(argv[1]) : 16;
+
+    auto start = std::chrono::steady_clock::now();
+    VegetationScatter scatter;
+    double tileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("tile: %zu points in %.0f x %.0f, built in %.2f ms\n", scatter.getTilePointCount(),
+                VegetationScatter::TILE_SIZE, VegetationScatter::TILE_SIZE, tileMs);
+
+    const TerrainQuality qualities[] = {TerrainQuality::LOW, TerrainQuality::MEDIUM, TerrainQuality::HIGH, TerrainQuality::ULTRA};
+    const char *names[] = {"low", "medium", "high", "ultra"};
+    for (int q = 0; q < 4; q++)
+    {
+        TerrainConfig config = TerrainConfig::preset(qualities[q]);
+        size_t oldCount = 0, newCount = 0;
+        std::vector<glm::vec3> oldOut;
+        std::vector<VegetationInstance> newOut;
+
+        start = std::chrono::steady_clock::now();
+        for (int cz = 0; cz < chunksPerSide; cz++)
+        {
+            for (int cx = 0; cx < chunksPerSide; cx++)
+            {
+                oldOut.clear();
+                oldCount += placeOld(config, cx - chunksPerSide / 2, cz - chunksPerSide / 2, oldOut);
+            }
+        }
+        double oldMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (int cz = 0; cz < chunksPerSide; cz++)
+        {
+            for (int cx = 0; cx < chunksPerSide; cx++)
+            {
+                newOut.clear();
+                scatter.scatter((float)((cx - chunksPerSide / 2) * config.chunkSize), (float)((cz - chunksPerSide / 2) * config.chunkSize),
+                                (float)config.chunkSize, newOut);
+                newCount += newOut.size();
+            }
+        }
+        double newMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const int chunks = chunksPerSide * chunksPerSide;
+        std::printf("%-6s %3d x %-3d grid: noise per point %.3f ms/chunk (%zu trees), tile %.3f ms/chunk (%zu candidates), %.1fx\n",
+                    names[q], config.chunkSize, config.vertexStep, oldMs / chunks, oldCount / chunks, newMs / chunks, newCount / chunks, oldMs / newMs);
+    }
+    return 0;
+}